@@ -0,0 +1,107 @@
+#include "BinaryOutput.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+BinaryOutput::BinaryOutput(WriteFunc write) :
+  write(write) {
+  for(uint8_t i = 0; i < NUM_STREAMS; i++) {
+    slots[i] = i;
+    queued_sequence[i] = 0;
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BinaryOutput::submit_angles(FrameCodec::AnglesFrame& frame) {
+  uint8_t stream = station_stream(STREAM_ANGLES, frame.station);
+  frame.header.sequence = sequence;
+  uint8_t* buffer = claim_buffer(stream);
+  commit_buffer(stream, FrameCodec::encode_angles(frame, buffer));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BinaryOutput::submit_pose(FrameCodec::PoseFrame& frame) {
+  uint8_t stream = station_stream(STREAM_POSE, frame.station);
+  frame.header.sequence = sequence;
+  uint8_t* buffer = claim_buffer(stream);
+  commit_buffer(stream, FrameCodec::encode_pose(frame, buffer));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BinaryOutput::submit_capture(FrameCodec::CaptureFrame& frame) {
+  if(queued & (1u << STREAM_CAPTURE))
+    return false;
+
+  frame.header.sequence = sequence;
+  uint8_t* buffer = claim_buffer(STREAM_CAPTURE);
+  commit_buffer(STREAM_CAPTURE, FrameCodec::encode_capture(frame, buffer));
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BinaryOutput::submit_stats(FrameCodec::StatsFrame& frame) {
+  if(queued & (1u << STREAM_STATS))
+    return false;
+
+  frame.header.sequence = sequence;
+  uint8_t* buffer = claim_buffer(STREAM_STATS);
+  commit_buffer(STREAM_STATS, FrameCodec::encode_stats(frame, buffer));
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BinaryOutput::service() {
+  while(true) {
+    if(lengths[sending] == 0) {
+      //Nothing in flight, so start on the oldest queued frame if there is one, swapping its
+      //buffer for the idle one so its stream can queue again straight away
+      if(queued == 0)
+        return;
+      uint8_t oldest = 0;
+      uint16_t oldest_age = 0;
+      for(uint8_t i = 0; i < NUM_STREAMS; i++) {
+        uint16_t age = sequence - queued_sequence[i];
+        if((queued & (1u << i)) && age >= oldest_age) {
+          oldest = i;
+          oldest_age = age;
+        }
+      }
+      uint8_t buffer = slots[oldest];
+      slots[oldest] = sending;
+      sending = buffer;
+      sent = 0;
+      queued &= ~(1u << oldest);
+    }
+
+    uint32_t accepted = write(buffers[sending] + sent, lengths[sending] - sent);
+    sent += accepted;
+    if(sent < lengths[sending])
+      return;
+
+    lengths[sending] = 0;
+    frames_sent++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint8_t* BinaryOutput::claim_buffer(uint8_t stream) {
+  if(queued & (1u << stream)) {
+    frames_replaced++;
+    queued &= ~(1u << stream);
+  }
+  return buffers[slots[stream]];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BinaryOutput::commit_buffer(uint8_t stream, uint32_t length) {
+  lengths[slots[stream]] = length;
+  queued |= 1u << stream;
+  queued_sequence[stream] = sequence++;
+  service();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+#include "FrameCodec.hpp"
+
+// Non-blocking sender for encoded frames, with one frame queued per stream.
+//
+// One buffer is drained into the transport while the next frames are encoded into
+// the others, so the decode loop never waits on the link. Each station's angles and
+// pose, the capture stream and the stats each queue into a slot of their own. If a
+// newer angles or pose frame arrives before the queued one from the same stream has
+// started sending, the queued one is replaced, so a slow link always carries the most
+// recent data, and no stream can crowd out another. Queued frames go oldest first.
+class BinaryOutput {
+  //--------------------------------------------------
+  // Types
+  //--------------------------------------------------
+public:
+  //Writes up to length bytes without blocking and returns how many were accepted
+  typedef uint32_t (*WriteFunc)(const uint8_t* data, uint32_t length);
+
+
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint8_t NUM_STATIONS   = 2;
+  static const uint8_t STREAM_CAPTURE = 0;
+  static const uint8_t STREAM_STATS   = 1;
+  static const uint8_t STREAM_ANGLES  = 2;                              //Plus the station
+  static const uint8_t STREAM_POSE    = STREAM_ANGLES + NUM_STATIONS;   //Plus the station
+  static const uint8_t NUM_STREAMS    = STREAM_POSE + NUM_STATIONS;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  WriteFunc write;
+
+  uint8_t buffers[NUM_STREAMS + 1][FrameCodec::MAX_ENCODED_SIZE];
+  uint32_t lengths[NUM_STREAMS + 1] = {};
+  uint8_t slots[NUM_STREAMS];             //The buffer each stream encodes its next frame into
+  uint8_t sending = NUM_STREAMS;          //Index of the buffer being drained
+  uint32_t sent = 0;                      //Bytes of it already accepted by the transport
+  uint32_t queued = 0;                    //Bitmask of streams whose slot holds a complete frame
+  uint16_t queued_sequence[NUM_STREAMS];  //The sequence number of each queued frame
+
+  uint16_t sequence = 0;
+  uint32_t frames_sent = 0;
+  uint32_t frames_replaced = 0;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  BinaryOutput(WriteFunc write);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Encodes the frame, filling in its sequence number, and queues it for sending. Only a
+  //frame of the same type and station still waiting to be sent is replaced
+  void submit_angles(FrameCodec::AnglesFrame& frame);
+  void submit_pose(FrameCodec::PoseFrame& frame);
+
+  //Capture frames are never replaced, as every raw word matters. Returns false, without
+  //taking the frame, if one is already waiting to be sent
+  bool submit_capture(FrameCodec::CaptureFrame& frame);
+
+  //Stats frames are sent whenever asked for, so they are never replaced either
+  bool submit_stats(FrameCodec::StatsFrame& frame);
+
+  //Passes as much pending data to the transport as it will take without blocking
+  void service();
+
+  bool idle() const { return lengths[sending] == 0 && queued == 0; }
+  uint32_t sent_count() const { return frames_sent; }
+  uint32_t replaced_count() const { return frames_replaced; }
+private:
+  static uint8_t station_stream(uint8_t first, uint8_t station) {
+    return first + (station < NUM_STATIONS ? station : NUM_STATIONS - 1);
+  }
+  //Returns the buffer to encode the stream's next frame into, replacing any frame queued there
+  uint8_t* claim_buffer(uint8_t stream);
+  void commit_buffer(uint8_t stream, uint32_t length);
+};
@@ -0,0 +1,122 @@
+#include "pico/multicore.h"
+#include "CaptureCore.hpp"
+#include "IrqProfiler.hpp"
+#include "PowerManager.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// STATICS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+CaptureCore* CaptureCore::instance = nullptr;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void CaptureCore::core1_entry() {
+  if(instance != nullptr) {
+    instance->run();
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+CaptureCore::CaptureCore(PulseSource* const* sources, uint8_t num_sensors) :
+  sources(sources), num_sensors(num_sensors), decoder(num_sensors) {
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void CaptureCore::launch() {
+  for(uint8_t s = 0; s < num_sensors; s++) {
+    if(sources[s]->drain_timed())
+      drain_timed_sensors |= 1u << s;
+  }
+  instance = this;
+  multicore_launch_core1(core1_entry);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t CaptureCore::receive(SweepEvent* events, uint32_t max_count) {
+  uint32_t count = queue.pop_batch(events, max_count);
+
+  uint32_t now = time_us_32();
+  for(uint32_t i = 0; i < count; i++) {
+    if(drain_timed_sensors & (1u << events[i].sensor)) {
+      consumer_stats.drain_timed++;
+      continue;
+    }
+    uint32_t latency = now - events[i].timestamp_us;
+    if(latency > consumer_stats.max_latency_us)
+      consumer_stats.max_latency_us = latency;
+    consumer_stats.total_latency_us += latency;
+  }
+  consumer_stats.events += count;
+
+  return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PipelineStats CaptureCore::stats() const {
+  PipelineStats stats = consumer_stats;
+  stats.dropped_events = queue.dropped_count();
+  stats.max_queue_depth = max_queue_depth;
+  stats.max_drain_gap_us = max_drain_gap_us;
+  return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void CaptureCore::run() {
+  //Initialising from here registers the PIO and DMA interrupts on core1
+  for(uint8_t s = 0; s < num_sensors; s++) {
+    sources[s]->init();
+    decoder.set_high_resolution(s, sources[s]->high_resolution());
+  }
+
+  uint32_t words[PulseDecoder::DRAIN_BATCH];
+  uint32_t window_starts[PulseDecoder::DRAIN_BATCH];
+  SweepEvent events[PulseDecoder::DRAIN_BATCH];
+  uint32_t last_drain = time_us_32();
+
+  while(true) {
+    uint32_t drained = 0;
+    for(uint8_t s = 0; s < num_sensors; s++) {
+      uint32_t count = sources[s]->get_received_batch(words, PulseDecoder::DRAIN_BATCH, window_starts);
+      drained += count;
+      uint32_t decode_start = IrqProfiler::now();
+      uint32_t num_events = decoder.process(s, words, count, events, window_starts);
+      if(TrackerStats::ENABLED && count > 0) {
+        decode_cycles.record(IrqProfiler::elapsed(decode_start));
+      }
+
+      for(uint32_t e = 0; e < num_events; e++) {
+        queue.push(events[e]);
+      }
+
+      //Wake core0 if it is sleeping in a low power main loop
+      if(num_events > 0) {
+        PowerManager::signal();
+      }
+    }
+
+    uint32_t depth = queue.size();
+    if(depth > max_queue_depth)
+      max_queue_depth = depth;
+
+    uint32_t now = time_us_32();
+    if(now - last_drain > max_drain_gap_us)
+      max_drain_gap_us = now - last_drain;
+    last_drain = now;
+
+    //A signal between the drain and the WFE is latched by the event flag, so is never slept
+    //through. The sleep itself is not a drain gap
+    if(max_sleep_us > 0 && drained == 0) {
+      best_effort_wfe_or_timeout(make_timeout_time_us(max_sleep_us));
+      last_drain = time_us_32();
+    }
+  }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "pico/stdlib.h"
+#include "PulseSource.hpp"
+#include "PulseDecoder.hpp"
+#include "PulseRing.hpp"
+#include "TrackerStats.hpp"
+
+// Counters for comparing single and dual core capture. Latency runs from the sweep
+// crossing the sensor to core0 receiving it. Events from drain-timed sources (see
+// PulseSource::drain_timed) are timed from when they were drained, so are left out of it.
+// The drain gap is the longest time between two passes over the sensors, which bounds
+// the decode latency
+struct PipelineStats {
+  uint32_t events           = 0;
+  uint32_t drain_timed      = 0;    //Events left out of the latency
+  uint32_t dropped_events   = 0;
+  uint32_t max_queue_depth  = 0;
+  uint32_t max_latency_us   = 0;
+  uint64_t total_latency_us = 0;
+  uint32_t max_drain_gap_us = 0;
+
+  uint32_t mean_latency_us() const { return events > drain_timed ? (uint32_t)(total_latency_us / (events - drain_timed)) : 0; }
+};
+
+// Runs the sensor interrupts, ring draining and pulse decoding on core1, passing the
+// decoded sweeps to core0 through a lock-free queue. This keeps decode latency bounded
+// no matter how long core0 spends on pose maths or blocking output
+class CaptureCore {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint32_t QUEUE_CAPACITY  = 128;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  PulseSource* const* sources;
+  const uint8_t num_sensors;
+
+  PulseDecoder decoder;
+  PulseRing<SweepEvent, QUEUE_CAPACITY> queue;
+
+  volatile uint32_t max_queue_depth = 0;    //Written by core1
+  volatile uint32_t max_drain_gap_us = 0;   //Written by core1
+  CycleHistogram decode_cycles;             //Written by core1
+  PipelineStats consumer_stats;             //Written by core0
+  uint32_t max_sleep_us = 0;                //0 keeps core1 polling
+  uint32_t drain_timed_sensors = 0;         //Set by launch(), before core1 starts
+
+  static CaptureCore* instance;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  CaptureCore(PulseSource* const* sources, uint8_t num_sensors);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Starts core1, which initialises the sources so their interrupts are handled there
+  void launch();
+
+  //Called from core0. Takes up to max_count decoded sweeps from the queue
+  uint32_t receive(SweepEvent* events, uint32_t max_count);
+
+  PipelineStats stats() const;
+
+  //See PulseDecoder::set_reject_reflections. Call before launch()
+  void set_reject_reflections(bool enabled) { decoder.set_reject_reflections(enabled); }
+
+  //See PulseDecoder::set_sync_tracking. Call before launch()
+  void set_sync_tracking(bool enabled) { decoder.set_sync_tracking(enabled); }
+
+  //Lets core1 sleep in WFE after a pass that drained nothing, until a capture interrupt
+  //signals or max_sleep_us has passed, as PowerManager::wait does for core0. Call before launch()
+  void set_low_power(uint32_t max_sleep_us) { this->max_sleep_us = max_sleep_us; }
+
+  //Snapshots of core1's decode statistics
+  const CycleHistogram& decode_histogram() const { return decode_cycles; }
+  const DecodeCounts& decode_counts() const { return decoder.decode_counts(); }
+private:
+  static void core1_entry();
+  void run();
+};
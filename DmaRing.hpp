@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+
+// The consumer side of a ring buffer that a DMA channel writes into using its address
+// wrapping, so words arrive with no interrupt at all.
+//
+// The buffer is aligned to its own size, as the DMA's ring feature requires. The DMA
+// cannot see the consumer, so when the consumer falls more than a ring behind, the
+// oldest words are overwritten. This is detected from the channel's free-running count
+// of words written, and those words are counted as dropped rather than returned stale.
+//
+// The count is read through a callable, so host code can stand in for the DMA channel
+template<uint32_t CAPACITY>
+class DmaRing {
+  static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "DmaRing capacity must be a power of two");
+
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint32_t MASK = CAPACITY - 1;
+  static const uint32_t SIZE_BYTES = CAPACITY * sizeof(uint32_t);
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  alignas(SIZE_BYTES) uint32_t buffer[CAPACITY];
+  uint32_t read_count = 0;
+  uint32_t dropped = 0;
+  uint32_t high_water = 0;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  //The read count must start where the channel's count of words written does. Host tests
+  //start both just short of their 2^32 wrap
+  DmaRing(uint32_t first_count = 0) : read_count(first_count) {}
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  uint32_t* data() { return buffer; }
+
+  //The channel_config_set_ring size, as log2 of the buffer size in bytes
+  static constexpr uint8_t ring_size_bits() {
+    uint8_t bits = 0;
+    while((1u << bits) < SIZE_BYTES)
+      bits++;
+    return bits;
+  }
+
+  //Copies out up to max_count words. written() returns the total number of words the DMA has written
+  template<typename WrittenFunc>
+  uint32_t pop_batch(WrittenFunc written, uint32_t* items, uint32_t max_count) {
+    uint32_t w = written();
+    uint32_t r = read_count;
+    uint32_t waiting = w - r;
+    if(waiting > CAPACITY)
+      waiting = CAPACITY;
+    if(waiting > high_water)
+      high_water = waiting;   //Seen by the consumer, so a lower bound on the true mark
+    if(w - r > CAPACITY) {
+      dropped += w - r - CAPACITY;
+      r = w - CAPACITY;
+    }
+
+    uint32_t count = w - r;
+    if(count > max_count)
+      count = max_count;
+    for(uint32_t i = 0; i < count; i++)
+      items[i] = buffer[(r + i) & MASK];
+    read_count = r + count;
+
+    //The DMA may have lapped us while copying, in which case the oldest words copied are newer
+    //than they should be. Allow one more for a write in progress
+    uint32_t after = written() + 1;
+    if(after - r > CAPACITY) {
+      uint32_t lost = after - r - CAPACITY;
+      if(lost > count)
+        lost = count;
+      for(uint32_t i = lost; i < count; i++)
+        items[i - lost] = items[i];
+      count -= lost;
+      dropped += lost;
+    }
+    return count;
+  }
+
+  uint32_t size(uint32_t written) const {
+    uint32_t waiting = written - read_count;
+    return waiting < CAPACITY ? waiting : CAPACITY;
+  }
+  uint32_t dropped_count() const { return dropped; }
+  uint32_t high_water_mark() const { return high_water; }
+  static constexpr uint32_t capacity() { return CAPACITY; }
+};
@@ -0,0 +1,82 @@
+#include "EdgeDemux.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+EdgeDemux::EdgeDemux(uint8_t num_channels) :
+  num_channels(num_channels < MAX_CHANNELS ? num_channels : MAX_CHANNELS),
+  timer_bits(32 - this->num_channels),
+  timer_mask((1u << (32 - this->num_channels)) - 1) {
+  for(uint8_t c = 0; c < MAX_CHANNELS; c++) {
+    rise_ticks[c] = 0;
+    window_start[c] = 0;
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t EdgeDemux::feed(uint32_t word, uint32_t now_us, uint32_t* pulse_words, uint8_t* channels) {
+  uint32_t levels = word >> timer_bits;
+  uint32_t field = ~word & timer_mask;    //The PIO timer counts down
+
+  //Extend the timer, using the CPU clock to count any wraps of the field since the last word
+  if(started) {
+    uint32_t delta = (field - last_field) & timer_mask;
+    uint32_t expected = (uint32_t)(((uint64_t)(now_us - last_us) * TICKS_PER_US_Q8) >> 8);
+    if(expected > delta + (timer_mask >> 1)) {
+      uint32_t wraps = (expected - delta + (timer_mask >> 1)) >> timer_bits;
+      delta += wraps << timer_bits;
+    }
+    ticks += delta;
+  }
+  started = true;
+  last_field = field;
+  last_us = now_us;
+
+  uint32_t count = 0;
+  uint32_t changed = levels ^ last_levels;
+  last_levels = levels;
+
+  while(changed) {
+    uint8_t c = __builtin_ctz(changed);
+    changed &= changed - 1;
+    edge_count++;
+
+    uint32_t bit = 1u << c;
+    if(levels & bit) {
+      rise_ticks[c] = ticks;
+
+      //A window lasts as long as lighthouse.pio's 16 bit timer would
+      if((window_open & bit) && ticks_to_counts(ticks - window_start[c]) >= WINDOW_COUNTS)
+        window_open &= ~bit;
+      continue;
+    }
+
+    uint32_t rise = rise_ticks[c];
+    if(!(window_open & bit)) {
+      //Only a long enough pulse opens a window, just as the PIO program's blocker loop requires
+      if(ticks - rise < MIN_PULSE_TICKS)
+        continue;
+      window_open |= bit;
+      window_start[c] = rise;
+      pulse_words[count] = ticks_to_counts(ticks - rise);
+    }
+    else {
+      uint32_t start = ticks_to_counts(rise - window_start[c]);
+      uint32_t end = ticks_to_counts(ticks - window_start[c]);
+      if(end >= WINDOW_COUNTS) {
+        window_open &= ~bit;
+        continue;
+      }
+      pulse_words[count] = (start << 16) | end;
+    }
+    channels[count] = c;
+    count++;
+  }
+  return count;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include "LighthouseTiming.hpp"
+
+// Splits the edge words from sensor_group.pio back into per-sensor pulse words, in
+// exactly the format lighthouse.pio produces, so PulseDecoder works unchanged.
+//
+// Each word holds the levels of every pin in the group in its top bits and the low
+// bits of a count-down timer below. The timer is extended to 32 bits using the CPU
+// time each word was read at, so words must be fed within half a timer wrap of being
+// pushed (about 2.3ms with 16 pins), which an interrupt handler easily manages.
+//
+// lighthouse.pio's counting windows are emulated per sensor: a window opens on a
+// pulse of at least MIN_PULSE_CYCLES, whose word has a start of 0, and stays open for
+// 0xffff counts of its timer. Changed pins are found with a count-trailing-zeros, so
+// the cost is per edge rather than per sensor.
+class EdgeDemux {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint8_t MAX_CHANNELS         = 16;   //Leaves at least a 16 bit timer
+  static const uint32_t LOOP_CYCLES         = 9;    //SENSOR_GROUP_LOOP_CYCLES in sensor_group.pio
+  static const uint32_t MIN_PULSE_CYCLES    = 6240; //lighthouse.pio's blocker loop
+  static const uint32_t WINDOW_COUNTS       = 0xffff;
+
+  //Timer ticks per microsecond, as Q8, for extending the timer from the CPU clock
+  static constexpr uint32_t TICKS_PER_US_Q8 = (uint32_t)(((uint64_t)LighthouseTiming::SYS_CLOCK_HZ << 8)
+                                                         / ((uint64_t)LOOP_CYCLES * LighthouseTiming::FREQ_DIVIDER * 1000000));
+  static constexpr uint32_t MIN_PULSE_TICKS = (MIN_PULSE_CYCLES + LOOP_CYCLES - 1) / LOOP_CYCLES;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  const uint8_t num_channels;
+  const uint8_t timer_bits;
+  const uint32_t timer_mask;
+
+  uint32_t last_levels = 0;
+  uint32_t last_field = 0;
+  uint32_t last_us = 0;
+  uint32_t ticks = 0;           //The extended timer, counting up
+  bool started = false;
+
+  uint32_t rise_ticks[MAX_CHANNELS];
+  uint32_t window_start[MAX_CHANNELS];
+  uint32_t window_open = 0;     //Bitmask of channels with an open counting window
+
+  uint32_t edge_count = 0;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  EdgeDemux(uint8_t num_channels);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Decodes one word from the state machine, read at now_us. Writes a pulse word and its
+  //channel for every pulse it completes, and returns how many (at most num_channels)
+  uint32_t feed(uint32_t word, uint32_t now_us, uint32_t* pulse_words, uint8_t* channels);
+
+  uint8_t channel_count() const { return num_channels; }
+  uint32_t edges() const { return edge_count; }
+
+  static constexpr uint32_t ticks_to_counts(uint32_t ticks) {
+    return (uint32_t)((uint64_t)ticks * LOOP_CYCLES / LighthouseTiming::PIO_LOOP_CYCLES);
+  }
+};
@@ -0,0 +1,47 @@
+#include "EdgeTimer.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EdgeTimer::feed(uint32_t word, uint32_t& pulse_word) {
+  uint32_t ticks = (~word >> 1) & TICK_MASK;    //The PIO timer counts down
+  edge_count++;
+
+  if(word & 1) {
+    rise_ticks = ticks;
+    high = true;
+
+    //A window lasts as long as lighthouse.pio's 16 bit timer would
+    if(window_open && ((ticks - window_start) & TICK_MASK) >= WINDOW_TICKS)
+      window_open = false;
+    return false;
+  }
+
+  //A fall without a rise means the rise was lost
+  if(!high)
+    return false;
+  high = false;
+
+  uint32_t length = (ticks - rise_ticks) & TICK_MASK;
+  if(!window_open) {
+    //Only a long enough pulse opens a window, just as the PIO program's blocker loop requires
+    if(length < MIN_PULSE_TICKS || length >= WINDOW_TICKS)
+      return false;
+    window_open = true;
+    window_start = rise_ticks;
+    pulse_word = LighthouseTiming::hires_word(0, ticks_to_counts(length, LighthouseTiming::MID2_FRACTION_BITS));
+    return true;
+  }
+
+  uint32_t start = (rise_ticks - window_start) & TICK_MASK;
+  if(start + length >= WINDOW_TICKS) {
+    window_open = false;
+    return false;
+  }
+  //Both edges in fractional counts from the window's start, so the midpoint is no coarser than either
+  pulse_word = LighthouseTiming::hires_word(ticks_to_counts(start, LighthouseTiming::MID2_FRACTION_BITS),
+                                            ticks_to_counts(start + length, LighthouseTiming::MID2_FRACTION_BITS));
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
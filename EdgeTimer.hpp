@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include "LighthouseTiming.hpp"
+
+// Turns the edge words from lighthouse_hires.pio back into pulse words, in the high
+// resolution format described in LighthouseTiming, so PulseDecoder can use them in
+// place of lighthouse.pio's.
+//
+// Each word holds the low 31 bits of a count-down timer above the pin's new level.
+// Only differences between edges are used, and a counting window is far shorter than
+// the timer's wrap (over 68s at 2 cycles per tick), so no further extension is needed.
+//
+// lighthouse.pio's counting windows are emulated: a window opens on a pulse of at least
+// MIN_PULSE_CYCLES, whose word has a start of 0, and stays open for 0xffff counts.
+// Because every word carries its level, a lost word costs at most one pulse rather than
+// swapping every rise and fall after it.
+class EdgeTimer {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint32_t TICK_MASK           = 0x7fffffff;
+  static const uint32_t MIN_PULSE_CYCLES    = 6240;   //lighthouse.pio's blocker loop
+  static const uint32_t WINDOW_COUNTS       = 0xffff;
+
+  static constexpr uint32_t MIN_PULSE_TICKS = (MIN_PULSE_CYCLES + LighthouseTiming::HIRES_LOOP_CYCLES - 1) / LighthouseTiming::HIRES_LOOP_CYCLES;
+  static constexpr uint32_t WINDOW_TICKS    = WINDOW_COUNTS * LighthouseTiming::PIO_LOOP_CYCLES / LighthouseTiming::HIRES_LOOP_CYCLES;
+
+  static_assert(((uint64_t)WINDOW_TICKS * LighthouseTiming::HIRES_LOOP_CYCLES << LighthouseTiming::MID2_FRACTION_BITS) <= UINT32_MAX,
+                "A window's ticks no longer fit in 32bit fractional counts");
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  uint32_t rise_ticks = 0;
+  uint32_t window_start = 0;
+  bool high = false;            //A rise has been seen without its fall
+  bool window_open = false;
+
+  uint32_t edge_count = 0;
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Decodes one edge word. Returns true, with pulse_word set, if it completed a pulse
+  bool feed(uint32_t word, uint32_t& pulse_word);
+
+  uint32_t edges() const { return edge_count; }
+
+  //Ticks to counts, with the given number of fractional bits
+  static constexpr uint32_t ticks_to_counts(uint32_t ticks, uint8_t fraction_bits) {
+    return (ticks * LighthouseTiming::HIRES_LOOP_CYCLES << fraction_bits) / LighthouseTiming::PIO_LOOP_CYCLES;
+  }
+};
@@ -0,0 +1,416 @@
+#include "FrameCodec.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint16_t FrameCodec::crc16(const uint8_t* data, uint32_t length, uint16_t crc) {
+  //Nibble-wise table, a good trade of speed against flash on the M0+
+  static const uint16_t TABLE[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+  };
+
+  for(uint32_t i = 0; i < length; i++) {
+    crc = (crc << 4) ^ TABLE[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (crc << 4) ^ TABLE[(crc >> 12) ^ (data[i] & 0x0f)];
+  }
+  return crc;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t FrameCodec::cobs_encode(const uint8_t* data, uint32_t length, uint8_t* out) {
+  uint32_t code_index = 0;
+  uint32_t out_index = 1;
+  uint8_t code = 1;
+
+  for(uint32_t i = 0; i < length; i++) {
+    if(data[i] == 0) {
+      out[code_index] = code;
+      code_index = out_index++;
+      code = 1;
+    }
+    else {
+      out[out_index++] = data[i];
+      code++;
+      if(code == 0xff) {
+        out[code_index] = code;
+        code_index = out_index++;
+        code = 1;
+      }
+    }
+  }
+  out[code_index] = code;
+  out[out_index++] = 0;
+  return out_index;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t FrameCodec::cobs_decode(const uint8_t* data, uint32_t length, uint8_t* out, uint32_t max_length) {
+  uint32_t in_index = 0;
+  uint32_t out_index = 0;
+
+  while(in_index < length) {
+    uint8_t code = data[in_index++];
+    if(code == 0 || in_index + code - 1 > length)
+      return 0;
+
+    for(uint8_t i = 1; i < code; i++) {
+      if(out_index >= max_length || data[in_index] == 0)
+        return 0;
+      out[out_index++] = data[in_index++];
+    }
+
+    if(code != 0xff && in_index < length) {
+      if(out_index >= max_length)
+        return 0;
+      out[out_index++] = 0;
+    }
+  }
+  return out_index;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t FrameCodec::encode_angles(const AnglesFrame& frame, uint8_t* out) {
+  uint8_t raw[MAX_RAW_SIZE];
+  uint8_t count = frame.header.sensor_count < MAX_SENSORS ? frame.header.sensor_count : MAX_SENSORS;
+
+  Header header = frame.header;
+  header.type = FRAME_ANGLES;
+  header.sensor_count = count;
+
+  uint32_t length = put_header(header, raw);
+  put_u32(raw + length, frame.valid_mask);
+  raw[length + 4] = frame.station;
+  length += 5;
+  for(uint8_t s = 0; s < count; s++) {
+    put_u32(raw + length, (uint32_t)frame.x_angle[s]);
+    put_u32(raw + length + 4, (uint32_t)frame.y_angle[s]);
+    length += 8;
+  }
+  return finish(raw, length, out);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t FrameCodec::encode_pose(const PoseFrame& frame, uint8_t* out) {
+  uint8_t raw[HEADER_SIZE + POSE_PAYLOAD_SIZE + CRC_SIZE];
+
+  Header header = frame.header;
+  header.type = FRAME_POSE;
+  header.sensor_count = 0;
+
+  uint32_t length = put_header(header, raw);
+  for(uint8_t i = 0; i < 3; i++) {
+    put_u32(raw + length, (uint32_t)frame.position[i]);
+    length += 4;
+  }
+  for(uint8_t i = 0; i < 3; i++) {
+    for(uint8_t j = 0; j < 3; j++) {
+      put_u32(raw + length, (uint32_t)frame.rotation[i][j]);
+      length += 4;
+    }
+  }
+  put_u32(raw + length, (uint32_t)frame.residual);
+  raw[length + 4] = frame.iterations;
+  raw[length + 5] = frame.status;
+  raw[length + 6] = frame.station;
+  length += 7;
+  return finish(raw, length, out);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t FrameCodec::encode_capture(const CaptureFrame& frame, uint8_t* out) {
+  uint8_t raw[MAX_RAW_SIZE];
+  uint8_t count = frame.count < CAPTURE_MAX_RECORDS ? frame.count : CAPTURE_MAX_RECORDS;
+
+  Header header = frame.header;
+  header.type = FRAME_CAPTURE;
+
+  uint32_t length = put_header(header, raw);
+  put_u16(raw + length, frame.dropped);
+  put_u32(raw + length + 2, frame.high_resolution);
+  raw[length + 6] = count;
+  length += CAPTURE_FIXED_SIZE;
+  for(uint8_t i = 0; i < count; i++) {
+    raw[length] = frame.sensor[i];
+    put_u16(raw + length + 1, frame.offset_us[i]);
+    put_u32(raw + length + 3, frame.word[i]);
+    length += CAPTURE_RECORD_SIZE;
+  }
+  return finish(raw, length, out);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t FrameCodec::encode_stats(const StatsFrame& frame, uint8_t* out) {
+  uint8_t raw[STATS_RAW_SIZE];
+  uint8_t count = frame.header.sensor_count < MAX_SENSORS ? frame.header.sensor_count : MAX_SENSORS;
+
+  Header header = frame.header;
+  header.type = FRAME_STATS;
+  header.sensor_count = count;
+
+  uint32_t length = put_header(header, raw);
+  put_u32(raw + length, frame.capture_pulses);
+  length += 4;
+  for(uint8_t st = 0; st < NUM_STAGES; st++) {
+    put_u32(raw + length, frame.stage_count[st]);
+    put_u32(raw + length + 4, frame.stage_max[st]);
+    length += 8;
+    for(uint8_t b = 0; b < CycleHistogram::NUM_BUCKETS; b++) {
+      put_u32(raw + length, frame.stage_buckets[st][b]);
+      length += 4;
+    }
+  }
+  put_u32(raw + length, frame.decode.syncs);
+  put_u32(raw + length + 4, frame.decode.csyncs);
+  put_u32(raw + length + 8, frame.decode.sweeps);
+  put_u32(raw + length + 12, frame.decode.rejected);
+  put_u32(raw + length + 16, frame.decode.replaced);
+  length += 20;
+  for(uint8_t s = 0; s < count; s++) {
+    put_u16(raw + length, frame.high_water[s]);
+    put_u16(raw + length + 2, frame.dropped[s]);
+    put_u16(raw + length + 4, frame.overwritten[s]);
+    length += STATS_SENSOR_SIZE;
+  }
+  return finish(raw, length, out);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t FrameCodec::encode_link_sync(const LinkSyncFrame& frame, uint8_t* out) {
+  uint8_t raw[LINK_SYNC_RAW_SIZE];
+
+  Header header = frame.header;
+  header.type = FRAME_LINK_SYNC;
+  header.sensor_count = 0;
+
+  uint32_t length = put_header(header, raw);
+  raw[length++] = frame.hops;
+  return finish(raw, length, out);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t FrameCodec::encode_link_events(const LinkEventsFrame& frame, uint8_t* out) {
+  uint8_t raw[MAX_RAW_SIZE];
+  uint8_t count = frame.count < LINK_MAX_EVENTS ? frame.count : LINK_MAX_EVENTS;
+
+  Header header = frame.header;
+  header.type = FRAME_LINK_EVENTS;
+
+  uint32_t length = put_header(header, raw);
+  raw[length] = frame.tracker;
+  raw[length + 1] = count;
+  length += 2;
+  for(uint8_t i = 0; i < count; i++) {
+    uint32_t mid2 = frame.mid2[i] < LINK_MAX_MID2 ? frame.mid2[i] : LINK_MAX_MID2;
+    put_u32(raw + length, frame.timestamp_us[i]);
+    put_u32(raw + length + 4, mid2 | ((uint32_t)((frame.sensor[i] & 0x1f) | ((frame.axis[i] & 1) << 5) | ((frame.station[i] & 1) << 6)) << 24));
+    length += LINK_EVENT_SIZE;
+  }
+  return finish(raw, length, out);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameCodec::parse_header(const uint8_t* data, uint32_t length, Header& header) {
+  if(length < HEADER_SIZE + CRC_SIZE || !check_crc(data, length))
+    return false;
+
+  header.type = data[0];
+  header.sensor_count = data[1];
+  header.sequence = get_u16(data + 2);
+  header.timestamp_us = get_u32(data + 4);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameCodec::parse_angles(const uint8_t* data, uint32_t length, AnglesFrame& frame) {
+  if(!parse_header(data, length, frame.header) || frame.header.type != FRAME_ANGLES)
+    return false;
+
+  uint8_t count = frame.header.sensor_count;
+  if(count > MAX_SENSORS || length != HEADER_SIZE + 5 + count * 8u + CRC_SIZE)
+    return false;
+
+  const uint8_t* payload = data + HEADER_SIZE;
+  frame.valid_mask = get_u32(payload);
+  frame.station = payload[4];
+  payload += 5;
+  for(uint8_t s = 0; s < count; s++) {
+    frame.x_angle[s] = (int32_t)get_u32(payload);
+    frame.y_angle[s] = (int32_t)get_u32(payload + 4);
+    payload += 8;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameCodec::parse_pose(const uint8_t* data, uint32_t length, PoseFrame& frame) {
+  if(!parse_header(data, length, frame.header) || frame.header.type != FRAME_POSE)
+    return false;
+
+  if(length != HEADER_SIZE + POSE_PAYLOAD_SIZE + CRC_SIZE)
+    return false;
+
+  const uint8_t* payload = data + HEADER_SIZE;
+  for(uint8_t i = 0; i < 3; i++) {
+    frame.position[i] = (int32_t)get_u32(payload);
+    payload += 4;
+  }
+  for(uint8_t i = 0; i < 3; i++) {
+    for(uint8_t j = 0; j < 3; j++) {
+      frame.rotation[i][j] = (int32_t)get_u32(payload);
+      payload += 4;
+    }
+  }
+  frame.residual = (int32_t)get_u32(payload);
+  frame.iterations = payload[4];
+  frame.status = payload[5];
+  frame.station = payload[6];
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameCodec::parse_capture(const uint8_t* data, uint32_t length, CaptureFrame& frame) {
+  if(!parse_header(data, length, frame.header) || frame.header.type != FRAME_CAPTURE)
+    return false;
+
+  if(length < HEADER_SIZE + CAPTURE_FIXED_SIZE + CRC_SIZE)
+    return false;
+
+  const uint8_t* payload = data + HEADER_SIZE;
+  frame.dropped = get_u16(payload);
+  frame.high_resolution = get_u32(payload + 2);
+  frame.count = payload[6];
+  if(frame.count > CAPTURE_MAX_RECORDS || length != HEADER_SIZE + CAPTURE_FIXED_SIZE + frame.count * CAPTURE_RECORD_SIZE + CRC_SIZE)
+    return false;
+
+  payload += CAPTURE_FIXED_SIZE;
+  for(uint8_t i = 0; i < frame.count; i++) {
+    frame.sensor[i] = payload[0];
+    frame.offset_us[i] = get_u16(payload + 1);
+    frame.word[i] = get_u32(payload + 3);
+    payload += CAPTURE_RECORD_SIZE;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameCodec::parse_stats(const uint8_t* data, uint32_t length, StatsFrame& frame) {
+  if(!parse_header(data, length, frame.header) || frame.header.type != FRAME_STATS)
+    return false;
+
+  uint8_t count = frame.header.sensor_count;
+  if(count > MAX_SENSORS || length != HEADER_SIZE + STATS_FIXED_SIZE + count * STATS_SENSOR_SIZE + CRC_SIZE)
+    return false;
+
+  const uint8_t* payload = data + HEADER_SIZE;
+  frame.capture_pulses = get_u32(payload);
+  payload += 4;
+  for(uint8_t st = 0; st < NUM_STAGES; st++) {
+    frame.stage_count[st] = get_u32(payload);
+    frame.stage_max[st] = get_u32(payload + 4);
+    payload += 8;
+    for(uint8_t b = 0; b < CycleHistogram::NUM_BUCKETS; b++) {
+      frame.stage_buckets[st][b] = get_u32(payload);
+      payload += 4;
+    }
+  }
+  frame.decode.syncs = get_u32(payload);
+  frame.decode.csyncs = get_u32(payload + 4);
+  frame.decode.sweeps = get_u32(payload + 8);
+  frame.decode.rejected = get_u32(payload + 12);
+  frame.decode.replaced = get_u32(payload + 16);
+  payload += 20;
+  for(uint8_t s = 0; s < count; s++) {
+    frame.high_water[s] = get_u16(payload);
+    frame.dropped[s] = get_u16(payload + 2);
+    frame.overwritten[s] = get_u16(payload + 4);
+    payload += STATS_SENSOR_SIZE;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameCodec::parse_link_sync(const uint8_t* data, uint32_t length, LinkSyncFrame& frame) {
+  if(!parse_header(data, length, frame.header) || frame.header.type != FRAME_LINK_SYNC)
+    return false;
+
+  if(length != LINK_SYNC_RAW_SIZE)
+    return false;
+
+  frame.hops = data[HEADER_SIZE];
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameCodec::parse_link_events(const uint8_t* data, uint32_t length, LinkEventsFrame& frame) {
+  if(!parse_header(data, length, frame.header) || frame.header.type != FRAME_LINK_EVENTS)
+    return false;
+
+  if(length < HEADER_SIZE + 2 + CRC_SIZE)
+    return false;
+
+  const uint8_t* payload = data + HEADER_SIZE;
+  frame.tracker = payload[0];
+  frame.count = payload[1];
+  if(frame.count > LINK_MAX_EVENTS || length != HEADER_SIZE + 2 + frame.count * LINK_EVENT_SIZE + CRC_SIZE)
+    return false;
+
+  payload += 2;
+  for(uint8_t i = 0; i < frame.count; i++) {
+    uint32_t packed = get_u32(payload + 4);
+    uint8_t flags = packed >> 24;
+    frame.timestamp_us[i] = get_u32(payload);
+    frame.mid2[i] = packed & LINK_MAX_MID2;
+    frame.sensor[i] = flags & 0x1f;
+    frame.axis[i] = (flags >> 5) & 1;
+    frame.station[i] = (flags >> 6) & 1;
+    payload += LINK_EVENT_SIZE;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameCodec::put_u16(uint8_t* out, uint16_t value) {
+  out[0] = value & 0xff;
+  out[1] = value >> 8;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameCodec::put_u32(uint8_t* out, uint32_t value) {
+  out[0] = value & 0xff;
+  out[1] = (value >> 8) & 0xff;
+  out[2] = (value >> 16) & 0xff;
+  out[3] = value >> 24;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint16_t FrameCodec::get_u16(const uint8_t* data) {
+  return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t FrameCodec::get_u32(const uint8_t* data) {
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t FrameCodec::put_header(const Header& header, uint8_t* out) {
+  out[0] = header.type;
+  out[1] = header.sensor_count;
+  put_u16(out + 2, header.sequence);
+  put_u32(out + 4, header.timestamp_us);
+  return HEADER_SIZE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t FrameCodec::finish(uint8_t* raw, uint32_t length, uint8_t* out) {
+  put_u16(raw + length, crc16(raw, length));
+  return cobs_encode(raw, length + CRC_SIZE, out);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameCodec::check_crc(const uint8_t* data, uint32_t length) {
+  return crc16(data, length - CRC_SIZE) == get_u16(data + length - CRC_SIZE);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <stdint.h>
+#include "TrackerStats.hpp"
+
+// Encoding for the binary output stream.
+//
+// Each frame is a small little-endian header, a type specific payload and a CRC-16
+// (CCITT, 0xFFFF initial value) over both. The whole frame is then COBS encoded and
+// terminated with a zero byte, so a reader can resynchronise on any zero it sees.
+//
+// Angles frame payload, after the common header:
+//   uint32 valid mask    (bit n set if sensor n has fresh angles in this frame)
+//   uint8 station        (which lighthouse the angles are from)
+//   int32 x, int32 y     (per sensor, degrees as Q16.16)
+//
+// Pose frame payload, after the common header:
+//   int32 position[3]    (metres as Q16.16, in the lighthouse's frame)
+//   int32 rotation[9]    (row-major rotation matrix as Q2.30)
+//   int32 residual       (RMS image error as a Q16.16 tangent)
+//   uint8 iterations, uint8 status (0 when solved), uint8 station
+//
+// Capture frame payload, after the common header:
+//   uint16 dropped       (raw words lost to a full link after this frame's records)
+//   uint32 high resolution mask (bit n set if sensor n's words are in EdgeTimer's format)
+//   uint8 count
+//   per record: uint8 sensor (bits 0-4) and window flag (bit 7), uint16 time since the header's
+//     timestamp in us, uint32 raw PIO word. A word that opened a counting window has a start
+//     of 0, so with the flag set its top 16 bits hold how many us before the record's time the
+//     window opened, as latched by its source (see capture_window_word)
+//
+// Stats frame payload, after the common header (all totals since boot):
+//   uint32 capture pulses
+//   per stage (capture interrupt, decode, output): uint32 count, uint32 max cycles,
+//     uint32 buckets[12] (see CycleHistogram)
+//   uint32 syncs, uint32 csyncs, uint32 sweeps, uint32 rejected, uint32 replaced
+//   per sensor: uint16 ring high-water mark, uint16 dropped, uint16 overwritten
+//
+// Link sync frame payload, after the common header (whose timestamp is the aggregator's
+// clock as the frame was started, see TrackerLink):
+//   uint8 hops           (trackers the beacon has passed through since the aggregator)
+//
+// Link events frame payload, after the common header (whose sensor count is the sending
+// tracker's):
+//   uint8 tracker, uint8 count
+//   per event: uint32 timestamp in the aggregator's clock, uint24 sweep midpoint (as
+//     SweepEvent::mid2), uint8 sensor (bits 0-4), axis (bit 5) and station (bit 6)
+class FrameCodec {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  enum FrameType : uint8_t {
+    FRAME_ANGLES  = 0x01,
+    FRAME_POSE    = 0x02,
+    FRAME_CAPTURE = 0x03,
+    FRAME_STATS   = 0x04,
+    FRAME_LINK_SYNC   = 0x05,
+    FRAME_LINK_EVENTS = 0x06,
+  };
+
+  enum StatsStage : uint8_t {
+    STAGE_CAPTURE,
+    STAGE_DECODE,
+    STAGE_OUTPUT,
+    NUM_STAGES,
+  };
+
+  static const uint8_t MAX_SENSORS          = 32;
+  static const uint32_t HEADER_SIZE         = 8;    //type, sensor count, uint16 sequence, uint32 timestamp
+  static const uint32_t CRC_SIZE            = 2;
+  static const uint32_t POSE_PAYLOAD_SIZE   = 12 + 36 + 4 + 3;
+  static const uint8_t CAPTURE_MAX_RECORDS  = 32;
+  static const uint32_t CAPTURE_FIXED_SIZE  = 7;
+  static const uint32_t CAPTURE_RECORD_SIZE = 7;
+  static const uint8_t CAPTURE_WINDOW       = 0x80;   //Set in a record's sensor when its word carries its window's age
+  static const uint32_t ANGLES_RAW_SIZE     = HEADER_SIZE + 5 + MAX_SENSORS * 8 + CRC_SIZE;
+  static const uint32_t STATS_FIXED_SIZE    = 4 + NUM_STAGES * (8 + CycleHistogram::NUM_BUCKETS * 4) + 20;
+  static const uint32_t STATS_SENSOR_SIZE   = 6;
+  static const uint32_t STATS_RAW_SIZE      = HEADER_SIZE + STATS_FIXED_SIZE + MAX_SENSORS * STATS_SENSOR_SIZE + CRC_SIZE;
+  static const uint32_t MAX_RAW_SIZE        = ANGLES_RAW_SIZE > STATS_RAW_SIZE ? ANGLES_RAW_SIZE : STATS_RAW_SIZE;
+  static const uint32_t MAX_ENCODED_SIZE    = MAX_RAW_SIZE + (MAX_RAW_SIZE / 254) + 2;  //COBS overhead plus the delimiter
+  static const uint32_t LINK_SYNC_RAW_SIZE  = HEADER_SIZE + 1 + CRC_SIZE;
+  static const uint8_t LINK_MAX_EVENTS      = 32;
+  static const uint32_t LINK_EVENT_SIZE     = 8;
+  static const uint32_t LINK_MAX_MID2       = 0xffffff;
+
+  static_assert(HEADER_SIZE + CAPTURE_FIXED_SIZE + CAPTURE_MAX_RECORDS * CAPTURE_RECORD_SIZE + CRC_SIZE <= MAX_RAW_SIZE, "Capture frame too large");
+  static_assert(HEADER_SIZE + 2 + LINK_MAX_EVENTS * LINK_EVENT_SIZE + CRC_SIZE <= MAX_RAW_SIZE, "Link events frame too large");
+
+  struct Header {
+    uint8_t type;
+    uint8_t sensor_count;
+    uint16_t sequence;
+    uint32_t timestamp_us;
+  };
+
+  struct AnglesFrame {
+    Header header;
+    uint32_t valid_mask;
+    uint8_t station;
+    int32_t x_angle[MAX_SENSORS];
+    int32_t y_angle[MAX_SENSORS];
+  };
+
+  struct CaptureFrame {
+    Header header;
+    uint16_t dropped;
+    uint32_t high_resolution;
+    uint8_t count;
+    uint8_t sensor[CAPTURE_MAX_RECORDS];
+    uint16_t offset_us[CAPTURE_MAX_RECORDS];
+    uint32_t word[CAPTURE_MAX_RECORDS];
+  };
+
+  struct StatsFrame {
+    Header header;
+    uint32_t capture_pulses;
+    uint32_t stage_count[NUM_STAGES];
+    uint32_t stage_max[NUM_STAGES];
+    uint32_t stage_buckets[NUM_STAGES][CycleHistogram::NUM_BUCKETS];
+    DecodeCounts decode;
+    uint16_t high_water[MAX_SENSORS];
+    uint16_t dropped[MAX_SENSORS];
+    uint16_t overwritten[MAX_SENSORS];
+  };
+
+  struct LinkSyncFrame {
+    Header header;
+    uint8_t hops;
+  };
+
+  struct LinkEventsFrame {
+    Header header;
+    uint8_t tracker;
+    uint8_t count;
+    uint32_t timestamp_us[LINK_MAX_EVENTS];
+    uint32_t mid2[LINK_MAX_EVENTS];
+    uint8_t sensor[LINK_MAX_EVENTS];
+    uint8_t axis[LINK_MAX_EVENTS];
+    uint8_t station[LINK_MAX_EVENTS];
+  };
+
+  struct PoseFrame {
+    Header header;
+    int32_t position[3];
+    int32_t rotation[3][3];
+    int32_t residual;
+    uint8_t iterations;
+    uint8_t status;
+    uint8_t station;
+  };
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  static uint16_t crc16(const uint8_t* data, uint32_t length, uint16_t crc = 0xffff);
+
+  //COBS encodes length bytes into out, including the trailing zero delimiter. Returns the encoded size
+  static uint32_t cobs_encode(const uint8_t* data, uint32_t length, uint8_t* out);
+
+  //Decodes one COBS frame (without its delimiter). Returns the decoded size, or 0 if malformed
+  static uint32_t cobs_decode(const uint8_t* data, uint32_t length, uint8_t* out, uint32_t max_length);
+
+  //A window-opening capture word with the microseconds since its window opened in its top 16 bits
+  static constexpr uint32_t capture_window_word(uint32_t word, uint32_t age_us) {
+    return ((age_us < 0xffff ? age_us : 0xffff) << 16) | (word & 0xffff);
+  }
+
+  //Builds a complete, encoded angles frame into out, which must hold MAX_ENCODED_SIZE bytes
+  static uint32_t encode_angles(const AnglesFrame& frame, uint8_t* out);
+  static uint32_t encode_pose(const PoseFrame& frame, uint8_t* out);
+  static uint32_t encode_capture(const CaptureFrame& frame, uint8_t* out);
+  static uint32_t encode_stats(const StatsFrame& frame, uint8_t* out);
+  static uint32_t encode_link_sync(const LinkSyncFrame& frame, uint8_t* out);
+  static uint32_t encode_link_events(const LinkEventsFrame& frame, uint8_t* out);
+
+  //Parses a decoded (un-COBSed) frame. Returns false if the CRC or layout is wrong
+  static bool parse_header(const uint8_t* data, uint32_t length, Header& header);
+  static bool parse_angles(const uint8_t* data, uint32_t length, AnglesFrame& frame);
+  static bool parse_pose(const uint8_t* data, uint32_t length, PoseFrame& frame);
+  static bool parse_capture(const uint8_t* data, uint32_t length, CaptureFrame& frame);
+  static bool parse_stats(const uint8_t* data, uint32_t length, StatsFrame& frame);
+  static bool parse_link_sync(const uint8_t* data, uint32_t length, LinkSyncFrame& frame);
+  static bool parse_link_events(const uint8_t* data, uint32_t length, LinkEventsFrame& frame);
+
+protected:
+  static void put_u16(uint8_t* out, uint16_t value);
+  static void put_u32(uint8_t* out, uint32_t value);
+  static uint16_t get_u16(const uint8_t* data);
+  static uint32_t get_u32(const uint8_t* data);
+  static uint32_t put_header(const Header& header, uint8_t* out);
+  static uint32_t finish(uint8_t* raw, uint32_t length, uint8_t* out);
+  static bool check_crc(const uint8_t* data, uint32_t length);
+};
@@ -0,0 +1,53 @@
+#include "FrameReader.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FrameReader::FrameReader(FrameFunc on_frame, void* context) :
+  on_frame(on_frame), context(context) {
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameReader::feed(const uint8_t* data, uint32_t length) {
+  for(uint32_t i = 0; i < length; i++) {
+    if(data[i] == 0) {
+      end_frame();
+    }
+    else if(pending_length < sizeof(pending)) {
+      pending[pending_length++] = data[i];
+    }
+    else {
+      overflowed = true;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameReader::end_frame() {
+  if(pending_length > 0 || overflowed) {
+    uint8_t decoded[FrameCodec::MAX_ENCODED_SIZE];
+    uint32_t decoded_length = overflowed ? 0 : FrameCodec::cobs_decode(pending, pending_length, decoded, sizeof(decoded));
+
+    FrameCodec::Header header;
+    if(decoded_length > 0 && FrameCodec::parse_header(decoded, decoded_length, header)) {
+      if(have_sequence) {
+        lost_frames += (uint16_t)(header.sequence - last_sequence - 1);
+      }
+      have_sequence = true;
+      last_sequence = header.sequence;
+      frames++;
+      on_frame(decoded, decoded_length, context);
+    }
+    else {
+      bad_frames++;
+    }
+  }
+  pending_length = 0;
+  overflowed = false;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include "FrameCodec.hpp"
+
+// Splits a TinyTracker binary output stream into frames.
+//
+// Bytes can be fed in any sized chunks. Each zero delimited frame is COBS decoded
+// and CRC checked; anything corrupt is counted and skipped, so the reader picks
+// the stream back up at the next delimiter.
+class FrameReader {
+  //--------------------------------------------------
+  // Types
+  //--------------------------------------------------
+public:
+  //Called with each valid, decoded frame (header, payload and CRC)
+  typedef void (*FrameFunc)(const uint8_t* data, uint32_t length, void* context);
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  FrameFunc on_frame;
+  void* context;
+
+  uint8_t pending[FrameCodec::MAX_ENCODED_SIZE];
+  uint32_t pending_length = 0;
+  bool overflowed = false;
+
+  uint32_t frames = 0;
+  uint32_t bad_frames = 0;
+  uint32_t lost_frames = 0;
+  bool have_sequence = false;
+  uint16_t last_sequence = 0;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  FrameReader(FrameFunc on_frame, void* context = nullptr);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  void feed(const uint8_t* data, uint32_t length);
+
+  uint32_t frame_count() const { return frames; }
+  uint32_t bad_count() const { return bad_frames; }
+  uint32_t lost_count() const { return lost_frames; }   //Gaps in the sequence numbers
+private:
+  void end_frame();
+};
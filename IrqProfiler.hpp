@@ -0,0 +1,63 @@
+#pragma once
+
+#include "pico/stdlib.h"
+#include "hardware/structs/systick.h"
+#include "TrackerStats.hpp"
+
+// Measures the time spent in the capture interrupts, in system clock cycles, using the
+// core's SysTick counter. Each core has its own SysTick, so begin() must be called on
+// the core the interrupts run on. The same counter times the decode and output stages.
+//
+// Costs two register reads and a histogram update per interrupt, and nothing at all
+// when TrackerStats are compiled out. Written only from interrupts, and read as a
+// snapshot elsewhere
+class IrqProfiler {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint32_t SYSTICK_MASK = 0xffffff;    //SysTick is a 24 bit down counter
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  CycleHistogram histogram;
+  volatile uint32_t pulse_count = 0;
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Free-runs SysTick from the processor clock, with no interrupt
+  static void begin() {
+    if(TrackerStats::ENABLED && (systick_hw->csr & 0x1) == 0) {
+      systick_hw->rvr = SYSTICK_MASK;
+      systick_hw->cvr = 0;
+      systick_hw->csr = 0x5;
+    }
+  }
+
+  static inline uint32_t now() { return TrackerStats::ENABLED ? systick_hw->cvr : 0; }
+
+  //Cycles since a now(), for spans under 2^24 cycles (134ms at 125MHz)
+  static inline uint32_t elapsed(uint32_t start) { return (start - systick_hw->cvr) & SYSTICK_MASK; }
+
+  //Records one interrupt that started at the given now() and handled the given number of pulses
+  inline void record(uint32_t start, uint32_t pulses) {
+    if(TrackerStats::ENABLED) {
+      histogram.record(elapsed(start));
+      pulse_count = pulse_count + pulses;
+    }
+  }
+
+  void reset() { histogram.reset(); pulse_count = 0; }
+
+  const CycleHistogram& cycles() const { return histogram; }
+  uint32_t max() const { return histogram.max(); }
+  uint32_t calls() const { return histogram.count(); }
+  uint32_t pulses() const { return pulse_count; }
+  uint32_t cycles_per_pulse() const { return pulse_count > 0 ? histogram.cycles() / pulse_count : 0; }
+};
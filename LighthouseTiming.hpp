@@ -0,0 +1,161 @@
+#pragma once
+
+#include <stdint.h>
+
+// The clock the PIO state machines are derived from, and the divider applied to them.
+// Both can be overridden from the build so the timing below always follows the hardware
+#ifndef LIGHTHOUSE_SYS_CLOCK_HZ
+#define LIGHTHOUSE_SYS_CLOCK_HZ 125000000
+#endif
+
+#ifndef LIGHTHOUSE_FREQ_DIVIDER
+#define LIGHTHOUSE_FREQ_DIVIDER 1
+#endif
+
+// Compile-time timing constants for turning lighthouse PIO words into sync data and
+// sweep angles using integer maths only (the RP2040 has no FPU).
+//
+// Everything is derived from the system clock, the 15 cycle counting loop in
+// lighthouse.pio and the frequency divider, so changing any of them keeps the
+// decode correct rather than relying on hand-computed magic numbers. Words from
+// lighthouse_hires.pio keep the same count units, with extra fractional bits.
+class LighthouseTiming {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static constexpr uint32_t SYS_CLOCK_HZ          = LIGHTHOUSE_SYS_CLOCK_HZ;
+  static constexpr uint16_t FREQ_DIVIDER          = LIGHTHOUSE_FREQ_DIVIDER;
+  static constexpr uint32_t PIO_LOOP_CYCLES       = 15;     //Cycles per count of the lighthouse program's timer
+  static constexpr uint32_t HIRES_LOOP_CYCLES     = 2;      //Cycles per tick of the lighthouse_hires program's timer
+  static constexpr uint32_t LH_TICK_HZ            = 48000000;
+
+  //Lighthouse 1.0 protocol constants, from the original float decode
+  static constexpr uint32_t SYNC_BASE_TICKS       = 2751;   //Sync pulse length (in 48MHz ticks) encoding 0b000
+  static constexpr uint32_t SYNC_STEP_TICKS       = 500;    //Additional ticks per increment of the sync data
+  static constexpr uint32_t CSYNC_MIN_NS          = 50000;  //Pulses longer than this later in a window are syncs
+  static constexpr uint32_t SWEEP_CENTER_NS       = 4000000;
+  static constexpr uint32_t SWEEP_HALF_RANGE_NS   = 4000000;
+  static constexpr uint32_t SWEEP_HALF_RANGE_DEG  = 90;
+
+  static constexpr uint8_t ANGLE_FRACTION_BITS    = 16;     //Angles are in degrees, as signed Q16.16
+  static constexpr uint8_t MAX_SYNC_DATA          = 7;
+
+  static constexpr uint8_t TAG_SYNC_DATA          = 0x07;
+  static constexpr uint8_t TAG_CSYNC              = 0x08;
+
+  //Picoseconds per count of the PIO timer (120000 at 125MHz and a divider of 1)
+  static constexpr uint64_t PS_PER_COUNT = (uint64_t)PIO_LOOP_CYCLES * FREQ_DIVIDER * 1000000000000ull / SYS_CLOCK_HZ;
+
+  static_assert(PS_PER_COUNT > 0, "PIO timer count is shorter than a picosecond");
+  static_assert(PS_PER_COUNT * 0xffff < 0xffffffffull * 1000, "A counting window no longer fits in 32bit nanoseconds");
+  static_assert(PS_PER_COUNT < (UINT64_MAX / SWEEP_HALF_RANGE_DEG) >> (ANGLE_FRACTION_BITS + 16), "Divider too large for the angle scale");
+
+  //Microseconds per count as Q16, for turning offsets within a window into absolute times
+  static constexpr uint64_t US_PER_COUNT_Q16 = (PS_PER_COUNT << 16) / 1000000;
+
+  //Pulses at least this many counts long are C-syncs
+  static constexpr uint32_t CSYNC_MIN_COUNTS = (uint32_t)((uint64_t)CSYNC_MIN_NS * 1000 / PS_PER_COUNT) + 1;
+
+  //Sweep times are kept as start + end counts (the midpoint in half-counts) with 3 fractional
+  //bits, enough for the high resolution program's ticks. The sweep centre is held in the same
+  //units with 8 fractional bits
+  static constexpr uint8_t MID2_FRACTION_BITS   = 3;
+  static constexpr uint8_t CENTER_FRACTION_BITS = 8;
+  static constexpr int64_t SWEEP_CENTER_MID2_Q8 = (int64_t)(((uint64_t)SWEEP_CENTER_NS * 2000 << CENTER_FRACTION_BITS) / PS_PER_COUNT);
+
+  //High resolution pulse words hold the start as Q3 counts in their top 19 bits, so the top 16
+  //are its whole counts just like lighthouse.pio's words. Below it, a pulse short enough (every
+  //sweep) keeps its length as Q3 counts, so its end is as fine as its start. A longer one (a
+  //sync) only needs its length for its tag, so keeps whole counts with HIRES_LONG set
+  static constexpr uint8_t HIRES_LENGTH_BITS    = 13;
+  static constexpr uint32_t HIRES_LONG          = 1u << (HIRES_LENGTH_BITS - 1);
+  static constexpr uint32_t HIRES_VALUE_MASK    = HIRES_LONG - 1;
+
+  //Q16 degrees per Q8 half-count, with 16 further fractional bits to keep precision
+  static constexpr int64_t ANGLE_SCALE_Q16 = (int64_t)((((uint64_t)SWEEP_HALF_RANGE_DEG << (ANGLE_FRACTION_BITS + 16)) * PS_PER_COUNT)
+                                                       / ((uint64_t)SWEEP_HALF_RANGE_NS * 2000 << CENTER_FRACTION_BITS));
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  static constexpr uint32_t word_start(uint32_t word) { return word >> 16; }
+  static constexpr uint32_t word_end(uint32_t word) { return word & 0xffff; }
+
+  //The start + end of a lighthouse.pio word, with MID2_FRACTION_BITS
+  static constexpr uint32_t word_mid2(uint32_t word) { return (word_start(word) + word_end(word)) << MID2_FRACTION_BITS; }
+
+  //Twice the start, in the same units as the mid2, for timing sweeps from a sync later in the window
+  static constexpr uint32_t word_start2(uint32_t word) { return word_start(word) << (MID2_FRACTION_BITS + 1); }
+
+  static constexpr uint32_t hires_word(uint32_t start_q3, uint32_t end_q3) {
+    uint32_t length_q3 = end_q3 - start_q3;
+    if(length_q3 < HIRES_LONG)
+      return (start_q3 << HIRES_LENGTH_BITS) | length_q3;
+    uint32_t length = length_q3 >> MID2_FRACTION_BITS;
+    return (start_q3 << HIRES_LENGTH_BITS) | HIRES_LONG | (length < HIRES_VALUE_MASK ? length : HIRES_VALUE_MASK);
+  }
+  static constexpr uint32_t hires_length(uint32_t word) {
+    return (word & HIRES_LONG) ? (word & HIRES_VALUE_MASK) : (word & HIRES_VALUE_MASK) >> MID2_FRACTION_BITS;
+  }
+  static constexpr uint32_t hires_start2(uint32_t word) { return (word >> HIRES_LENGTH_BITS) << 1; }
+  static constexpr uint32_t hires_mid2(uint32_t word) {
+    return ((word >> HIRES_LENGTH_BITS) << 1)
+           + ((word & HIRES_LONG) ? (word & HIRES_VALUE_MASK) << MID2_FRACTION_BITS : (word & HIRES_VALUE_MASK));
+  }
+
+  static constexpr uint32_t counts_to_ns(uint32_t counts) {
+    return (uint32_t)((uint64_t)counts * PS_PER_COUNT / 1000);
+  }
+
+  static constexpr uint32_t counts_to_us(uint32_t counts) {
+    return (uint32_t)(((uint64_t)counts * US_PER_COUNT_Q16) >> 16);
+  }
+
+  //The shortest pulse, in counts, whose sync data is at least the given value
+  static constexpr uint32_t sync_threshold_counts(uint8_t sync_data) {
+    return (uint32_t)((((uint64_t)SYNC_BASE_TICKS + (uint64_t)SYNC_STEP_TICKS * sync_data) * 1000000000000ull
+                       + (uint64_t)LH_TICK_HZ * PS_PER_COUNT - 1) / ((uint64_t)LH_TICK_HZ * PS_PER_COUNT));
+  }
+
+  //A pulse's tag, from its length alone: the 3 bit sync data (axis, data, skip) it would encode
+  //as a sync, and whether it is long enough to be a C-sync. One table lookup, see PULSE_TAGS
+  static inline uint8_t pulse_tag(uint32_t length_counts);
+
+  static inline uint8_t sync_data(uint32_t length_counts) { return pulse_tag(length_counts) & TAG_SYNC_DATA; }
+
+  //Converts a sweep midpoint (start + end counts, with MID2_FRACTION_BITS) to a Q16.16 angle in degrees
+  static inline int32_t mid2_to_angle(uint32_t mid2) {
+    int64_t delta = ((int64_t)mid2 << (CENTER_FRACTION_BITS - MID2_FRACTION_BITS)) - SWEEP_CENTER_MID2_Q8;
+    return (int32_t)((delta * ANGLE_SCALE_Q16) >> 16);
+  }
+
+  static constexpr int32_t angle_from_degrees(int32_t degrees) { return degrees * (1 << ANGLE_FRACTION_BITS); }
+};
+
+// The tag of every pulse length up to the longest that changes it, built at compile time so
+// classifying a pulse never loops over the sync thresholds. About 1KB at the default clock
+struct LighthousePulseTags {
+  static constexpr uint32_t LONGEST = LighthouseTiming::sync_threshold_counts(LighthouseTiming::MAX_SYNC_DATA) > LighthouseTiming::CSYNC_MIN_COUNTS
+                                    ? LighthouseTiming::sync_threshold_counts(LighthouseTiming::MAX_SYNC_DATA) : LighthouseTiming::CSYNC_MIN_COUNTS;
+  static constexpr uint32_t SIZE = LONGEST + 1;   //Anything longer has the same tag as LONGEST
+
+  uint8_t tags[SIZE];
+
+  constexpr LighthousePulseTags() : tags() {
+    for(uint32_t length = 0; length < SIZE; length++) {
+      uint8_t data = 0;
+      while(data < LighthouseTiming::MAX_SYNC_DATA && length >= LighthouseTiming::sync_threshold_counts(data + 1))
+        data++;
+      tags[length] = data | (length >= LighthouseTiming::CSYNC_MIN_COUNTS ? LighthouseTiming::TAG_CSYNC : 0);
+    }
+  }
+};
+
+inline constexpr LighthousePulseTags PULSE_TAGS;
+
+inline uint8_t LighthouseTiming::pulse_tag(uint32_t length_counts) {
+  return PULSE_TAGS.tags[length_counts < LighthousePulseTags::SIZE ? length_counts : LighthousePulseTags::LONGEST];
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+// The serial link between chained trackers, as TrackerLink sees it: LinkUart on the
+// board, or a pipe or pty on the host.
+//
+// Reads hand over what has arrived up to and including the next frame delimiter (a
+// zero byte), with the time that delimiter arrived in the local clock. Writes never
+// block, taking only what can be queued. Beacons are timed from the moment they are
+// written, so tx_idle() must only be true once everything written before has left
+class LinkPort {
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  virtual ~LinkPort() {}
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Takes up to max_length received bytes, stopping after the first zero. time_us is set to
+  //when that zero arrived, or to now if there was none
+  virtual uint32_t read(uint8_t* data, uint32_t max_length, uint32_t& time_us) = 0;
+
+  //Queues up to length bytes to send. Returns how many were taken
+  virtual uint32_t write(const uint8_t* data, uint32_t length) = 0;
+
+  //Whether everything written has been sent, so the next byte written goes straight out
+  virtual bool tx_idle() const = 0;
+
+  //The local clock, as time_us_32()
+  virtual uint32_t time_us() const = 0;
+};
@@ -0,0 +1,109 @@
+#include <string.h>
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "pico/stdio_uart.h"
+#include "LinkUart.hpp"
+#include "PowerManager.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// STATICS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uart_inst_t* LinkUart::irq_uart = nullptr;
+PulseRing<uint8_t, LinkUart::RX_CAPACITY> LinkUart::rx_bytes;
+PulseRing<uint32_t, LinkUart::DELIMITER_CAPACITY> LinkUart::delimiter_times;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//Runs from RAM, as the delimiter times are only as good as its latency
+void __not_in_flash_func(LinkUart::rx_interrupt_callback)() {
+  while(uart_is_readable(irq_uart)) {
+    uint8_t value = (uint8_t)uart_get_hw(irq_uart)->dr;
+    if(rx_bytes.push(value) && value == 0) {
+      delimiter_times.push(time_us_32());
+    }
+  }
+  PowerManager::signal();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+LinkUart::LinkUart(uart_inst_t* uart, uint tx_pin, uint rx_pin, uint32_t baud) :
+  uart(uart), tx_pin(tx_pin), rx_pin(rx_pin), baud(baud) {
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LinkUart::init() {
+  dma_channel = dma_claim_unused_channel(false);
+  if(dma_channel < 0) {
+    return false;
+  }
+
+  //stdio would otherwise print into the middle of the frames
+#ifdef uart_default
+  if(uart == uart_default) {
+    stdio_set_driver_enabled(&stdio_uart, false);
+  }
+#endif
+
+  uart_init(uart, baud);
+  gpio_set_function(tx_pin, GPIO_FUNC_UART);
+  gpio_set_function(rx_pin, GPIO_FUNC_UART);
+  uart_set_fifo_enabled(uart, false);
+
+  dma_channel_config config = dma_channel_get_default_config(dma_channel);
+  channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+  channel_config_set_read_increment(&config, true);
+  channel_config_set_write_increment(&config, false);
+  channel_config_set_dreq(&config, uart_get_dreq(uart, true));
+  dma_channel_configure(dma_channel, &config, &uart_get_hw(uart)->dr, tx_buffer, 0, false);
+
+  irq_uart = uart;
+  uint irq_num = (uart == uart0) ? UART0_IRQ : UART1_IRQ;
+  irq_set_exclusive_handler(irq_num, rx_interrupt_callback);
+  irq_set_enabled(irq_num, true);
+  uart_set_irq_enables(uart, true, false);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t LinkUart::read(uint8_t* data, uint32_t max_length, uint32_t& time_us) {
+  uint32_t length = 0;
+  while(length < max_length && rx_bytes.pop(data[length])) {
+    if(data[length++] == 0) {
+      if(!delimiter_times.pop(time_us)) {
+        time_us = time_us_32();
+      }
+      return length;
+    }
+  }
+  time_us = time_us_32();
+  return length;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t LinkUart::write(const uint8_t* data, uint32_t length) {
+  if(dma_channel < 0 || dma_channel_is_busy(dma_channel)) {
+    return 0;
+  }
+
+  if(length > TX_BUFFER_SIZE) {
+    length = TX_BUFFER_SIZE;
+  }
+  memcpy(tx_buffer, data, length);
+  dma_channel_transfer_from_buffer_now(dma_channel, tx_buffer, length);
+  return length;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LinkUart::tx_idle() const {
+  //The UART stays busy until the last stop bit has gone
+  return dma_channel >= 0 && !dma_channel_is_busy(dma_channel) && !(uart_get_hw(uart)->fr & UART_UARTFR_BUSY_BITS);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
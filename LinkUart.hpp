@@ -0,0 +1,66 @@
+#pragma once
+
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+#include "LinkPort.hpp"
+#include "PulseRing.hpp"
+
+// The board's end of the tracker link (see TrackerLink): a UART whose received bytes are
+// queued by an interrupt, and which sends from a buffer by DMA.
+//
+// The UART's FIFOs are turned off, so every byte interrupts as its stop bit arrives and
+// each frame delimiter is timed to within the interrupt latency, rather than whenever the
+// FIFO level or timeout next fires. That costs an interrupt per byte received, around a
+// microsecond each. Sending by DMA keeps the line busy without one per byte sent.
+//
+// The interrupt handler and its rings are shared, so there can only be one
+class LinkUart : public LinkPort {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint32_t RX_CAPACITY         = 1024;
+  static const uint32_t DELIMITER_CAPACITY  = 64;
+  static const uint32_t TX_BUFFER_SIZE      = 256;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  uart_inst_t* const uart;
+  const uint tx_pin;
+  const uint rx_pin;
+  const uint32_t baud;
+
+  int dma_channel = -1;
+  uint8_t tx_buffer[TX_BUFFER_SIZE];
+
+  static uart_inst_t* irq_uart;
+  static PulseRing<uint8_t, RX_CAPACITY> rx_bytes;
+  static PulseRing<uint32_t, DELIMITER_CAPACITY> delimiter_times;   //When each zero in rx_bytes arrived
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  LinkUart(uart_inst_t* uart, uint tx_pin, uint rx_pin, uint32_t baud);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Takes the UART from stdio, if it had it. Returns false if no DMA channel was free
+  bool init();
+
+  uint32_t read(uint8_t* data, uint32_t max_length, uint32_t& time_us) override;
+  uint32_t write(const uint8_t* data, uint32_t length) override;
+  bool tx_idle() const override;
+  uint32_t time_us() const override { return time_us_32(); }
+
+  uint32_t dropped_bytes() const { return rx_bytes.dropped_count(); }   //Received with the ring full
+private:
+  static void rx_interrupt_callback();
+};
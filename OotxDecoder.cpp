@@ -0,0 +1,155 @@
+#include "OotxDecoder.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool OotxDecoder::feed(uint8_t bit) {
+  bit &= 1;
+
+  //A run of 17 zeros can only be a preamble, as data always has a sync bit every 16
+  if(bit == 0) {
+    if(zeros < PREAMBLE_ZEROS)
+      zeros++;
+  }
+  else {
+    bool preamble = (zeros >= PREAMBLE_ZEROS);
+    zeros = 0;
+    if(preamble) {
+      //This 1 ends the preamble, and acts as the first sync bit
+      in_frame = true;
+      word_bits = 0;
+      bit_count = 0;
+      payload_length = 0;
+      return false;
+    }
+  }
+
+  if(!in_frame)
+    return false;
+
+  if(word_bits == 16) {
+    //Expecting a sync bit
+    word_bits = 0;
+    if(bit == 0) {
+      in_frame = false;
+      bad_frames++;
+    }
+    return false;
+  }
+
+  uint16_t byte = bit_count >> 3;
+  if((bit_count & 7) == 0)
+    buffer[byte] = 0;
+  buffer[byte] |= bit << (7 - (bit_count & 7));
+  bit_count++;
+  word_bits++;
+
+  if(bit_count == 16) {
+    payload_length = buffer[0] | (buffer[1] << 8);
+    if(payload_length > MAX_PAYLOAD) {
+      in_frame = false;
+      bad_frames++;
+    }
+  }
+  else if(bit_count > 16) {
+    uint16_t padded = (payload_length + 1) & ~1;
+    if(bit_count == (2 + padded + 4) * 8) {
+      in_frame = false;
+      return finish_frame();
+    }
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void OotxDecoder::reset() {
+  zeros = 0;
+  in_frame = false;
+  info_valid = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t OotxDecoder::crc32(const uint8_t* data, uint32_t length) {
+  //Bitwise as it is only run once per frame
+  uint32_t crc = 0xffffffff;
+  for(uint32_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for(uint8_t b = 0; b < 8; b++) {
+      crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int32_t OotxDecoder::half_to_q16(uint16_t half) {
+  uint32_t exponent = (half >> 10) & 0x1f;
+  uint32_t mantissa = half & 0x3ff;
+  int32_t value;
+
+  if(exponent == 0x1f) {
+    value = 0;  //Infinity or NaN, which are not meaningful calibration
+  }
+  else if(exponent == 0) {
+    value = (int32_t)(mantissa >> 8);   //Subnormal, m * 2^-24
+  }
+  else {
+    //(1024 + m) * 2^(e - 25), scaled by 2^16
+    uint32_t significand = 1024 + mantissa;
+    if(exponent >= 9)
+      value = (exponent - 9 >= 21) ? INT32_MAX : (int32_t)(significand << (exponent - 9));
+    else
+      value = (int32_t)(significand >> (9 - exponent));
+  }
+  return (half & 0x8000) ? -value : value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool OotxDecoder::parse_info(const uint8_t* p, uint16_t length, LighthouseInfo& info) {
+  if(length < INFO_PAYLOAD_SIZE)
+    return false;
+
+  auto u16 = [p](uint8_t offset) { return (uint16_t)(p[offset] | (p[offset + 1] << 8)); };
+
+  info.firmware_version = u16(0);
+  info.id = (uint32_t)p[2] | ((uint32_t)p[3] << 8) | ((uint32_t)p[4] << 16) | ((uint32_t)p[5] << 24);
+  info.phase[0] = half_to_q16(u16(6));
+  info.phase[1] = half_to_q16(u16(8));
+  info.tilt[0] = half_to_q16(u16(10));
+  info.tilt[1] = half_to_q16(u16(12));
+  info.unlock_count = p[14];
+  info.hardware_version = p[15];
+  info.curve[0] = half_to_q16(u16(16));
+  info.curve[1] = half_to_q16(u16(18));
+  info.accel_dir[0] = (int8_t)p[20];
+  info.accel_dir[1] = (int8_t)p[21];
+  info.accel_dir[2] = (int8_t)p[22];
+  info.gib_phase[0] = half_to_q16(u16(23));
+  info.gib_phase[1] = half_to_q16(u16(25));
+  info.gib_magnitude[0] = half_to_q16(u16(27));
+  info.gib_magnitude[1] = half_to_q16(u16(29));
+  info.mode = p[31];
+  info.faults = p[32];
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool OotxDecoder::finish_frame() {
+  const uint8_t* payload = buffer + 2;
+  uint16_t padded = (payload_length + 1) & ~1;
+  const uint8_t* c = payload + padded;
+  uint32_t expected = (uint32_t)c[0] | ((uint32_t)c[1] << 8) | ((uint32_t)c[2] << 16) | ((uint32_t)c[3] << 24);
+
+  LighthouseInfo parsed;
+  if(crc32(payload, payload_length) != expected || !parse_info(payload, payload_length, parsed)) {
+    bad_frames++;
+    return false;
+  }
+
+  info = parsed;
+  info_valid = true;
+  frames++;
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
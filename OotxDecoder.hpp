@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+// The base station information block a Lighthouse 1.0 broadcasts over OOTX.
+// Calibration values are converted from half floats to Q16.16 (radians for the
+// phase, tilt and gib phase terms)
+struct LighthouseInfo {
+  uint16_t firmware_version;
+  uint32_t id;
+  int32_t phase[2];
+  int32_t tilt[2];
+  int32_t curve[2];
+  int32_t gib_phase[2];
+  int32_t gib_magnitude[2];
+  int8_t accel_dir[3];
+  uint8_t hardware_version;
+  uint8_t unlock_count;
+  uint8_t mode;
+  uint8_t faults;
+};
+
+// Assembles OOTX frames from the data bit of each of a lighthouse's sync pulses.
+//
+// A frame is a preamble of 17 zeros, then a 16 bit little-endian payload length, the
+// payload (padded to a whole 16 bit word) and a CRC-32 of the payload, with a 1 sync
+// bit inserted after every 16 bits. Bits are fed in one at a time as sync pulses are
+// decoded, so the cost per pulse is a few instructions; a frame takes several seconds
+// to arrive. Corrupt frames are dropped and the decoder waits for the next preamble
+class OotxDecoder {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint8_t PREAMBLE_ZEROS       = 17;
+  static const uint16_t MAX_PAYLOAD         = 64;
+  static const uint16_t INFO_PAYLOAD_SIZE   = 33;   //Version 6 base station info
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  uint8_t zeros = 0;              //Consecutive zero bits seen, for spotting the preamble
+  bool in_frame = false;
+  uint8_t word_bits = 0;          //Data bits since the last sync bit
+  uint16_t bit_count = 0;         //Data bits of the frame received so far
+  uint16_t payload_length = 0;
+  uint8_t buffer[2 + MAX_PAYLOAD + 4];
+
+  LighthouseInfo info;
+  bool info_valid = false;
+  uint32_t frames = 0;
+  uint32_t bad_frames = 0;
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Feeds in the next data bit. Returns true when it completes a valid frame
+  bool feed(uint8_t bit);
+
+  bool has_info() const { return info_valid; }
+  const LighthouseInfo& lighthouse_info() const { return info; }
+  uint32_t frame_count() const { return frames; }
+  uint32_t bad_count() const { return bad_frames; }
+  void reset();
+
+  static uint32_t crc32(const uint8_t* data, uint32_t length);
+  static int32_t half_to_q16(uint16_t half);
+  static bool parse_info(const uint8_t* payload, uint16_t length, LighthouseInfo& info);
+private:
+  bool finish_frame();
+};
@@ -0,0 +1,443 @@
+#include "PoseSolver.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// TANGENT TABLE
+////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+  const int32_t TAN_STEPS_PER_DEG   = 4;
+  const int32_t TAN_MAX_DEG         = 80;
+  const int32_t TAN_ENTRIES         = TAN_MAX_DEG * TAN_STEPS_PER_DEG + 1;
+
+  struct TanTable {
+    int32_t values[TAN_ENTRIES];
+  };
+
+  //Series sin/cos are plenty accurate over 0-80 degrees, and let the table be built at compile time
+  constexpr double const_sin(double x) {
+    double term = x, sum = x;
+    for(int n = 1; n < 15; n++) {
+      term *= -x * x / ((2 * n) * (2 * n + 1));
+      sum += term;
+    }
+    return sum;
+  }
+
+  constexpr double const_cos(double x) {
+    double term = 1.0, sum = 1.0;
+    for(int n = 1; n < 15; n++) {
+      term *= -x * x / ((2 * n - 1) * (2 * n));
+      sum += term;
+    }
+    return sum;
+  }
+
+  constexpr TanTable make_tan_table() {
+    TanTable table = {};
+    for(int32_t i = 0; i < TAN_ENTRIES; i++) {
+      double radians = (double)i / TAN_STEPS_PER_DEG * 3.14159265358979323846 / 180.0;
+      table.values[i] = (int32_t)(const_sin(radians) / const_cos(radians) * 65536.0 + 0.5);
+    }
+    return table;
+  }
+
+  constexpr TanTable TAN_TABLE = make_tan_table();
+
+  inline int32_t mul_q16(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a * b) >> 16);
+  }
+
+  inline int32_t mul_q30(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a * b) >> 30);
+  }
+
+  inline int32_t clamp(int32_t value, int32_t limit) {
+    return value > limit ? limit : (value < -limit ? -limit : value);
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PoseSolver::PoseSolver() {
+  for(uint8_t i = 0; i < 3; i++) {
+    current.position[i] = 0;
+    for(uint8_t j = 0; j < 3; j++) {
+      current.rotation[i][j] = (i == j) ? ONE_Q30 : 0;
+    }
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PoseSolver::set_geometry_um(const int32_t (*positions)[3], uint8_t count) {
+  num_sensors = count < MAX_SENSORS ? count : MAX_SENSORS;
+  for(uint8_t s = 0; s < num_sensors; s++) {
+    for(uint8_t i = 0; i < 3; i++) {
+      model[s][i] = (int32_t)(((int64_t)positions[s][i] << 16) / 1000000);
+    }
+  }
+  tracking = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PoseSolver::Result PoseSolver::solve(const int32_t* x_angles, const int32_t* y_angles, uint32_t valid_mask) {
+  int32_t u[MAX_SENSORS];
+  int32_t v[MAX_SENSORS];
+  uint8_t index[MAX_SENSORS];
+  uint8_t count = 0;
+
+  for(uint8_t s = 0; s < num_sensors; s++) {
+    if(valid_mask & (1u << s)) {
+      u[count] = angle_to_tangent(x_angles[s]);
+      v[count] = angle_to_tangent(y_angles[s]);
+      index[count] = s;
+      count++;
+    }
+  }
+
+  last_iterations = 0;
+  if(count < MIN_SENSORS)
+    return SOLVE_TOO_FEW_SENSORS;
+
+  Pose previous = current;
+  uint8_t max_iterations = WARM_ITERATIONS;
+  if(!tracking) {
+    cold_start(u, v, index, count);
+    max_iterations = COLD_ITERATIONS;
+  }
+
+  bool converged = false;
+  while(last_iterations < max_iterations && !converged) {
+    last_iterations++;
+    if(!iterate(u, v, index, count, converged)) {
+      current = previous;
+      tracking = false;
+      return SOLVE_DIVERGED;
+    }
+  }
+
+  //Measure how well the final pose fits
+  int64_t sum = 0;
+  for(uint8_t i = 0; i < count; i++) {
+    int32_t pu, pv;
+    if(!project(current, model[index[i]], pu, pv)) {
+      current = previous;
+      tracking = false;
+      return SOLVE_DIVERGED;
+    }
+    sum += (int64_t)(u[i] - pu) * (u[i] - pu) + (int64_t)(v[i] - pv) * (v[i] - pv);
+  }
+  last_residual = (int32_t)isqrt64((uint64_t)(sum / (2 * count)));
+
+  if(last_residual > MAX_RESIDUAL) {
+    tracking = false;
+    return SOLVE_DIVERGED;
+  }
+
+  tracking = true;
+  return SOLVE_OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PoseSolver::project(const Pose& pose, const int32_t point[3], int32_t& u, int32_t& v) const {
+  int32_t p[3];
+  for(uint8_t i = 0; i < 3; i++) {
+    p[i] = mul_q30(pose.rotation[i][0], point[0]) + mul_q30(pose.rotation[i][1], point[1])
+         + mul_q30(pose.rotation[i][2], point[2]) + pose.position[i];
+  }
+  if(p[2] < MIN_DEPTH)
+    return false;
+
+  u = (int32_t)(((int64_t)p[0] << 16) / p[2]);
+  v = (int32_t)(((int64_t)p[1] << 16) / p[2]);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int32_t PoseSolver::angle_to_tangent(int32_t angle) {
+  bool negative = angle < 0;
+  uint32_t magnitude = negative ? -angle : angle;
+
+  //Position in table steps, with 16 fractional bits
+  uint64_t position = (uint64_t)magnitude * TAN_STEPS_PER_DEG;
+  uint32_t i = (uint32_t)(position >> 16);
+  int32_t tangent;
+  if(i >= (uint32_t)TAN_ENTRIES - 1) {
+    tangent = TAN_TABLE.values[TAN_ENTRIES - 1];
+  }
+  else {
+    int32_t fraction = (int32_t)(position & 0xffff);
+    int32_t a = TAN_TABLE.values[i];
+    int32_t b = TAN_TABLE.values[i + 1];
+    tangent = a + mul_q16(b - a, fraction);
+  }
+  return negative ? -tangent : tangent;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int32_t PoseSolver::tangent_to_angle(int32_t tangent) {
+  bool negative = tangent < 0;
+  int32_t magnitude = negative ? -tangent : tangent;
+
+  int32_t angle;
+  if(magnitude >= TAN_TABLE.values[TAN_ENTRIES - 1]) {
+    angle = TAN_MAX_DEG << 16;
+  }
+  else {
+    int32_t low = 0, high = TAN_ENTRIES - 1;
+    while(high - low > 1) {
+      int32_t mid = (low + high) / 2;
+      if(TAN_TABLE.values[mid] <= magnitude)
+        low = mid;
+      else
+        high = mid;
+    }
+    int32_t a = TAN_TABLE.values[low];
+    int32_t b = TAN_TABLE.values[high];
+    int32_t fraction = (int32_t)(((int64_t)(magnitude - a) << 16) / (b - a));
+    angle = (low << 16) / TAN_STEPS_PER_DEG + fraction / TAN_STEPS_PER_DEG;
+  }
+  return negative ? -angle : angle;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t PoseSolver::isqrt64(uint64_t value) {
+  uint64_t result = 0;
+  uint64_t bit = 1ull << 62;
+  while(bit > value)
+    bit >>= 2;
+
+  while(bit != 0) {
+    if(value >= result + bit) {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    }
+    else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PoseSolver::cold_start(const int32_t* u, const int32_t* v, const uint8_t* index, uint8_t count) {
+  //Assume the constellation faces the lighthouse, and estimate its distance from how
+  //spread out the sensors appear compared to how spread out they really are
+  int64_t mean_u = 0, mean_v = 0, mean_x = 0, mean_y = 0;
+  for(uint8_t i = 0; i < count; i++) {
+    mean_u += u[i];
+    mean_v += v[i];
+    mean_x += model[index[i]][0];
+    mean_y += model[index[i]][1];
+  }
+  mean_u /= count;
+  mean_v /= count;
+  mean_x /= count;
+  mean_y /= count;
+
+  int64_t image_spread = 0, model_spread = 0;
+  for(uint8_t i = 0; i < count; i++) {
+    int64_t du = u[i] - mean_u, dv = v[i] - mean_v;
+    int64_t dx = model[index[i]][0] - mean_x, dy = model[index[i]][1] - mean_y;
+    image_spread += du * du + dv * dv;
+    model_spread += dx * dx + dy * dy;
+  }
+
+  int32_t depth = DEFAULT_DEPTH;
+  uint32_t image_rms = isqrt64((uint64_t)image_spread);
+  uint32_t model_rms = isqrt64((uint64_t)model_spread);
+  if(image_rms > 0 && model_rms > 0) {
+    depth = (int32_t)(((uint64_t)model_rms << 16) / image_rms);
+    if(depth < MIN_DEPTH * 2)
+      depth = MIN_DEPTH * 2;
+  }
+
+  for(uint8_t i = 0; i < 3; i++) {
+    for(uint8_t j = 0; j < 3; j++) {
+      current.rotation[i][j] = (i == j) ? ONE_Q30 : 0;
+    }
+  }
+  current.position[0] = mul_q16((int32_t)mean_u, depth) - (int32_t)mean_x;
+  current.position[1] = mul_q16((int32_t)mean_v, depth) - (int32_t)mean_y;
+  current.position[2] = depth;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PoseSolver::iterate(const int32_t* u, const int32_t* v, const uint8_t* index, uint8_t count, bool& converged) {
+  int64_t h[6][6] = {};
+  int64_t g[6] = {};
+
+  for(uint8_t i = 0; i < count; i++) {
+    const int32_t* m = model[index[i]];
+
+    //Rotated point, and the point in the lighthouse's frame
+    int32_t q[3], p[3];
+    for(uint8_t k = 0; k < 3; k++) {
+      q[k] = mul_q30(current.rotation[k][0], m[0]) + mul_q30(current.rotation[k][1], m[1])
+           + mul_q30(current.rotation[k][2], m[2]);
+      p[k] = q[k] + current.position[k];
+    }
+    if(p[2] < MIN_DEPTH)
+      return false;
+
+    int32_t inv_z = (int32_t)((1ll << 32) / p[2]);
+    int32_t pu = mul_q16(p[0], inv_z);
+    int32_t pv = mul_q16(p[1], inv_z);
+
+    //Jacobians of each image coordinate with respect to translation then rotation.
+    //For a = (1, 0, -u) and (0, 1, -v) they are (a, q x a) / z
+    int32_t ju[6] = {
+      inv_z, 0, -mul_q16(pu, inv_z),
+      mul_q16(-mul_q16(q[1], pu), inv_z),
+      mul_q16(q[2] + mul_q16(q[0], pu), inv_z),
+      mul_q16(-q[1], inv_z)
+    };
+    int32_t jv[6] = {
+      0, inv_z, -mul_q16(pv, inv_z),
+      mul_q16(-mul_q16(q[1], pv) - q[2], inv_z),
+      mul_q16(mul_q16(q[0], pv), inv_z),
+      mul_q16(q[0], inv_z)
+    };
+
+    int32_t ru = u[i] - pu;
+    int32_t rv = v[i] - pv;
+    for(uint8_t r = 0; r < 6; r++) {
+      for(uint8_t c = r; c < 6; c++) {
+        h[r][c] += (int64_t)ju[r] * ju[c] + (int64_t)jv[r] * jv[c];
+      }
+      g[r] += (int64_t)ju[r] * ru + (int64_t)jv[r] * rv;
+    }
+  }
+
+  //Mirror the upper triangle and add a little damping to keep the solve well conditioned
+  for(uint8_t r = 0; r < 6; r++) {
+    for(uint8_t c = 0; c < r; c++) {
+      h[r][c] = h[c][r];
+    }
+    h[r][r] += (h[r][r] >> 10) + 1;
+  }
+
+  int32_t step[6];
+  if(!solve_ldlt(h, g, step))
+    return false;
+
+  //Converged once every component of the step is negligible
+  converged = true;
+  for(uint8_t k = 0; k < 6; k++) {
+    if(step[k] > CONVERGED_STEP || step[k] < -CONVERGED_STEP)
+      converged = false;
+  }
+
+  apply_step(step);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PoseSolver::apply_step(const int32_t* step) {
+  for(uint8_t k = 0; k < 3; k++) {
+    current.position[k] += clamp(step[k], MAX_POSITION_STEP);
+  }
+
+  int32_t wx = clamp(step[3], MAX_ROTATION_STEP);
+  int32_t wy = clamp(step[4], MAX_ROTATION_STEP);
+  int32_t wz = clamp(step[5], MAX_ROTATION_STEP);
+
+  //R = (I + [w]x) R, then pull it back to a proper rotation
+  int32_t (&r)[3][3] = current.rotation;
+  int32_t updated[3][3];
+  for(uint8_t j = 0; j < 3; j++) {
+    updated[0][j] = r[0][j] + mul_q16(-wz, r[1][j]) + mul_q16(wy, r[2][j]);
+    updated[1][j] = r[1][j] + mul_q16(wz, r[0][j]) + mul_q16(-wx, r[2][j]);
+    updated[2][j] = r[2][j] + mul_q16(-wy, r[0][j]) + mul_q16(wx, r[1][j]);
+  }
+  renormalise(updated);
+  for(uint8_t i = 0; i < 3; i++) {
+    for(uint8_t j = 0; j < 3; j++) {
+      r[i][j] = updated[i][j];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PoseSolver::solve_ldlt(int64_t h[6][6], int64_t* g, int32_t* x) {
+  //h and g are Q32. L is kept as Q16, D as Q32, and the result comes out as Q16
+  int64_t l[6][6] = {};
+  int64_t d[6];
+
+  for(uint8_t j = 0; j < 6; j++) {
+    int64_t sum = h[j][j];
+    for(uint8_t k = 0; k < j; k++) {
+      sum -= ((l[j][k] * l[j][k]) >> 16) * d[k] >> 16;
+    }
+    if(sum <= 0)
+      return false;
+    d[j] = sum;
+
+    for(uint8_t i = j + 1; i < 6; i++) {
+      int64_t s = h[i][j];
+      for(uint8_t k = 0; k < j; k++) {
+        s -= ((l[i][k] * d[k]) >> 16) * l[j][k] >> 16;
+      }
+      l[i][j] = (s << 16) / d[j];
+    }
+  }
+
+  //Forward substitution, with g scaled up so the result has 16 fractional bits
+  int64_t y[6];
+  for(uint8_t i = 0; i < 6; i++) {
+    int64_t s = g[i] << 16;
+    for(uint8_t k = 0; k < i; k++) {
+      s -= (l[i][k] * (y[k] >> 16));
+    }
+    y[i] = s;
+  }
+
+  int64_t z[6];
+  for(uint8_t i = 0; i < 6; i++) {
+    z[i] = y[i] / d[i];
+  }
+
+  for(int8_t i = 5; i >= 0; i--) {
+    int64_t s = z[i];
+    for(uint8_t k = i + 1; k < 6; k++) {
+      s -= (l[k][i] * x[k]) >> 16;
+    }
+    if(s > INT32_MAX || s < INT32_MIN)
+      return false;
+    x[i] = (int32_t)s;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PoseSolver::renormalise(int32_t r[3][3]) {
+  //Spread the non-orthogonality of the first two rows between them, rebuild the third
+  //from their cross product, then rescale each with a first-order 1/|row|
+  int32_t error = mul_q30(r[0][0], r[1][0]) + mul_q30(r[0][1], r[1][1]) + mul_q30(r[0][2], r[1][2]);
+  int32_t x[3], y[3], z[3];
+  for(uint8_t k = 0; k < 3; k++) {
+    x[k] = r[0][k] - mul_q30(error / 2, r[1][k]);
+    y[k] = r[1][k] - mul_q30(error / 2, r[0][k]);
+  }
+  z[0] = mul_q30(x[1], y[2]) - mul_q30(x[2], y[1]);
+  z[1] = mul_q30(x[2], y[0]) - mul_q30(x[0], y[2]);
+  z[2] = mul_q30(x[0], y[1]) - mul_q30(x[1], y[0]);
+
+  int32_t* rows[3] = { x, y, z };
+  for(uint8_t i = 0; i < 3; i++) {
+    int32_t* row = rows[i];
+    int32_t norm2 = mul_q30(row[0], row[0]) + mul_q30(row[1], row[1]) + mul_q30(row[2], row[2]);
+    int32_t scale = (3 * (ONE_Q30 / 2)) - norm2 / 2;
+    for(uint8_t k = 0; k < 3; k++) {
+      r[i][k] = mul_q30(row[k], scale);
+    }
+  }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+
+// A rigid body pose relative to the base station, in the base station's frame
+// (x right, y up, z out from the lighthouse towards the tracker)
+struct Pose {
+  int32_t position[3];      //Metres, as Q16.16
+  int32_t rotation[3][3];   //Rotation from the constellation's frame, as Q2.30
+};
+
+// Solves the 6-DoF pose of a rigid constellation of sensors from their sweep angles.
+//
+// Each sensor's X/Y angles are turned into a normalised image point (tan of each
+// angle), then a Gauss-Newton iteration refines the pose until its projection of the
+// constellation matches them. Everything is done in fixed point: Q16.16 for positions,
+// image points and the Jacobian, Q2.30 for the rotation, and 64 bit accumulators for
+// the 6x6 normal equations, which are solved with an LDL^T decomposition.
+//
+// Solves are warm-started from the previous pose, so while tracking only a few
+// iterations are needed per update. Per iteration the cost is one 64 bit divide and
+// 77 32x32 to 64 bit multiplies per sensor, plus a fixed 100 64 bit multiplies and 21
+// 64 bit divides for the 6x6 solve and 51 multiplies to update the rotation. The
+// Cortex-M0+ has no long multiply, so each is a call of about 20 cycles, and each
+// divide goes through the SDK's divider routines at about 120 to 150.
+// solve_budget_cycles() is the most a warm solve should cost by these counts (0.74ms
+// for 4 sensors and 3.5ms for 32 at 125MHz, inside the 8.3ms between sweeps), which
+// callers can measure against. Cold starts can take COLD_ITERATIONS, so can overrun it.
+class PoseSolver {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint8_t MAX_SENSORS          = 32;
+  static const uint8_t MIN_SENSORS          = 4;    //Need at least 8 measurements for 6 unknowns
+  static const uint8_t COLD_ITERATIONS      = 20;
+  static const uint8_t WARM_ITERATIONS      = 6;
+
+  //Cortex-M0+ cycles per iteration, from the operation counts above, and per solve for the
+  //tangents and the final residual
+  static const uint32_t ITERATION_CYCLES_PER_SENSOR = 2000;
+  static const uint32_t ITERATION_CYCLES_FIXED      = 7000;
+  static const uint32_t SOLVE_CYCLES_PER_SENSOR     = 500;
+  static const uint32_t SOLVE_CYCLES_FIXED          = 1000;
+
+  static const int32_t CONVERGED_STEP       = 64;           //Q16, ~1mm or ~1mrad
+  static const int32_t MAX_RESIDUAL         = 2300;         //Q16 tangent, ~2 degrees RMS
+  static const int32_t MAX_ROTATION_STEP    = 19661;        //Q16, 0.3 rad
+  static const int32_t MAX_POSITION_STEP    = 32768;        //Q16, 0.5 m
+  static const int32_t MIN_DEPTH            = 3277;         //Q16, 5 cm
+  static const int32_t DEFAULT_DEPTH        = 2 << 16;      //Q16, 2 m guess when nothing better is known
+
+  static const int32_t ONE_Q16              = 1 << 16;
+  static const int32_t ONE_Q30              = 1 << 30;
+
+  enum Result {
+    SOLVE_OK,
+    SOLVE_TOO_FEW_SENSORS,
+    SOLVE_DIVERGED,
+  };
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  uint8_t num_sensors = 0;
+  int32_t model[MAX_SENSORS][3];    //Sensor positions in the constellation's frame, Q16 metres
+
+  Pose current;
+  bool tracking = false;
+
+  uint8_t last_iterations = 0;
+  int32_t last_residual = 0;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  PoseSolver();
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Sets the sensor positions, in micrometres relative to the constellation's origin
+  void set_geometry_um(const int32_t (*positions)[3], uint8_t count);
+
+  //Updates the pose from Q16.16 degree angles for the sensors set in valid_mask
+  Result solve(const int32_t* x_angles, const int32_t* y_angles, uint32_t valid_mask);
+
+  //Forgets the previous pose, so the next solve starts cold
+  void reset() { tracking = false; }
+
+  bool is_tracking() const { return tracking; }
+  const Pose& pose() const { return current; }
+  uint8_t iterations() const { return last_iterations; }
+  int32_t residual() const { return last_residual; }    //RMS image error of the last solve, Q16
+
+  //Projects a constellation point through a pose into Q16 tangents. Returns false if behind the lighthouse
+  bool project(const Pose& pose, const int32_t point[3], int32_t& u, int32_t& v) const;
+
+  //The estimated cycles a solve takes for the given sensors and iterations, and the most a warm
+  //solve can take. tiny_tracker_bench reports the iterations solves actually need
+  static constexpr uint32_t solve_cycles(uint8_t sensors, uint8_t iterations) {
+    return iterations * (ITERATION_CYCLES_PER_SENSOR * sensors + ITERATION_CYCLES_FIXED)
+           + SOLVE_CYCLES_PER_SENSOR * sensors + SOLVE_CYCLES_FIXED;
+  }
+  static constexpr uint32_t solve_budget_cycles(uint8_t sensors) { return solve_cycles(sensors, WARM_ITERATIONS); }
+
+  static int32_t angle_to_tangent(int32_t angle);
+  static int32_t tangent_to_angle(int32_t tangent);
+  static uint32_t isqrt64(uint64_t value);
+private:
+  void cold_start(const int32_t* u, const int32_t* v, const uint8_t* index, uint8_t count);
+  bool iterate(const int32_t* u, const int32_t* v, const uint8_t* index, uint8_t count, bool& converged);
+  void apply_step(const int32_t* step);
+  static bool solve_ldlt(int64_t h[6][6], int64_t* g, int32_t* x);
+  static void renormalise(int32_t r[3][3]);
+};
@@ -0,0 +1,128 @@
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+#include "PowerManager.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// STATICS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+volatile bool PowerManager::signalled = false;
+volatile uint32_t PowerManager::signal_us = 0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PowerManager::wake_callback(uint gpio, uint32_t events) {
+  (void)gpio;
+  (void)events;
+  signal();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PowerManager::PowerManager(uint32_t wake_pins, uint32_t lost_timeout_ms, uint8_t lost_divider) :
+  wake_pins(wake_pins), lost_timeout_us(lost_timeout_ms * 1000), lost_divider(lost_divider) {
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PowerManager::init() {
+  sys_clock_hz = clock_get_hz(clk_sys);
+  last_activity_us = time_us_32();
+
+  if(lost_divider > 1) {
+    //Free the UART from clk_sys, so dividing it down does not change the baud rate
+    clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB, 48 * MHZ, 48 * MHZ);
+#ifdef uart_default
+    uart_set_baudrate(uart_default, PICO_DEFAULT_UART_BAUD_RATE);
+#endif
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PowerManager::take() {
+  taken = signalled;
+  if(taken) {
+    taken_us = signal_us;
+    signalled = false;
+    if(lost) {
+      exit_lost(time_us_32());
+    }
+  }
+  return taken;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PowerManager::drained(uint32_t words) {
+  if(words == 0)
+    return;
+
+  uint32_t now = time_us_32();
+  last_activity_us = now;
+  if(taken) {
+    uint32_t latency = now - taken_us;
+    latency_count++;
+    latency_total_us += latency;
+    if(latency > latency_max_us)
+      latency_max_us = latency;
+    taken = false;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PowerManager::wait(uint32_t max_sleep_us) {
+  if(signalled)
+    return;
+
+  uint32_t now = time_us_32();
+  if(!lost && lost_divider > 1 && now - last_activity_us >= lost_timeout_us) {
+    enter_lost(now);
+  }
+  sleep_count++;
+  best_effort_wfe_or_timeout(make_timeout_time_us(max_sleep_us));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t PowerManager::lost_ms() const {
+  uint64_t total = lost_total_us;
+  if(lost)
+    total += time_us_32() - lost_since_us;
+  return (uint32_t)(total / 1000);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PowerManager::enter_lost(uint32_t now) {
+  lost = true;
+  lost_count++;
+  lost_since_us = now;
+
+  //Any rising edge wakes us, as the state machines will not see a sync at the lower clock
+  for(uint pin = 0; pin < 32; pin++) {
+    if(wake_pins & (1u << pin)) {
+      gpio_set_irq_enabled_with_callback(pin, GPIO_IRQ_EDGE_RISE, true, wake_callback);
+    }
+  }
+  clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX, CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS,
+                  sys_clock_hz, sys_clock_hz / lost_divider);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PowerManager::exit_lost(uint32_t now) {
+  clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX, CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS,
+                  sys_clock_hz, sys_clock_hz);
+  for(uint pin = 0; pin < 32; pin++) {
+    if(wake_pins & (1u << pin)) {
+      gpio_set_irq_enabled(pin, GPIO_IRQ_EDGE_RISE, false);
+    }
+  }
+
+  lost = false;
+  lost_total_us += now - lost_since_us;
+  last_activity_us = now;   //Give the lighthouses a full timeout to be seen again
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+// Lets the main loop sleep between pulses instead of busy-polling the sensors. With dual
+// core capture, core1 sleeps the same way between its drains (see CaptureCore::set_low_power),
+// and is woken by the same signals.
+//
+// The capture interrupts call signal() whenever they queue pulse words, which sets the
+// cores' event flag, so wait() can sleep in WFE until there is work or a deadline has
+// passed. A signal that arrives between the loop finding no work and it going to sleep
+// is latched by the event flag, so WFE returns at once and nothing is missed. DMA capture
+// has no per-word interrupt, so is only drained at the deadlines.
+//
+// Once no pulses have arrived for the lost timeout the lighthouses are taken to be out of
+// sight, and clk_sys is divided down until a rising edge on any sensor pin. The slowed
+// state machines can no longer time pulses, so the edge is caught by a GPIO interrupt.
+// The peripheral clock is moved to the fixed 48MHz USB PLL at init() so the UART keeps its
+// baud rate, and the timer runs from the crystal so time_us_32() is unaffected
+class PowerManager {
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  const uint32_t wake_pins;
+  const uint32_t lost_timeout_us;
+  const uint8_t lost_divider;
+
+  uint32_t sys_clock_hz = 0;
+  uint32_t last_activity_us = 0;
+  uint32_t taken_us = 0;          //When the signal being handled was raised
+  bool taken = false;
+  bool lost = false;
+
+  uint32_t sleep_count = 0;
+  uint32_t lost_count = 0;
+  uint32_t lost_since_us = 0;
+  uint64_t lost_total_us = 0;
+  uint32_t latency_count = 0;
+  uint64_t latency_total_us = 0;
+  uint32_t latency_max_us = 0;
+
+  static volatile bool signalled;
+  static volatile uint32_t signal_us;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  //A lost_divider of 1 never lowers the clock, and only sleeps between events
+  PowerManager(uint32_t wake_pins, uint32_t lost_timeout_ms, uint8_t lost_divider);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  void init();
+
+  //Called from the capture interrupts when there are words to drain
+  static inline void signal() {
+    if(!signalled) {
+      signal_us = time_us_32();
+      signalled = true;
+    }
+    __sev();
+  }
+
+  //Called at the start of each pass of the main loop. Returns true if it was signalled
+  bool take();
+
+  //Called once a pass has drained and decoded the given number of words
+  void drained(uint32_t words);
+
+  //Sleeps until signalled or max_sleep_us has passed, first dropping the clock if the
+  //lighthouses have been lost for long enough
+  void wait(uint32_t max_sleep_us);
+
+  bool is_lost() const { return lost; }
+  uint32_t sleeps() const { return sleep_count; }
+  uint32_t losses() const { return lost_count; }
+  uint32_t lost_ms() const;
+  uint32_t max_latency_us() const { return latency_max_us; }
+  uint32_t mean_latency_us() const { return latency_count > 0 ? (uint32_t)(latency_total_us / latency_count) : 0; }
+private:
+  void enter_lost(uint32_t now);
+  void exit_lost(uint32_t now);
+  static void wake_callback(uint gpio, uint32_t events);
+};
@@ -0,0 +1,249 @@
+#include "PulseDecoder.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PulseDecoder::PulseDecoder(uint8_t num_sensors) :
+  num_sensors(num_sensors < MAX_SENSORS ? num_sensors : MAX_SENSORS) {
+  for(uint8_t st = 0; st < NUM_STATIONS; st++) {
+    for(uint8_t s = 0; s < MAX_SENSORS; s++) {
+      last_axis[st][s] = 0;
+      last_data[st][s] = 0;
+      last_skip[st][s] = 0;
+      last_x[st][s] = 0;
+      last_y[st][s] = 0;
+      sync_count[st][s] = 0;
+      sync_start2[st][s] = 0;
+    }
+    new_data[st] = 0;
+    ootx_lead[st] = 0;
+  }
+  for(uint8_t s = 0; s < MAX_SENSORS; s++) {
+    sweep_station[s] = NO_STATION;
+    sweep_length[s] = 0;
+    window_us[s] = 0;
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t PulseDecoder::process(uint8_t sensor, const uint32_t* words, uint32_t count, SweepEvent* events,
+                               const uint32_t* window_starts) {
+  if(sensor >= num_sensors)
+    return 0;
+
+  uint32_t num_events = 0;
+  uint32_t num_windows = 0;
+  for(uint32_t i = 0; i < count; i++) {
+    uint32_t received = words[i];
+    if(received == 0) {
+      if(TrackerStats::ENABLED)
+        counts.rejected++;
+      continue;
+    }
+
+    //Start and length in whole counts, as only the midpoint needs the extra resolution
+    uint32_t start = LighthouseTiming::word_start(received);
+    uint32_t length, mid2;
+    if(high_resolution & (1u << sensor)) {
+      length = LighthouseTiming::hires_length(received);
+      mid2 = LighthouseTiming::hires_mid2(received);
+    }
+    else {
+      length = LighthouseTiming::word_end(received) - start;
+      mid2 = LighthouseTiming::word_mid2(received);
+    }
+
+    //Everything the length says about the pulse, in one lookup
+    uint8_t tag = LighthouseTiming::pulse_tag(length);
+
+    uint8_t station;
+    if(start == 0) {
+      //The first pulse in a counting window is always a base sync, from station 0
+      station = 0;
+      sweep_station[sensor] = NO_STATION;
+      sweep_length[sensor] = 0;
+      window_us[sensor] = (window_starts != nullptr) ? window_starts[num_windows++] : 0;
+      outlier_windows &= ~(1u << sensor);
+
+      //A window opened by something other than the expected sync is dropped whole
+      if(sync_tracking && window_starts != nullptr
+         && trackers[0].sync(window_us[sensor]) == SyncTracker::SYNC_OUTLIER && trackers[0].locked()) {
+        outlier_windows |= 1u << sensor;
+        if(TrackerStats::ENABLED)
+          counts.rejected++;
+        continue;
+      }
+      if(TrackerStats::ENABLED)
+        counts.syncs++;
+    }
+    else if(tag & LighthouseTiming::TAG_CSYNC) {
+      //A long pulse later in the window is a sync from the other lighthouse
+      station = 1;
+      if(sync_tracking && window_starts != nullptr) {
+        bool outlier = (outlier_windows & (1u << sensor))
+                    || (trackers[1].sync(window_us[sensor] + LighthouseTiming::counts_to_us(start)) == SyncTracker::SYNC_OUTLIER
+                        && trackers[1].locked());
+        if(outlier) {
+          if(TrackerStats::ENABLED)
+            counts.rejected++;
+          continue;
+        }
+      }
+      if(TrackerStats::ENABLED)
+        counts.csyncs++;
+
+      //Only the first sync that could own the sweep is timed, so a later flash cannot move it
+      if(sweep_station[sensor] == NO_STATION)
+        sync_start2[1][sensor] = (high_resolution & (1u << sensor)) ? LighthouseTiming::hires_start2(received)
+                                                                    : LighthouseTiming::word_start2(received);
+    }
+    else {
+      station = sweep_station[sensor];
+      if(station == NO_STATION) {
+        if(TrackerStats::ENABLED)
+          counts.rejected++;
+        continue;   //Neither sync claimed this sweep, so it cannot be attributed
+      }
+
+      //Sweeps are timed from their own station's sync, so its loop says where they can be
+      uint32_t sweep_mid2 = mid2 - sync_start2[station][sensor];
+      if(sync_tracking && trackers[station].locked()) {
+        if(!trackers[station].in_sweep_window(sweep_mid2)) {
+          if(TrackerStats::ENABLED)
+            counts.rejected++;
+          continue;
+        }
+        sweep_mid2 = trackers[station].normalise(sweep_mid2);
+      }
+
+      //A reflection is dimmer than the direct sweep, so gives a shorter pulse
+      if(reject_reflections) {
+        if(length <= sweep_length[sensor]) {
+          if(TrackerStats::ENABLED)
+            counts.rejected++;
+          continue;
+        }
+        if(TrackerStats::ENABLED && sweep_length[sensor] != 0)
+          counts.replaced++;
+        sweep_length[sensor] = length;
+      }
+      if(TrackerStats::ENABLED)
+        counts.sweeps++;
+
+      uint8_t axis = last_axis[station][sensor];
+      store_sweep(sensor, station, axis, sweep_mid2);
+
+      if(events != nullptr) {
+        SweepEvent& event = events[num_events++];
+        event.mid2 = sweep_mid2;
+        event.timestamp_us = window_us[sensor] + (LighthouseTiming::counts_to_us(mid2 >> LighthouseTiming::MID2_FRACTION_BITS) >> 1);
+        event.sensor = sensor;
+        event.axis = axis;
+        event.station = station;
+        event.type = SweepEvent::SWEEP;
+      }
+      continue;
+    }
+
+    if(sync(sensor, station, tag & LighthouseTiming::TAG_SYNC_DATA)) {
+      ootx[station].feed(last_data[station][sensor]);
+
+      if(events != nullptr) {
+        SweepEvent& event = events[num_events++];
+        event.mid2 = 0;
+        event.timestamp_us = window_us[sensor];
+        event.sensor = sensor;
+        event.axis = last_data[station][sensor];
+        event.station = station;
+        event.type = SweepEvent::OOTX_BIT;
+      }
+    }
+  }
+  return num_events;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PulseDecoder::set_high_resolution(uint8_t sensor, bool enabled) {
+  if(sensor >= num_sensors)
+    return;
+
+  if(enabled)
+    high_resolution |= 1u << sensor;
+  else
+    high_resolution &= ~(1u << sensor);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PulseDecoder::apply(const SweepEvent& event) {
+  if(event.sensor >= num_sensors || event.station >= NUM_STATIONS)
+    return;
+
+  if(event.type == SweepEvent::OOTX_BIT)
+    ootx[event.station].feed(event.axis);
+  else
+    store_sweep(event.sensor, event.station, event.axis, event.mid2);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PulseDecoder::correct(uint8_t station, int32_t& x, int32_t& y) const {
+  if(station >= NUM_STATIONS || !ootx[station].has_info())
+    return;
+
+  const LighthouseInfo& info = ootx[station].lighthouse_info();
+
+  //The calibration is in radians, so work in Q16 radians and convert the correction back
+  int32_t x_rad = (int32_t)(((int64_t)x * DEG_TO_RAD_Q30) >> 30);
+  int32_t y_rad = (int32_t)(((int64_t)y * DEG_TO_RAD_Q30) >> 30);
+
+  //Each axis is offset by its phase, and skewed by a tilt and curve in the other axis
+  int32_t y_sq = (int32_t)(((int64_t)y_rad * y_rad) >> 16);
+  int32_t x_sq = (int32_t)(((int64_t)x_rad * x_rad) >> 16);
+  int32_t x_error = info.phase[0] + (int32_t)(((int64_t)info.tilt[0] * y_rad) >> 16)
+                                  + (int32_t)(((int64_t)info.curve[0] * y_sq) >> 16);
+  int32_t y_error = info.phase[1] + (int32_t)(((int64_t)info.tilt[1] * x_rad) >> 16)
+                                  + (int32_t)(((int64_t)info.curve[1] * x_sq) >> 16);
+
+  x -= (int32_t)(((int64_t)x_error * RAD_TO_DEG_Q16) >> 16);
+  y -= (int32_t)(((int64_t)y_error * RAD_TO_DEG_Q16) >> 16);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PulseDecoder::sync(uint8_t sensor, uint8_t station, uint8_t sync_data) {
+  last_axis[station][sensor] = sync_data & 0b001;
+  last_data[station][sensor] = (sync_data & 0b010) >> 1;
+  last_skip[station][sensor] = (sync_data & 0b100) >> 2;
+
+  //The first station in the window that is not skipping owns the sweep
+  if(last_skip[station][sensor] == 0 && sweep_station[sensor] == NO_STATION)
+    sweep_station[sensor] = station;
+
+  //Every sensor sees the same data bits, so only one is used per station. If that one
+  //stops seeing the station, hand over to one that still can
+  sync_count[station][sensor]++;
+  uint8_t lead = ootx_lead[station];
+  if(sensor == lead)
+    return true;
+
+  if((int8_t)(sync_count[station][sensor] - sync_count[station][lead]) > OOTX_LEAD_MISSES) {
+    ootx_lead[station] = sensor;
+    return true;
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PulseDecoder::store_sweep(uint8_t sensor, uint8_t station, uint8_t axis, uint32_t mid2) {
+  if(axis) {
+    last_y[station][sensor] = mid2;
+    new_data[station] |= 1u << sensor;
+  }
+  else {
+    last_x[station][sensor] = mid2;
+  }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <stdint.h>
+#include "LighthouseTiming.hpp"
+#include "OotxDecoder.hpp"
+#include "SyncTracker.hpp"
+#include "TrackerStats.hpp"
+
+// A single decoded sweep (or OOTX data bit), for passing decoder output between stages
+struct SweepEvent {
+  enum Type : uint8_t {
+    SWEEP,
+    OOTX_BIT,   //One bit of a station's OOTX stream, held in axis
+  };
+
+  uint32_t mid2;            //Sweep midpoint, as start + end counts with LighthouseTiming::MID2_FRACTION_BITS
+  uint32_t timestamp_us;    //When the sweep crossed the sensor (or its sync rose), as time_us_32()
+  uint8_t sensor;
+  uint8_t axis;
+  uint8_t station;
+  uint8_t type;
+};
+
+// Decodes the raw pulse words produced by the lighthouse PIO program into
+// sync data and per-axis sweep timings, for any number of sensors.
+// All decoding is done in integer counts of the PIO timer, see LighthouseTiming.
+// Sensors set to high resolution give words in the format EdgeTimer produces.
+//
+// State is held as a struct-of-arrays indexed by sensor, and words are
+// processed in batches, so the same decoder scales from 1 to MAX_SENSORS
+// sensors. It has no dependency on the Pico SDK so it can also be built on
+// the host.
+//
+// With two lighthouses in A/B mode both flash a sync at the start of every
+// cycle, about 400us apart, but only one of them sweeps. The counting window
+// opens on the first sync, so station 0 owns the sync at the window's start and
+// station 1 the long pulse after it. Whichever of the two has its skip bit clear
+// owns the sweep that follows, so each station gets its own angle stream.
+// Sweeps are timed from the start of their own station's sync, so station 1's
+// angles do not carry the 400us between the two.
+// Each station's data bits are also assembled into its OOTX info block, and its
+// calibration applied by correct()
+//
+// Pulses are classified with a single table lookup on their length (see
+// LighthouseTiming::pulse_tag), as lighthouse.pio has no instruction memory or
+// cycles to spare for tagging them itself
+//
+// With sync tracking, each station's syncs feed a SyncTracker. Once locked, a
+// window or C-sync far from its predicted time and a sweep outside its station's
+// predicted sweep window are rejected, and sweep midpoints are normalised by that
+// station's measured period. This needs the window start times, so does nothing
+// without them
+class PulseDecoder {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint8_t MAX_SENSORS      = 32;
+  static const uint32_t DRAIN_BATCH     = 32;
+  static const uint8_t NUM_STATIONS     = 2;
+  static const uint8_t NO_STATION       = 0xff;
+
+  //How many more syncs another sensor can see than the one feeding a station's OOTX
+  //stream before it takes over. Large enough to ride out one sensor's batch being
+  //decoded ahead of another's
+  static const int8_t OOTX_LEAD_MISSES  = 48;
+
+  static const int32_t DEG_TO_RAD_Q30   = 18740330;   //pi / 180 as Q2.30
+  static const int32_t RAD_TO_DEG_Q16   = 3754936;    //180 / pi as Q16.16
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  const uint8_t num_sensors;
+
+  uint8_t last_axis[NUM_STATIONS][MAX_SENSORS];
+  uint8_t last_data[NUM_STATIONS][MAX_SENSORS];
+  uint8_t last_skip[NUM_STATIONS][MAX_SENSORS];
+  uint8_t sweep_station[MAX_SENSORS];   //The station sweeping in each sensor's current window
+  uint32_t sweep_length[MAX_SENSORS];   //The longest sweep in each sensor's current window, in counts
+  uint32_t sync_start2[NUM_STATIONS][MAX_SENSORS];   //Where each station's sync started in the current window, as twice its counts like mid2
+  bool reject_reflections = false;
+  bool sync_tracking = false;
+  uint32_t outlier_windows = 0;         //Bitmask of sensors whose current window did not open on a sync
+  uint32_t window_us[MAX_SENSORS];      //When each sensor's current window opened
+  uint32_t high_resolution = 0;         //Bitmask of sensors giving high resolution words
+
+  uint32_t last_x[NUM_STATIONS][MAX_SENSORS];   //Sweep midpoints, as SweepEvent::mid2
+  uint32_t last_y[NUM_STATIONS][MAX_SENSORS];
+
+  uint32_t new_data[NUM_STATIONS];    //Bitmask of sensors that have completed a Y sweep
+
+  OotxDecoder ootx[NUM_STATIONS];
+  SyncTracker trackers[NUM_STATIONS];
+  uint8_t ootx_lead[NUM_STATIONS];    //The sensor whose syncs feed each station's OOTX stream
+  uint8_t sync_count[NUM_STATIONS][MAX_SENSORS];   //Wrapping count of syncs seen, for comparing sensors
+
+  DecodeCounts counts;    //Only kept when TrackerStats are enabled
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  PulseDecoder(uint8_t num_sensors);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Decodes a batch of words from one sensor. If events is provided, each sweep and OOTX
+  //bit is also written to it (it must have room for count events) and the number written
+  //is returned. Events are timestamped from the start times of the windows opened in the
+  //batch, as given by a PulseSource, or relative to 0 without them
+  uint32_t process(uint8_t sensor, const uint32_t* words, uint32_t count, SweepEvent* events = nullptr,
+                   const uint32_t* window_starts = nullptr);
+
+  //Sets whether a sensor's words are in the high resolution format, as PulseSource::high_resolution()
+  void set_high_resolution(uint8_t sensor, bool enabled);
+
+  //When enabled, a sweep is only used if it is longer than any before it in the same window, so a
+  //reflection after the direct sweep is dropped. Only those are: one before it is still stored and
+  //given as an event, then replaced by the direct sweep, which is given as a second event. Each
+  //replaced sweep is counted in DecodeCounts::replaced
+  void set_reject_reflections(bool enabled) { reject_reflections = enabled; }
+
+  //When enabled, pulses are gated and sweeps normalised by each station's SyncTracker
+  void set_sync_tracking(bool enabled) { sync_tracking = enabled; }
+
+  //Updates the sweep and OOTX state from an event produced by another decoder
+  void apply(const SweepEvent& event);
+
+  //Drains up to one batch from each source and decodes it. A source is anything
+  //with a get_received_batch(buffer, max_count) method, such as a Sensor
+  template<class SOURCE>
+  void drain(SOURCE* const* sources) {
+    uint32_t words[DRAIN_BATCH];
+    for(uint8_t s = 0; s < num_sensors; s++) {
+      uint32_t count = sources[s]->get_received_batch(words, DRAIN_BATCH);
+      process(s, words, count);
+    }
+  }
+
+  uint8_t sensor_count() const { return num_sensors; }
+  bool has_new_data(uint8_t station = 0) const { return new_data[station] != 0; }
+  uint32_t new_data_mask(uint8_t station = 0) const { return new_data[station]; }
+  void clear_new_data(uint8_t station = 0) { new_data[station] = 0; }
+
+  uint32_t x_mid2(uint8_t sensor, uint8_t station = 0) const { return last_x[station][sensor]; }
+  uint32_t y_mid2(uint8_t sensor, uint8_t station = 0) const { return last_y[station][sensor]; }
+
+  //Uncorrected angles in degrees, as Q16.16 fixed point
+  int32_t x_angle(uint8_t sensor, uint8_t station = 0) const { return LighthouseTiming::mid2_to_angle(last_x[station][sensor]); }
+  int32_t y_angle(uint8_t sensor, uint8_t station = 0) const { return LighthouseTiming::mid2_to_angle(last_y[station][sensor]); }
+
+  //Applies a station's phase, tilt and curve calibration to a pair of Q16.16 degree
+  //angles, once its OOTX info has been received
+  void correct(uint8_t station, int32_t& x, int32_t& y) const;
+
+  const OotxDecoder& station_info(uint8_t station) const { return ootx[station]; }
+  const SyncTracker& sync_tracker(uint8_t station) const { return trackers[station]; }
+  const DecodeCounts& decode_counts() const { return counts; }
+
+  uint32_t window_start_us(uint8_t sensor) const { return window_us[sensor]; }
+
+  uint8_t axis(uint8_t sensor, uint8_t station = 0) const { return last_axis[station][sensor]; }
+  uint8_t data(uint8_t sensor, uint8_t station = 0) const { return last_data[station][sensor]; }
+  uint8_t skip(uint8_t sensor, uint8_t station = 0) const { return last_skip[station][sensor]; }
+private:
+  //Records a sync, returning true if its data bit should be fed to the station's OOTX stream
+  bool sync(uint8_t sensor, uint8_t station, uint8_t sync_data);
+  void store_sweep(uint8_t sensor, uint8_t station, uint8_t axis, uint32_t mid2);
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// A lock-free, single-producer/single-consumer ring buffer.
+//
+// Used to pass pulse words from a PIO interrupt (the producer) to the main loop
+// (the consumer). The read and write counts are free-running and only ever
+// stored by one side each, so no read-modify-write atomics are needed, which
+// keeps it usable on the Cortex-M0+. When full, new items are rejected and
+// counted as dropped rather than overwriting data the consumer has not read.
+template<typename T, uint32_t CAPACITY>
+class PulseRing {
+  static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "PulseRing capacity must be a power of two");
+
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint32_t MASK = CAPACITY - 1;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  T buffer[CAPACITY];
+  std::atomic<uint32_t> write_count{0};   //Only stored by the producer
+  std::atomic<uint32_t> read_count{0};    //Only stored by the consumer
+  std::atomic<uint32_t> dropped{0};       //Only stored by the producer
+  std::atomic<uint32_t> high_water{0};    //Only stored by the producer
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  //The counts can start anywhere, so host tests can take them across their 2^32 wrap quickly
+  PulseRing(uint32_t first_count = 0) : write_count(first_count), read_count(first_count) {}
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Producer side. Returns false (and counts a drop) if the ring is full
+  bool push(const T& item) {
+    uint32_t w = write_count.load(std::memory_order_relaxed);
+    uint32_t r = read_count.load(std::memory_order_acquire);
+    if(w - r >= CAPACITY) {
+      dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    buffer[w & MASK] = item;
+    write_count.store(w + 1, std::memory_order_release);
+    if(w + 1 - r > high_water.load(std::memory_order_relaxed))
+      high_water.store(w + 1 - r, std::memory_order_relaxed);
+    return true;
+  }
+
+  //Consumer side. Returns false if there was nothing to read
+  bool pop(T& item) {
+    uint32_t r = read_count.load(std::memory_order_relaxed);
+    uint32_t w = write_count.load(std::memory_order_acquire);
+    if(r == w)
+      return false;
+    item = buffer[r & MASK];
+    read_count.store(r + 1, std::memory_order_release);
+    return true;
+  }
+
+  //Consumer side. Copies out up to max_count items in at most two contiguous runs
+  uint32_t pop_batch(T* items, uint32_t max_count) {
+    uint32_t r = read_count.load(std::memory_order_relaxed);
+    uint32_t w = write_count.load(std::memory_order_acquire);
+    uint32_t count = w - r;
+    if(count > max_count)
+      count = max_count;
+
+    uint32_t first = r & MASK;
+    uint32_t run = CAPACITY - first;
+    if(run > count)
+      run = count;
+    for(uint32_t i = 0; i < run; i++)
+      items[i] = buffer[first + i];
+    for(uint32_t i = run; i < count; i++)
+      items[i] = buffer[i - run];
+
+    read_count.store(r + count, std::memory_order_release);
+    return count;
+  }
+
+  //Number of items waiting to be read. Exact from the consumer, a snapshot from anywhere else
+  uint32_t size() const {
+    return write_count.load(std::memory_order_acquire) - read_count.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+  uint32_t dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+  uint32_t high_water_mark() const { return high_water.load(std::memory_order_relaxed); }    //The most items ever waiting
+  static constexpr uint32_t capacity() { return CAPACITY; }
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include "LighthouseTiming.hpp"
+
+// Anything the capture pipeline can drain pulse words from: a Sensor with its own
+// state machine (fed by interrupt or DMA), one channel of a SensorGroup, or a host
+// stand-in. Words are in lighthouse.pio's (start << 16) | end format, or the high
+// resolution format from LighthouseTiming when high_resolution() is true.
+//
+// Each counting window's opening sync (start of 0) is also given the time_us_32() it
+// rose at, latched once per window by whatever reads the words, so later stages can
+// turn any pulse's counts into an absolute time. A source with nothing to latch the
+// time as the words arrive, such as DMA capture, times windows when they are drained
+// instead, and says so with drain_timed().
+//
+// init() is called on the core that should own the source's interrupts, and may be
+// called more than once for sources that share hardware
+class PulseSource {
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  virtual ~PulseSource() {}
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  virtual bool init() = 0;
+  //Takes up to max_count words. If window_us is given, the start time of each window opened
+  //in the batch is written to it in order, so it needs room for max_count times
+  virtual uint32_t get_received_batch(uint32_t* buffer, uint32_t max_count, uint32_t* window_us = nullptr) = 0;
+  virtual uint32_t received_count() const = 0;
+  virtual uint32_t dropped_pulses() const = 0;      //Rejected because the buffer was full
+  virtual uint32_t overwritten_pulses() const { return 0; }   //Lost to a writer that cannot see the reader, such as DMA
+  virtual uint32_t high_water() const = 0;          //The most words ever waiting to be drained
+  virtual bool high_resolution() const { return false; }
+  virtual bool drain_timed() const { return false; }   //Windows are timed when drained, so late by however long they waited
+
+  //The time a window opened, from when its sync word was read and how long the sync was
+  static inline uint32_t window_start(uint32_t word, uint32_t read_us, bool high_resolution = false) {
+    uint32_t length = high_resolution ? LighthouseTiming::hires_length(word) : LighthouseTiming::word_end(word);
+    return read_us - LighthouseTiming::counts_to_us(length);
+  }
+
+  //Pairs each window-opening word in a batch with the next time latched for it. The times
+  //must always be taken, even if unwanted, to stay in step with the words. Any word
+  //without one is timed from fallback_us
+  template<class RING>
+  static void take_window_starts(RING& latched, const uint32_t* words, uint32_t count, uint32_t* window_us, uint32_t fallback_us,
+                                 bool high_resolution = false) {
+    uint32_t windows = 0;
+    for(uint32_t i = 0; i < count; i++) {
+      if(LighthouseTiming::word_start(words[i]) == 0) {
+        uint32_t time;
+        if(!latched.pop(time))
+          time = window_start(words[i], fallback_us, high_resolution);
+        if(window_us != nullptr)
+          window_us[windows] = time;
+        windows++;
+      }
+    }
+  }
+};
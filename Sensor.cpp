@@ -2,7 +2,9 @@
 #include <climits>
 #include "hardware/irq.h"
 #include "Sensor.hpp"
+#include "PowerManager.hpp"
 #include "lighthouse.pio.h"
+#include "lighthouse_hires.pio.h"
 #include <cstdio>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -10,24 +12,57 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 Sensor* Sensor::pio_sensors[][NUM_PIO_STATE_MACHINES] = { { nullptr, nullptr, nullptr, nullptr }, { nullptr, nullptr, nullptr, nullptr } };
 uint8_t Sensor::pio_claimed_sms[] = { 0x0, 0x0 };
-uint Sensor::sens_offset = 0;;
+uint Sensor::sens_offset[] = { 0, 0 };
+Sensor::Resolution Sensor::pio_resolution[] = { RESOLUTION_STANDARD, RESOLUTION_STANDARD };
+IrqProfiler Sensor::irq_profile;
+Sensor* Sensor::dma_sensors[NUM_DMA_CHANNELS] = { nullptr };
+static bool dma_handler_added = false;
+static bool pio_handler_added[NUM_PIOS] = { false, false };
+
+static const pio_program_t* program_for(Sensor::Resolution resolution) {
+  return (resolution == Sensor::RESOLUTION_HIGH) ? &lighthouse_hires_program : &lighthouse_program;
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-void Sensor::pio0_interrupt_callback() {
-  //Go through each of encoders on this PIO to see which triggered this interrupt
-  for(uint8_t sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
-    if(pio_sensors[0][sm] != nullptr) { 
-      pio_sensors[0][sm]->check_for_transition(); 
-    }
+//The interrupt path runs from RAM, so a pulse never waits on an XIP cache miss
+void __not_in_flash_func(Sensor::pio0_interrupt_callback)() {
+  dispatch(pio0, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void __not_in_flash_func(Sensor::pio1_interrupt_callback)() {
+  dispatch(pio1, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void __not_in_flash_func(Sensor::dispatch)(PIO pio, uint pio_idx) {
+  uint32_t start = IrqProfiler::now();
+  uint32_t pulses = 0;
+
+  //Read which of our SMs have words waiting once, then visit only those. A SensorGroup on the
+  //same PIO has its own handler for its SM
+  uint32_t pending = (pio->ints0 >> PIO_IRQ0_INTS_SM0_RXNEMPTY_LSB) & pio_claimed_sms[pio_idx];
+  while(pending) {
+    uint sm = __builtin_ctz(pending);
+    pending &= pending - 1;
+    pulses += pio_sensors[pio_idx][sm]->check_for_transition();
   }
+  if(pulses > 0) {
+    PowerManager::signal();
+  }
+  irq_profile.record(start, pulses);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-void Sensor::pio1_interrupt_callback() {
-  //Go through each of encoders on this PIO to see which triggered this interrupt
-  for(uint8_t sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
-    if(pio_sensors[1][sm] != nullptr) { 
-      pio_sensors[1][sm]->check_for_transition(); 
+void Sensor::dma_interrupt_callback() {
+  //A channel has written its whole transfer count. Its write address has carried on around the
+  //ring, so re-arming only needs a fresh count, and the words so far are added to its base
+  for(uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+    Sensor* sensor = dma_sensors[ch];
+    if(sensor != nullptr && (dma_hw->ints0 & (1u << ch))) {
+      dma_hw->ints0 = 1u << ch;
+      sensor->dma_base = sensor->dma_base + DMA_TRANSFER_COUNT;
+      dma_channel_set_trans_count(ch, DMA_TRANSFER_COUNT, true);
     }
   }
 }
@@ -38,22 +73,34 @@ void Sensor::pio1_interrupt_callback() {
 // CONSTRUCTORS / DESTRUCTOR
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 Sensor::Sensor(PIO pio, uint8_t pin, uint8_t sideset_pin,
-               uint16_t freq_divider) :
+               uint16_t freq_divider, CaptureMode mode, Resolution resolution) :
   sens_pio(pio), pin(pin), sideset_pin(sideset_pin),
-  freq_divider(freq_divider) {
+  freq_divider(freq_divider), mode(mode), resolution(resolution) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 Sensor::~Sensor() {
+  if(dma_channel >= 0) {
+    dma_channel_set_irq0_enabled(dma_channel, false);
+    dma_channel_abort(dma_channel);
+    dma_sensors[dma_channel] = nullptr;
+    dma_channel_unclaim(dma_channel);
+  }
+
   //Clean up our use of the SM associated with this encoder
-  lighthouse_program_release(sens_pio, sens_sm);
+  pio_set_irq0_source_enabled(sens_pio, (pio_interrupt_source)(PIO_INTR_SM0_RXNEMPTY_LSB + sens_sm), false);
+  release_program();
   uint index = pio_get_index(sens_pio);
   pio_sensors[index][sens_sm] = nullptr;
   pio_claimed_sms[index] &= ~(1u << sens_sm);
 
-  //If there are no more SMs using the encoder program, then we can remove it from the PIO
+  //If there are no more SMs using the encoder program, then we can remove it and its handler from the PIO
   if(pio_claimed_sms[index] == 0) {
-    pio_remove_program(sens_pio, &lighthouse_program, sens_offset);
+    pio_remove_program(sens_pio, program_for(resolution), sens_offset[index]);
+    if(pio_handler_added[index]) {
+      irq_remove_handler((index == 0) ? PIO0_IRQ_0 : PIO1_IRQ_0, (index == 0) ? pio0_interrupt_callback : pio1_interrupt_callback);
+      pio_handler_added[index] = false;
+    }
   }
 }
 
@@ -67,6 +114,7 @@ bool Sensor::init() {
 
   //Is the pin we want to use actually valid?
   if(pin < NUM_BANK0_GPIOS) {
+    IrqProfiler::begin();
 
     sens_sm = pio_claim_unused_sm(sens_pio, true);
     uint pio_idx = pio_get_index(sens_pio);
@@ -74,21 +122,45 @@ bool Sensor::init() {
     //Is this the first time using a sensor on this PIO?      
     if(pio_claimed_sms[pio_idx] == 0) {
       //Add the program to the PIO memory
-      sens_offset = pio_add_program(sens_pio, &lighthouse_program);
+      if(!pio_can_add_program(sens_pio, program_for(resolution))) {
+        pio_sm_unclaim(sens_pio, sens_sm);
+        return false;
+      }
+      sens_offset[pio_idx] = pio_add_program(sens_pio, program_for(resolution));
+      pio_resolution[pio_idx] = resolution;
+    }
+    else if(pio_resolution[pio_idx] != resolution) {
+      //The other program is already loaded, and there is no room for both
+      pio_sm_unclaim(sens_pio, sens_sm);
+      return false;
     }
 
     //Init the program on this sm and enable the appropriate interrupt
-    lighthouse_program_init(sens_pio, sens_sm, sens_offset, pin, sideset_pin, freq_divider);
-    //hw_set_bits(&sens_pio->inte0, PIO_IRQ0_INTE_SM0_RXNEMPTY_BITS << sens_sm);
-    pio_set_irq0_source_enabled(sens_pio, (pio_interrupt_source)(PIO_INTR_SM0_RXNEMPTY_LSB + sens_sm), true);
-
-    if(pio_idx == 0) {
-      irq_add_shared_handler(PIO0_IRQ_0, pio0_interrupt_callback, sens_sm);
-      irq_set_enabled(PIO0_IRQ_0, true);
+    if(resolution == RESOLUTION_HIGH)
+      lighthouse_hires_program_init(sens_pio, sens_sm, sens_offset[pio_idx], pin, sideset_pin, freq_divider);
+    else
+      lighthouse_program_init(sens_pio, sens_sm, sens_offset[pio_idx], pin, sideset_pin, freq_divider);
+    if(mode == CAPTURE_DMA) {
+      if(!init_dma()) {
+        release_program();
+        if(pio_claimed_sms[pio_idx] == 0) {
+          pio_remove_program(sens_pio, program_for(resolution), sens_offset[pio_idx]);
+        }
+        return false;
+      }
     }
     else {
-      irq_add_shared_handler(PIO1_IRQ_0, pio1_interrupt_callback, sens_sm);
-      irq_set_enabled(PIO1_IRQ_0, true);
+      //hw_set_bits(&sens_pio->inte0, PIO_IRQ0_INTE_SM0_RXNEMPTY_BITS << sens_sm);
+      pio_set_irq0_source_enabled(sens_pio, (pio_interrupt_source)(PIO_INTR_SM0_RXNEMPTY_LSB + sens_sm), true);
+
+      //One handler serves every sensor on this PIO, so only add it for the first
+      if(!pio_handler_added[pio_idx]) {
+        uint irq_num = (pio_idx == 0) ? PIO0_IRQ_0 : PIO1_IRQ_0;
+        irq_add_shared_handler(irq_num, (pio_idx == 0) ? pio0_interrupt_callback : pio1_interrupt_callback,
+                               PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(irq_num, true);
+        pio_handler_added[pio_idx] = true;
+      }
     }
 
     //Keep a record of this sensor for the interrupt callback
@@ -96,7 +168,10 @@ bool Sensor::init() {
     pio_claimed_sms[pio_idx] |= 1u << sens_sm;
 
     //Start the PIO program on the SM
-    lighthouse_program_start(sens_pio, sens_sm);
+    if(resolution == RESOLUTION_HIGH)
+      lighthouse_hires_program_start(sens_pio, sens_sm);
+    else
+      lighthouse_program_start(sens_pio, sens_sm);
 
     initialised = true;
   }
@@ -145,31 +220,135 @@ uint32_t Sensor::millis() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 uint32_t Sensor::get_received(uint32_t& bufferCount) {
-  uint32_t received = 0;
+  uint32_t word = 0;
 
-  if(readIndex != writeIndex) {
-    received = receivedBuffer[readIndex];
-    readIndex++;
-    if(readIndex >= BUFFER)
-      readIndex = 0;
-    bufferCount = writeIndex - readIndex;
+  if(get_received_batch(&word, 1) > 0) {
+    bufferCount = received_count();
   }
   
-  return received;
+  return word;
 }
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-void Sensor::check_for_transition() {
+uint32_t Sensor::get_received_batch(uint32_t* buffer, uint32_t max_count, uint32_t* window_us) {
+  if(mode != CAPTURE_DMA) {
+    uint32_t count = received.pop_batch(buffer, max_count);
+    take_window_starts(window_starts, buffer, count, window_us, time_us_32(), high_resolution());
+    return count;
+  }
+
+  uint32_t count = dma_ring.pop_batch([this]() { return dma_written(); }, buffer, max_count);
+
+  //The DMA copies every word, so drop the empty ones the interrupt would have ignored, and
+  //pair up high resolution edges into pulses as the interrupt would have done
+  bool high = high_resolution();
+  uint32_t kept = 0;
+  for(uint32_t i = 0; i < count; i++) {
+    uint32_t word = buffer[i];
+    if(high && !edges.feed(word, word))
+      continue;
+    if(word > 0) {
+      buffer[kept++] = word;
+    }
+  }
+  //With no interrupt, windows can only be timed from when they are drained, so are late by
+  //however long the words waited in the ring. See drain_timed()
+  uint32_t now = time_us_32();
+  if(window_us != nullptr) {
+    uint32_t windows = 0;
+    for(uint32_t i = 0; i < kept; i++) {
+      if(LighthouseTiming::word_start(buffer[i]) == 0) {
+        window_us[windows++] = window_start(buffer[i], now, high);
+      }
+    }
+  }
+  if(kept > 0) {
+    last_on_us = now;
+  }
+  return kept;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t Sensor::received_count() const {
+  return (mode == CAPTURE_DMA) ? dma_ring.size(dma_written()) : received.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t Sensor::high_water() const {
+  return (mode == CAPTURE_DMA) ? dma_ring.high_water_mark() : received.high_water_mark();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t __not_in_flash_func(Sensor::check_for_transition)() {
+  //The timer is read once per interrupt, and only latched for words that open a window
+  uint32_t now = time_us_32();
+  uint32_t pulses = 0;
+  bool high = high_resolution();
   while(sens_pio->ints0 & (PIO_IRQ0_INTS_SM0_RXNEMPTY_BITS << sens_sm)) {    
-    uint32_t received = pio_sm_get(sens_pio, sens_sm);
-    if(received > 0) {
-      receivedBuffer[writeIndex] = received;
-      writeIndex++;
-      if(writeIndex >= BUFFER)
-        writeIndex = 0;
-      
-      last_on = millis();
+    uint32_t word = pio_sm_get(sens_pio, sens_sm);
+
+    //High resolution edges are paired into pulses here, so the ring holds pulse words either way
+    if(high && !edges.feed(word, word))
+      continue;
+    if(word > 0) {
+      if(received.push(word) && LighthouseTiming::word_start(word) == 0) {
+        window_starts.push(window_start(word, now, high));
+      }
+      pulses++;
     }
   }
+  if(pulses > 0) {
+    last_on_us = now;
+  }
+  return pulses;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void Sensor::release_program() {
+  if(resolution == RESOLUTION_HIGH)
+    lighthouse_hires_program_release(sens_pio, sens_sm);
+  else
+    lighthouse_program_release(sens_pio, sens_sm);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Sensor::init_dma() {
+  dma_channel = dma_claim_unused_channel(false);
+  if(dma_channel < 0) {
+    return false;
+  }
+
+  //Copy each word from the RX FIFO as it arrives, wrapping the write address around the ring
+  dma_channel_config c = dma_channel_get_default_config(dma_channel);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+  channel_config_set_read_increment(&c, false);
+  channel_config_set_write_increment(&c, true);
+  channel_config_set_ring(&c, true, DmaRing<RING_CAPACITY>::ring_size_bits());
+  channel_config_set_dreq(&c, pio_get_dreq(sens_pio, sens_sm, false));
+
+  //The only interrupt is for re-arming the channel, once every DMA_TRANSFER_COUNT words
+  dma_sensors[dma_channel] = this;
+  dma_channel_set_irq0_enabled(dma_channel, true);
+  if(!dma_handler_added) {
+    irq_add_shared_handler(DMA_IRQ_0, dma_interrupt_callback, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+    dma_handler_added = true;
+  }
+
+  dma_base = 0;
+  dma_channel_configure(dma_channel, &c, dma_ring.data(), &sens_pio->rxf[sens_sm], DMA_TRANSFER_COUNT, true);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t Sensor::dma_written() const {
+  //Retry if the channel was re-armed between reading the base and the remaining count
+  uint32_t base, remaining;
+  do {
+    base = dma_base;
+    remaining = dma_channel_hw_addr(dma_channel)->transfer_count;
+  } while(base != dma_base);
+  return base + (DMA_TRANSFER_COUNT - remaining);
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
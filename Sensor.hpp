@@ -2,16 +2,42 @@
 
 #include "pico/stdlib.h"
 #include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "PulseRing.hpp"
+#include "DmaRing.hpp"
+#include "PulseSource.hpp"
+#include "EdgeTimer.hpp"
+#include "IrqProfiler.hpp"
 
-class Sensor {
+//Number of pulse words each sensor can hold before the main loop drains them. Must be a power of two
+#ifndef SENSOR_RING_CAPACITY
+#define SENSOR_RING_CAPACITY 256
+#endif
+
+class Sensor : public PulseSource {
   //--------------------------------------------------
   // Constants
   //--------------------------------------------------
 public:
+  //How words get from the state machine's RX FIFO into RAM. CAPTURE_IRQ takes an interrupt per
+  //word, while CAPTURE_DMA has a DMA channel write them into a ring, interrupting only to re-arm it
+  enum CaptureMode {
+    CAPTURE_IRQ,
+    CAPTURE_DMA,
+  };
+
+  //How finely pulses are timed. RESOLUTION_STANDARD runs lighthouse.pio, counting every 15 cycles,
+  //while RESOLUTION_HIGH runs lighthouse_hires.pio, timing edges every 2 cycles at the cost of a
+  //second FIFO word per pulse. The two programs cannot share a PIO
+  enum Resolution {
+    RESOLUTION_STANDARD,
+    RESOLUTION_HIGH,
+  };
+
   static const uint16_t DEFAULT_FREQ_DIVIDER      = 1;    
   static const uint8_t PIN_UNUSED                 = UINT8_MAX;
-private:
-  static const uint32_t BUFFER = 5000;
+  static const uint32_t RING_CAPACITY             = SENSOR_RING_CAPACITY;
+  static const uint32_t DMA_TRANSFER_COUNT        = 0x80000000;   //Words per arming of the DMA channel
 
   //--------------------------------------------------
   // Variables
@@ -21,13 +47,25 @@ private:
   const uint8_t pin             = PIN_UNUSED;
   const uint8_t sideset_pin     = PIN_UNUSED;
   const uint16_t freq_divider   = DEFAULT_FREQ_DIVIDER;
+  const CaptureMode mode        = CAPTURE_IRQ;
+  const Resolution resolution   = RESOLUTION_STANDARD;
 
   //--------------------------------------------------
 
   uint sens_sm         = 0;
-  static uint sens_offset;
+  static uint sens_offset[NUM_PIOS];
+  static Resolution pio_resolution[NUM_PIOS];   //Which program is loaded, while any SMs are claimed
+
+  uint32_t last_on_us = 0;   //Kept in us as the interrupt can read the timer without leaving RAM
+
+  PulseRing<uint32_t, RING_CAPACITY> received;
+  PulseRing<uint32_t, RING_CAPACITY> window_starts;   //When each window in received opened, as time_us_32()
+
+  int dma_channel = -1;
+  volatile uint32_t dma_base = 0;   //Words written by previous armings of the channel
+  DmaRing<RING_CAPACITY> dma_ring;
 
-  uint32_t last_on = 0;
+  EdgeTimer edges;    //Only used at RESOLUTION_HIGH
 
   bool initialised = false;
 
@@ -37,8 +75,11 @@ private:
 public:
   static Sensor* pio_sensors[NUM_PIOS][NUM_PIO_STATE_MACHINES];
   static uint8_t pio_claimed_sms[NUM_PIOS];
+  static IrqProfiler irq_profile;
   static void pio0_interrupt_callback();
   static void pio1_interrupt_callback();
+  static Sensor* dma_sensors[NUM_DMA_CHANNELS];
+  static void dma_interrupt_callback();
 
 
   //--------------------------------------------------
@@ -47,7 +88,8 @@ public:
 public:
   Sensor() {}
   Sensor(PIO pio, uint8_t pin, uint8_t sideset_pin,
-         uint16_t freq_divider = DEFAULT_FREQ_DIVIDER);
+         uint16_t freq_divider = DEFAULT_FREQ_DIVIDER, CaptureMode mode = CAPTURE_IRQ,
+         Resolution resolution = RESOLUTION_STANDARD);
   ~Sensor();
 
 
@@ -55,15 +97,24 @@ public:
   // Methods
   //--------------------------------------------------
 public:    
-  bool init();
+  bool init() override;
   void start();
-  uint32_t last_on_time() { return last_on; }
+  uint32_t last_on_time() { return last_on_us; }    //In us, to compare with time_us_32()
   uint32_t get_received(uint32_t& bufferCount);
+  uint32_t get_received_batch(uint32_t* buffer, uint32_t max_count, uint32_t* window_us = nullptr) override;
+  uint32_t received_count() const override;
+  uint32_t dropped_pulses() const override { return received.dropped_count(); }
+  uint32_t overwritten_pulses() const override { return dma_ring.dropped_count(); }
+  uint32_t high_water() const override;
+  bool high_resolution() const override { return resolution == RESOLUTION_HIGH; }
+  bool drain_timed() const override { return mode == CAPTURE_DMA; }
+  CaptureMode capture_mode() const { return mode; }
 
   static uint32_t millis();
 private:
-  void check_for_transition();
-  volatile uint32_t receivedBuffer[BUFFER];
-  volatile uint32_t readIndex = 0;
-  volatile uint32_t writeIndex = 0;
+  static void dispatch(PIO pio, uint pio_idx);
+  uint32_t check_for_transition();
+  void release_program();
+  bool init_dma();
+  uint32_t dma_written() const;
 };
\ No newline at end of file
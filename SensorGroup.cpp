@@ -0,0 +1,158 @@
+#include "hardware/irq.h"
+#include "SensorGroup.hpp"
+#include "PowerManager.hpp"
+#include "sensor_group.pio.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// STATICS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SensorGroup* SensorGroup::pio_groups[][NUM_PIO_STATE_MACHINES] = { { nullptr, nullptr, nullptr, nullptr }, { nullptr, nullptr, nullptr, nullptr } };
+uint8_t SensorGroup::pio_claimed_sms[] = { 0x0, 0x0 };
+IrqProfiler SensorGroup::irq_profile;
+static bool pio_handler_added[NUM_PIOS] = { false, false };
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//The interrupt path runs from RAM, as Sensor's does
+void __not_in_flash_func(SensorGroup::pio0_interrupt_callback)() {
+  dispatch(pio0, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void __not_in_flash_func(SensorGroup::pio1_interrupt_callback)() {
+  dispatch(pio1, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void __not_in_flash_func(SensorGroup::dispatch)(PIO pio, uint pio_idx) {
+  uint32_t start = IrqProfiler::now();
+  uint32_t pulses = 0;
+
+  //Read which of our SMs have words waiting once, then visit only those. A Sensor on the
+  //same PIO has its own handler for its SMs
+  uint32_t pending = (pio->ints0 >> PIO_IRQ0_INTS_SM0_RXNEMPTY_LSB) & pio_claimed_sms[pio_idx];
+  while(pending) {
+    uint sm = __builtin_ctz(pending);
+    pending &= pending - 1;
+    pulses += pio_groups[pio_idx][sm]->check_for_edges();
+  }
+  if(pulses > 0) {
+    PowerManager::signal();
+  }
+  irq_profile.record(start, pulses);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SensorGroup::SensorGroup(PIO pio, uint8_t base_pin, uint8_t pin_count,
+                         uint16_t freq_divider) :
+  group_pio(pio), base_pin(base_pin),
+  pin_count(pin_count < SENSOR_GROUP_MAX_PINS ? pin_count : SENSOR_GROUP_MAX_PINS),
+  freq_divider(freq_divider), demux(this->pin_count) {
+  for(uint8_t c = 0; c < MAX_CHANNELS; c++) {
+    channels[c].group = this;
+    channels[c].index = c;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SensorGroup::~SensorGroup() {
+  if(initialised) {
+    sensor_group_program_release(group_pio, group_sm);
+    uint index = pio_get_index(group_pio);
+    pio_groups[index][group_sm] = nullptr;
+    pio_claimed_sms[index] &= ~(1u << group_sm);
+    pio_remove_program(group_pio, &program, group_offset);
+
+    //The handler serves every group on this PIO, so only remove it with the last
+    if(pio_claimed_sms[index] == 0 && pio_handler_added[index]) {
+      irq_remove_handler((index == 0) ? PIO0_IRQ_0 : PIO1_IRQ_0, (index == 0) ? pio0_interrupt_callback : pio1_interrupt_callback);
+      pio_handler_added[index] = false;
+    }
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SensorGroup::init() {
+  if(initialised) {
+    return true;
+  }
+
+  //Are the pins we want to use actually valid?
+  if(pin_count > 0 && base_pin + pin_count <= NUM_BANK0_GPIOS) {
+    IrqProfiler::begin();
+
+    //Patch a copy of the program for our pin count, and add that to the PIO memory
+    for(uint i = 0; i < sensor_group_program.length; i++) {
+      instructions[i] = sensor_group_program.instructions[i];
+    }
+    sensor_group_patch(instructions, pin_count);
+    program = sensor_group_program;
+    program.instructions = instructions;
+
+    group_sm = pio_claim_unused_sm(group_pio, true);
+    group_offset = pio_add_program(group_pio, &program);
+    uint pio_idx = pio_get_index(group_pio);
+
+    //Init the program on this sm
+    sensor_group_program_init(group_pio, group_sm, group_offset, base_pin, pin_count, freq_divider);
+
+    //Keep a record of this group for the interrupt callback, then enable its interrupt
+    pio_groups[pio_idx][group_sm] = this;
+    pio_claimed_sms[pio_idx] |= 1u << group_sm;
+    pio_set_irq0_source_enabled(group_pio, (pio_interrupt_source)(PIO_INTR_SM0_RXNEMPTY_LSB + group_sm), true);
+
+    //One handler serves every group on this PIO, so only add it for the first
+    if(!pio_handler_added[pio_idx]) {
+      uint irq_num = (pio_idx == 0) ? PIO0_IRQ_0 : PIO1_IRQ_0;
+      irq_add_shared_handler(irq_num, (pio_idx == 0) ? pio0_interrupt_callback : pio1_interrupt_callback,
+                             PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+      irq_set_enabled(irq_num, true);
+      pio_handler_added[pio_idx] = true;
+    }
+
+    //Start the PIO program on the SM
+    sensor_group_program_start(group_pio, group_sm);
+
+    initialised = true;
+  }
+  return initialised;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t SensorGroup::get_received_batch(uint8_t channel, uint32_t* buffer, uint32_t max_count, uint32_t* window_us) {
+  if(channel >= pin_count)
+    return 0;
+  uint32_t count = received[channel].pop_batch(buffer, max_count);
+  PulseSource::take_window_starts(window_starts[channel], buffer, count, window_us, time_us_32());
+  return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t __not_in_flash_func(SensorGroup::check_for_edges)() {
+  uint32_t pulse_words[MAX_CHANNELS];
+  uint8_t channels[MAX_CHANNELS];
+  uint32_t pulses = 0;
+
+  while(group_pio->ints0 & (PIO_IRQ0_INTS_SM0_RXNEMPTY_BITS << group_sm)) {
+    uint32_t word = pio_sm_get(group_pio, group_sm);
+    uint32_t now = time_us_32();
+    uint32_t count = demux.feed(word, now, pulse_words, channels);
+    for(uint32_t i = 0; i < count; i++) {
+      uint8_t c = channels[i];
+      if(received[c].push(pulse_words[i]) && LighthouseTiming::word_start(pulse_words[i]) == 0) {
+        window_starts[c].push(PulseSource::window_start(pulse_words[i], now));
+      }
+    }
+    pulses += count;
+  }
+  return pulses;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
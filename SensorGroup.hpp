@@ -0,0 +1,113 @@
+#pragma once
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "PulseRing.hpp"
+#include "PulseSource.hpp"
+#include "EdgeDemux.hpp"
+#include "IrqProfiler.hpp"
+
+//Number of pulse words each channel of a group can hold before the main loop drains them. Must be a power of two
+#ifndef SENSOR_GROUP_RING_CAPACITY
+#define SENSOR_GROUP_RING_CAPACITY 128
+#endif
+
+// Reads a contiguous block of sensor pins with a single state machine running
+// sensor_group.pio, rather than one state machine per sensor as Sensor does.
+//
+// The state machine pushes a word whenever any pin changes, and the interrupt splits
+// these back into the same per-sensor pulse words lighthouse.pio produces (see
+// EdgeDemux), so they can be drained and decoded exactly like a Sensor's. Channels
+// are numbered by their pin's offset from the base pin, and each is a PulseSource
+class SensorGroup {
+  //--------------------------------------------------
+  // Types
+  //--------------------------------------------------
+public:
+  class Channel : public PulseSource {
+    friend class SensorGroup;
+  private:
+    SensorGroup* group = nullptr;
+    uint8_t index = 0;
+  public:
+    bool init() override { return group->init(); }
+    uint32_t get_received_batch(uint32_t* buffer, uint32_t max_count, uint32_t* window_us = nullptr) override {
+      return group->get_received_batch(index, buffer, max_count, window_us);
+    }
+    uint32_t received_count() const override { return group->received_count(index); }
+    uint32_t dropped_pulses() const override { return group->dropped_pulses(index); }
+    uint32_t high_water() const override { return group->received[index].high_water_mark(); }
+  };
+
+
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint16_t DEFAULT_FREQ_DIVIDER      = 1;
+  static const uint8_t MAX_CHANNELS               = EdgeDemux::MAX_CHANNELS;
+  static const uint32_t RING_CAPACITY             = SENSOR_GROUP_RING_CAPACITY;
+  static const uint32_t MAX_PROGRAM_LENGTH        = 32;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  const PIO group_pio;
+  const uint8_t base_pin;
+  const uint8_t pin_count;
+  const uint16_t freq_divider;
+
+  //--------------------------------------------------
+
+  uint group_sm       = 0;
+  uint group_offset   = 0;
+
+  //The program is patched for the pin count, so each group loads its own copy
+  uint16_t instructions[MAX_PROGRAM_LENGTH];
+  pio_program_t program;
+
+  EdgeDemux demux;
+  PulseRing<uint32_t, RING_CAPACITY> received[MAX_CHANNELS];
+  PulseRing<uint32_t, RING_CAPACITY> window_starts[MAX_CHANNELS];   //When each window in received opened
+  Channel channels[MAX_CHANNELS];
+
+  bool initialised = false;
+
+  //--------------------------------------------------
+  // Statics
+  //--------------------------------------------------
+public:
+  static SensorGroup* pio_groups[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+  static uint8_t pio_claimed_sms[NUM_PIOS];
+  static IrqProfiler irq_profile;
+  static void pio0_interrupt_callback();
+  static void pio1_interrupt_callback();
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  SensorGroup(PIO pio, uint8_t base_pin, uint8_t pin_count,
+              uint16_t freq_divider = DEFAULT_FREQ_DIVIDER);
+  ~SensorGroup();
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Safe to call more than once, such as from each of the group's channels
+  bool init();
+  uint8_t channel_count() const { return pin_count; }
+  PulseSource* channel(uint8_t index) { return &channels[index]; }
+  uint32_t get_received_batch(uint8_t channel, uint32_t* buffer, uint32_t max_count, uint32_t* window_us = nullptr);
+  uint32_t received_count(uint8_t channel) const { return received[channel].size(); }
+  uint32_t dropped_pulses(uint8_t channel) const { return received[channel].dropped_count(); }
+  uint32_t edge_count() const { return demux.edges(); }
+private:
+  static void dispatch(PIO pio, uint pio_idx);
+  uint32_t check_for_edges();
+};
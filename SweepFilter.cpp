@@ -0,0 +1,121 @@
+#include "SweepFilter.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// GAINS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+  constexpr double const_sqrt(double x) {
+    double r = x > 1.0 ? x : 1.0;
+    for(int i = 0; i < 40; i++)
+      r = 0.5 * (r + x / r);
+    return r;
+  }
+
+  //Kalata's steady-state gains for the alpha-beta filter
+  constexpr double LAMBDA = SweepFilter::TRACKING_INDEX;
+  constexpr double R_TERM = (4.0 + LAMBDA - const_sqrt(8.0 * LAMBDA + LAMBDA * LAMBDA)) / 4.0;
+  constexpr double ALPHA  = 1.0 - R_TERM * R_TERM;
+  constexpr double BETA   = 2.0 * (2.0 - ALPHA) - 4.0 * const_sqrt(1.0 - ALPHA);
+}
+
+const int32_t SweepFilter::ALPHA_Q16 = (int32_t)(ALPHA * 65536.0 + 0.5);
+const int32_t SweepFilter::BETA_Q16 = (int32_t)(BETA * 65536.0 + 0.5);
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SweepFilter::SweepFilter(uint8_t num_sensors, uint32_t output_interval_us) :
+  num_sensors(num_sensors < MAX_SENSORS ? num_sensors : MAX_SENSORS),
+  output_interval_us(output_interval_us) {
+  for(uint8_t a = 0; a < NUM_AXES; a++) {
+    for(uint8_t s = 0; s < MAX_SENSORS; s++) {
+      angle[a][s] = 0;
+      rate[a][s] = 0;
+      last_time[a][s] = 0;
+    }
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SweepFilter::update(uint8_t sensor, uint8_t axis, int32_t measured, uint32_t timestamp_us) {
+  if(sensor >= num_sensors || axis >= NUM_AXES)
+    return;
+
+  uint32_t bit = 1u << sensor;
+  uint32_t dt = timestamp_us - last_time[axis][sensor];
+  last_time[axis][sensor] = timestamp_us;
+
+  if(!(started[axis] & bit) || dt > STALE_US) {
+    //First measurement (or after a dropout), so there is nothing to predict from
+    angle[axis][sensor] = measured;
+    rate[axis][sensor] = 0;
+    started[axis] |= bit;
+    return;
+  }
+  if(dt == 0) {
+    return;
+  }
+
+  int32_t predicted = angle[axis][sensor] + (int32_t)(((int64_t)rate[axis][sensor] * dt) >> RATE_SHIFT);
+  int32_t residual = measured - predicted;
+
+  angle[axis][sensor] = predicted + (int32_t)(((int64_t)residual * ALPHA_Q16) >> 16);
+  rate[axis][sensor] += (int32_t)((((int64_t)residual * BETA_Q16) << (RATE_SHIFT - 16)) / dt);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int32_t SweepFilter::predict(uint8_t sensor, uint8_t axis, uint32_t timestamp_us) const {
+  if(sensor >= num_sensors || axis >= NUM_AXES)
+    return 0;
+
+  int32_t dt = (int32_t)(timestamp_us - last_time[axis][sensor]);
+  if(dt > (int32_t)MAX_PREDICT_US)
+    dt = MAX_PREDICT_US;
+  else if(dt < -(int32_t)MAX_PREDICT_US)
+    dt = -(int32_t)MAX_PREDICT_US;
+
+  return angle[axis][sensor] + (int32_t)(((int64_t)rate[axis][sensor] * dt) >> RATE_SHIFT);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t SweepFilter::valid_mask(uint32_t timestamp_us) const {
+  uint32_t mask = started[0] & started[1];
+  for(uint8_t s = 0; s < num_sensors; s++) {
+    uint32_t bit = 1u << s;
+    if((mask & bit) && (timestamp_us - last_time[0][s] > STALE_US || timestamp_us - last_time[1][s] > STALE_US))
+      mask &= ~bit;
+  }
+  return mask;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SweepFilter::output_due(uint32_t now_us) {
+  if(!output_started) {
+    next_output_us = now_us + output_interval_us;
+    output_started = true;
+    return false;
+  }
+
+  if((int32_t)(now_us - next_output_us) < 0)
+    return false;
+
+  next_output_us += output_interval_us;
+  if((int32_t)(now_us - next_output_us) >= 0) {
+    //Fallen more than a whole interval behind, so skip ahead rather than burst
+    next_output_us = now_us + output_interval_us;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int32_t SweepFilter::rate_dps(uint8_t sensor, uint8_t axis) const {
+  return (int32_t)(((int64_t)rate[axis][sensor] * 1000000) >> RATE_SHIFT);
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+// Predicts each sensor's X and Y sweep angles between lighthouse sweeps.
+//
+// Every axis of every sensor has its own constant-velocity alpha-beta filter (the
+// steady-state form of a 2 state Kalman filter), updated as each individual sweep
+// arrives rather than waiting for a complete X/Y pair. The filtered angle can then be
+// extrapolated to any timestamp, or sampled at a fixed output rate, to cut the
+// latency between motion and output.
+//
+// The gains are derived at compile time from TRACKING_INDEX, the ratio of expected
+// motion to measurement noise over one sweep period. Higher values follow motion
+// more closely, lower values smooth more.
+class SweepFilter {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint8_t MAX_SENSORS          = 32;
+  static const uint8_t NUM_AXES             = 2;
+  static const uint32_t MAX_PREDICT_US      = 25000;    //Hold the last prediction past this, rather than run away
+  static const uint32_t STALE_US            = 100000;   //Restart an axis that has not updated for this long
+  static const uint8_t RATE_SHIFT           = 20;       //Rates are kept in Q16 degrees per 2^20us (~1s)
+
+  static constexpr double TRACKING_INDEX    = 0.5;
+
+  static const int32_t ALPHA_Q16;             //Derived from TRACKING_INDEX, see SweepFilter.cpp
+  static const int32_t BETA_Q16;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  const uint8_t num_sensors;
+  const uint32_t output_interval_us;
+
+  int32_t angle[NUM_AXES][MAX_SENSORS];       //Q16 degrees at last_time
+  int32_t rate[NUM_AXES][MAX_SENSORS];        //Q16 degrees per 2^20us
+  uint32_t last_time[NUM_AXES][MAX_SENSORS];
+  uint32_t started[NUM_AXES] = { 0, 0 };      //Bitmasks of sensors whose axes have a measurement
+
+  uint32_t next_output_us = 0;
+  bool output_started = false;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  SweepFilter(uint8_t num_sensors, uint32_t output_interval_us);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Folds in a measured Q16.16 degree angle for one axis (0 = X, 1 = Y)
+  void update(uint8_t sensor, uint8_t axis, int32_t measured, uint32_t timestamp_us);
+
+  //The expected Q16.16 degree angle of an axis at the given time
+  int32_t predict(uint8_t sensor, uint8_t axis, uint32_t timestamp_us) const;
+
+  //Sensors with recent measurements on both axes
+  uint32_t valid_mask(uint32_t timestamp_us) const;
+
+  //Returns true once per output interval, for sampling predictions at a fixed rate
+  bool output_due(uint32_t now_us);
+
+  int32_t rate_dps(uint8_t sensor, uint8_t axis) const;   //Q16 degrees per second
+  void reset() { started[0] = started[1] = 0; }
+};
@@ -0,0 +1,77 @@
+#include "SyncTracker.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SyncTracker::Result SyncTracker::sync(uint32_t time_us) {
+  if(!started) {
+    restart(time_us);
+    return SYNC_NEW;
+  }
+
+  int32_t elapsed = (int32_t)(time_us - last_us);
+  int32_t max_gap = (int32_t)((MAX_MISSED * period_q8) >> PERIOD_FRACTION_BITS);
+  if(elapsed > max_gap) {
+    restart(time_us);
+    return SYNC_NEW;
+  }
+  if(elapsed < -max_gap)
+    return SYNC_REPEAT;     //Too far behind to check against the loop
+
+  //Round to whole periods either way, to bridge any syncs that were missed or match one already seen
+  int32_t period = (int32_t)period_q8;
+  int32_t elapsed_q8 = elapsed * (1 << PERIOD_FRACTION_BITS) - (int32_t)last_frac;
+  int32_t cycles = (elapsed_q8 >= 0 ? elapsed_q8 + period / 2 : elapsed_q8 - period / 2) / period;
+  int32_t error_q8 = elapsed_q8 - cycles * period;
+
+  if(error_q8 > (int32_t)(LOCK_TOLERANCE_US << PERIOD_FRACTION_BITS) || error_q8 < -(int32_t)(LOCK_TOLERANCE_US << PERIOD_FRACTION_BITS)) {
+    outlier_count++;
+    if(cycles > 0 && ++outliers_in_row >= REACQUIRE_OUTLIERS) {
+      restart(time_us);
+      return SYNC_NEW;
+    }
+    return SYNC_OUTLIER;
+  }
+  if(cycles <= 0)
+    return SYNC_REPEAT;
+  outliers_in_row = 0;
+
+  //Steer the phase and period, with the error shared between any missed cycles
+  uint32_t advance_q8 = last_frac + cycles * period + error_q8 / (1 << PHASE_SHIFT);
+  period_q8 += error_q8 / (cycles << PERIOD_SHIFT);
+  last_us += advance_q8 >> PERIOD_FRACTION_BITS;
+  last_frac = advance_q8 & ((1u << PERIOD_FRACTION_BITS) - 1);
+
+  if(good < LOCK_COUNT)
+    good++;
+  if(locked())
+    update_window();
+  return SYNC_NEW;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SyncTracker::restart(uint32_t time_us) {
+  if(started)
+    restart_count++;
+  started = true;
+  last_us = time_us;
+  last_frac = 0;
+  good = 0;
+  outliers_in_row = 0;
+  sweep_min = 0;
+  sweep_span = UINT32_MAX;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SyncTracker::update_window() {
+  //The period in mid2 units: start + end counts, with MID2_FRACTION_BITS
+  uint32_t period_mid2 = (uint32_t)(((uint64_t)period_q8 * 2000000 << LighthouseTiming::MID2_FRACTION_BITS)
+                                    / (LighthouseTiming::PS_PER_COUNT << PERIOD_FRACTION_BITS));
+
+  //The sweep crosses the middle of the cycle at 0 degrees, and covers 180 degrees per period
+  sweep_min = (uint32_t)((uint64_t)period_mid2 * (90 - SWEEP_WINDOW_DEG) / 180);
+  sweep_span = (uint32_t)((uint64_t)period_mid2 * (2 * SWEEP_WINDOW_DEG) / 180);
+  scale_q16 = (uint32_t)(((uint64_t)ANGLE_PERIOD_NS << (16 + PERIOD_FRACTION_BITS)) / ((uint64_t)period_q8 * 1000));
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include "LighthouseTiming.hpp"
+
+// Phase-locks to one lighthouse's syncs, so the decoder knows when its next sync and
+// sweeps are due and how long its cycles really are.
+//
+// Each sync's time is compared against the one predicted from the last, and a second
+// order loop steers the predicted phase by a quarter of the error and the period by a
+// 1/64th of it, which settles in a few dozen cycles while averaging out the jitter of
+// the microsecond window latches. The time since the last sync is rounded to whole
+// periods, which bridges any syncs that were missed, and matches a sync at or before the
+// last one to one already seen by another sensor (or in a batch decoded behind). Either
+// way, one far from a whole number of periods is an outlier. Only REACQUIRE_OUTLIERS new
+// ones in a row restart the loop, so a stray pulse that opens a window cannot pull it off.
+//
+// Once locked, a sweep is only in its window if its midpoint lies within SWEEP_WINDOW_DEG
+// of the middle of the measured period, which costs one comparison per pulse. Sweep
+// midpoints can also be rescaled from the measured period to the one the fixed angle
+// constants in LighthouseTiming assume. It has no dependency on the Pico SDK
+class SyncTracker {
+  //--------------------------------------------------
+  // Types
+  //--------------------------------------------------
+public:
+  enum Result : uint8_t {
+    SYNC_NEW,       //The next sync, which has updated the loop
+    SYNC_REPEAT,    //A sync already seen
+    SYNC_OUTLIER,   //Not where a sync should be
+  };
+
+
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint32_t NOMINAL_PERIOD_US   = 8333;   //A Lighthouse 1.0 cycle, 120 per second
+  static const uint32_t LOCK_TOLERANCE_US   = 50;     //Further than this from the prediction is an outlier
+  static const uint8_t LOCK_COUNT           = 16;     //Syncs in tolerance before the period is trusted
+  static const uint8_t REACQUIRE_OUTLIERS   = 3;
+  static const uint8_t MAX_MISSED           = 16;     //Longer gaps than this many periods restart the loop
+  static const uint8_t PHASE_SHIFT          = 2;
+  static const uint8_t PERIOD_SHIFT         = 6;
+  static const uint8_t PERIOD_FRACTION_BITS = 8;
+  static const uint32_t SWEEP_WINDOW_DEG    = 65;     //Either side of the middle, a little past the 120 degree field of view
+
+  //The sweep period the fixed angle constants assume, 180 degrees over twice the half range
+  static constexpr uint32_t ANGLE_PERIOD_NS = LighthouseTiming::SWEEP_HALF_RANGE_NS * 2;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  uint32_t last_us = 0;           //The filtered time of the last sync, in whole us
+  uint32_t last_frac = 0;         //and its fraction, with PERIOD_FRACTION_BITS
+  uint32_t period_q8 = NOMINAL_PERIOD_US << PERIOD_FRACTION_BITS;
+  bool started = false;
+  uint8_t good = 0;               //Syncs in tolerance since the last restart, up to LOCK_COUNT
+  uint8_t outliers_in_row = 0;
+
+  uint32_t sweep_min = 0;         //The sweep window, as SweepEvent::mid2
+  uint32_t sweep_span = UINT32_MAX;
+  uint32_t scale_q16 = 1u << 16;
+
+  uint32_t outlier_count = 0;
+  uint32_t restart_count = 0;
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Feeds the time a sync rose at, as time_us_32()
+  Result sync(uint32_t time_us);
+
+  bool locked() const { return good >= LOCK_COUNT; }
+
+  //Whether a sweep midpoint (as SweepEvent::mid2, from this station's sync) is where one can be.
+  //Always true until locked
+  bool in_sweep_window(uint32_t mid2) const { return mid2 - sweep_min < sweep_span; }
+
+  //Rescales a sweep midpoint from the measured period to ANGLE_PERIOD_NS, so
+  //LighthouseTiming::mid2_to_angle gives 0 at the middle of the cycle and 180 degrees per period
+  uint32_t normalise(uint32_t mid2) const { return (uint32_t)(((uint64_t)mid2 * scale_q16) >> 16); }
+
+  //The measured period with PERIOD_FRACTION_BITS, and when the next sync is due
+  uint32_t period() const { return period_q8; }
+  uint32_t period_us() const { return period_q8 >> PERIOD_FRACTION_BITS; }
+  uint32_t next_sync_us() const { return last_us + ((last_frac + period_q8) >> PERIOD_FRACTION_BITS); }
+
+  uint32_t outliers() const { return outlier_count; }
+  uint32_t restarts() const { return restart_count; }
+private:
+  void restart(uint32_t time_us);
+  void update_window();
+};
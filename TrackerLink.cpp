@@ -0,0 +1,269 @@
+#include "TrackerLink.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+TrackerLink::TrackerLink(LinkPort& port, uint8_t tracker_id, uint8_t sensors_per_tracker, uint32_t baud) :
+  port(port), tracker_id(tracker_id), sensors_per_tracker(sensors_per_tracker), baud(baud), reader(on_frame, this) {
+  pending.count = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TrackerLink::service() {
+  uint8_t data[64];
+  uint32_t length;
+  while((length = port.read(data, sizeof(data), frame_time_us)) > 0) {
+    reader.feed(data, length);
+  }
+
+  uint32_t now = port.time_us();
+  if(pending.count > 0 && now - pending_since_us >= FLUSH_INTERVAL_US) {
+    flush_events();
+  }
+  if(is_aggregator() && now - last_beacon_us >= BEACON_INTERVAL_US) {
+    beacon_due = true;
+    beacon_hops = 0;
+  }
+
+  flush_tx();
+  if(beacon_due && tx_read == tx_write && port.tx_idle()) {
+    send_beacon();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TrackerLink::send(const SweepEvent* events, uint32_t count) {
+  if(is_aggregator())
+    return;
+
+  for(uint32_t e = 0; e < count; e++) {
+    const SweepEvent& event = events[e];
+    if(event.type != SweepEvent::SWEEP)
+      continue;
+    if(!locked()) {
+      events_dropped++;
+      continue;
+    }
+
+    if(pending.count == 0)
+      pending_since_us = port.time_us();
+    uint8_t i = pending.count++;
+    pending.timestamp_us[i] = link_time(event.timestamp_us);
+    pending.mid2[i] = event.mid2;
+    pending.sensor[i] = event.sensor;
+    pending.axis[i] = event.axis;
+    pending.station[i] = event.station;
+    if(pending.count == FrameCodec::LINK_MAX_EVENTS)
+      flush_events();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t TrackerLink::take(SweepEvent* events, uint32_t max_count) {
+  return received.pop_batch(events, max_count);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t TrackerLink::link_time(uint32_t local_us) const {
+  if(is_aggregator())
+    return local_us;
+
+  return local_us + offset_us + (int32_t)((predict_q16(local_us) + 0x8000) >> 16);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TrackerLink::on_frame(const uint8_t* data, uint32_t length, void* context) {
+  TrackerLink* link = (TrackerLink*)context;
+  if(data[0] == FrameCodec::FRAME_LINK_SYNC) {
+    link->handle_beacon(data, length);
+  }
+  else if(data[0] == FrameCodec::FRAME_LINK_EVENTS) {
+    link->handle_events(data, length);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TrackerLink::handle_beacon(const uint8_t* data, uint32_t length) {
+  FrameCodec::LinkSyncFrame frame;
+  if(!FrameCodec::parse_link_sync(data, length, frame)) {
+    bad_frames++;
+    return;
+  }
+
+  //Back round the ring, or circling one with no aggregator
+  if(is_aggregator() || frame.hops >= MAX_TRACKERS)
+    return;
+
+  //The beacon was stamped as its first byte went out, and its delimiter has just arrived
+  beacons_received++;
+  uint32_t arrived_us = frame.header.timestamp_us + transit_us(length);
+  update_clock(frame_time_us, (int32_t)(arrived_us - frame_time_us));
+
+  if(started) {
+    beacon_due = true;
+    beacon_hops = frame.hops + 1;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TrackerLink::handle_events(const uint8_t* data, uint32_t length) {
+  if(!FrameCodec::parse_link_events(data, length, incoming)) {
+    bad_frames++;
+    return;
+  }
+
+  //Our own frames, back round the ring with no aggregator to take them
+  if(incoming.tracker == tracker_id)
+    return;
+
+  if(!is_aggregator()) {
+    if(queue(scratch, FrameCodec::cobs_encode(data, length, scratch)))
+      frames_forwarded++;
+    else
+      events_dropped += incoming.count;
+    return;
+  }
+
+  if(incoming.tracker >= MAX_TRACKERS || incoming.header.sensor_count != sensors_per_tracker) {
+    bad_frames++;
+    return;
+  }
+
+  for(uint8_t i = 0; i < incoming.count; i++) {
+    uint32_t sensor = (uint32_t)incoming.tracker * sensors_per_tracker + incoming.sensor[i];
+    if(incoming.sensor[i] >= sensors_per_tracker || sensor >= PulseDecoder::MAX_SENSORS) {
+      events_dropped++;
+      continue;
+    }
+
+    SweepEvent event;
+    event.mid2 = incoming.mid2[i];
+    event.timestamp_us = incoming.timestamp_us[i];
+    event.sensor = (uint8_t)sensor;
+    event.axis = incoming.axis[i];
+    event.station = incoming.station[i];
+    event.type = SweepEvent::SWEEP;
+    if(received.push(event))
+      events_received++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TrackerLink::update_clock(uint32_t time_us, int32_t sample_us) {
+  int32_t elapsed = (int32_t)(time_us - base_us);
+  if(!started || elapsed < 0 || (uint32_t)elapsed > MAX_BEACON_GAP_US) {
+    restart(time_us, sample_us);
+    return;
+  }
+  if(elapsed == 0)
+    return;
+
+  //Both relative to offset_us, so the clocks' difference can be anything
+  int64_t predicted = predict_q16(time_us);
+  int64_t error = ((int64_t)(sample_us - offset_us) << 16) - predicted;
+  if(error > ((int64_t)SYNC_TOLERANCE_US << 16) || error < -((int64_t)SYNC_TOLERANCE_US << 16)) {
+    outlier_count++;
+    if(++outliers_in_row >= REACQUIRE_OUTLIERS)
+      restart(time_us, sample_us);
+    return;
+  }
+
+  outliers_in_row = 0;
+  int64_t offset = predicted + error / (1 << PHASE_SHIFT);
+  base_us = time_us;
+  offset_us += (int32_t)(offset >> 16);
+  offset_frac = (uint32_t)(offset & 0xffff);
+  drift_q32 += (int32_t)((error << 16) / ((int64_t)elapsed << DRIFT_SHIFT));
+  if(good < LOCK_COUNT)
+    good++;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TrackerLink::restart(uint32_t time_us, int32_t sample_us) {
+  if(started)
+    restart_count++;
+  started = true;
+  good = 0;
+  outliers_in_row = 0;
+  base_us = time_us;
+  offset_us = sample_us;
+  offset_frac = 0;
+  drift_q32 = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int64_t TrackerLink::predict_q16(uint32_t time_us) const {
+  //The offset at a time, less offset_us, with 16 fraction bits
+  int32_t elapsed = (int32_t)(time_us - base_us);
+  return offset_frac + (((int64_t)drift_q32 * elapsed) >> 16);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t TrackerLink::transit_us(uint32_t decoded_length) const {
+  //COBS adds a byte (for frames this short) and the delimiter, and each byte is 10 bits on the wire
+  return (uint32_t)((uint64_t)(decoded_length + 2) * 10 * 1000000 / baud);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TrackerLink::flush_events() {
+  pending.header.sensor_count = sensors_per_tracker;
+  pending.header.sequence = sequence++;
+  pending.header.timestamp_us = link_time(port.time_us());
+  pending.tracker = tracker_id;
+  if(queue(scratch, FrameCodec::encode_link_events(pending, scratch)))
+    events_sent += pending.count;
+  else
+    events_dropped += pending.count;
+  pending.count = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TrackerLink::send_beacon() {
+  FrameCodec::LinkSyncFrame frame;
+  frame.header.sequence = sequence++;
+  frame.hops = beacon_hops;
+
+  uint32_t now = port.time_us();
+  frame.header.timestamp_us = link_time(now);
+  uint32_t length = FrameCodec::encode_link_sync(frame, scratch);
+  uint32_t written = port.write(scratch, length);
+  queue(scratch + written, length - written);
+
+  beacons_sent++;
+  beacon_due = false;
+  last_beacon_us = now;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TrackerLink::queue(const uint8_t* data, uint32_t length) {
+  if(TX_CAPACITY - (tx_write - tx_read) < length) {
+    frames_dropped++;
+    return false;
+  }
+
+  for(uint32_t i = 0; i < length; i++) {
+    tx[tx_write++ & TX_MASK] = data[i];
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TrackerLink::flush_tx() {
+  while(tx_read != tx_write) {
+    uint32_t first = tx_read & TX_MASK;
+    uint32_t run = TX_CAPACITY - first;
+    if(run > tx_write - tx_read)
+      run = tx_write - tx_read;
+
+    uint32_t written = port.write(tx + first, run);
+    tx_read += written;
+    if(written < run)
+      break;
+  }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <stdint.h>
+#include "LinkPort.hpp"
+#include "FrameCodec.hpp"
+#include "FrameReader.hpp"
+#include "PulseDecoder.hpp"
+#include "PulseRing.hpp"
+
+// Chains several trackers over a serial ring, so sensors on different boards can be
+// merged into one time-aligned stream and share one USB link to the host.
+//
+// Each board's TX goes to the next one's RX, with the last wired back to the first.
+// Tracker AGGREGATOR_ID is the aggregator: every BEACON_INTERVAL_US it sends a link sync
+// frame stamped with its clock as the frame is written to an idle line (see FrameCodec).
+// Each follower passes the beacon on, re-stamped in its own view of that clock, and its
+// arrival gives a sample of the offset between the clocks once the time its bytes spent
+// on the wire is added back. A second order loop steers the offset by a quarter of each
+// error and its drift by a 1/64th, as SyncTracker does for lighthouse syncs, so the
+// crystals' ppm differences are followed between beacons. Only REACQUIRE_OUTLIERS
+// outliers in a row restart it.
+//
+// Once locked, a follower batches its sweeps into link events frames with their times
+// converted to the aggregator's clock, flushed when full or FLUSH_INTERVAL_US after the
+// first, and passes on every other tracker's frames. The aggregator takes them all, with
+// each sensor renumbered to tracker * sensors_per_tracker + sensor, ready to apply to a
+// decoder sized for every tracker's sensors. OOTX bits are not sent, as the aggregator's
+// own sensors decode each lighthouse's calibration. It has no dependency on the Pico SDK
+class TrackerLink {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint8_t AGGREGATOR_ID          = 0;
+  static const uint8_t MAX_TRACKERS           = 8;
+  static const uint32_t BEACON_INTERVAL_US    = 50000;
+  static const uint32_t FLUSH_INTERVAL_US     = 2000;
+  static const uint32_t SYNC_TOLERANCE_US     = 200;      //Further than this from the prediction is an outlier
+  static const uint32_t MAX_BEACON_GAP_US     = 1000000;  //Longer gaps than this restart the loop
+  static const uint8_t LOCK_COUNT             = 16;       //Beacons in tolerance before events are sent
+  static const uint8_t REACQUIRE_OUTLIERS     = 3;
+  static const uint8_t PHASE_SHIFT            = 2;
+  static const uint8_t DRIFT_SHIFT            = 6;
+  static const uint32_t TX_CAPACITY           = 1024;
+  static const uint32_t TX_MASK               = TX_CAPACITY - 1;
+  static const uint32_t RECEIVED_CAPACITY     = 128;
+
+  static_assert((TX_CAPACITY & TX_MASK) == 0, "TX_CAPACITY must be a power of two");
+  static_assert(TX_CAPACITY >= 2 * FrameCodec::MAX_ENCODED_SIZE, "TX_CAPACITY too small for a frame being sent and one waiting");
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  LinkPort& port;
+  const uint8_t tracker_id;
+  const uint8_t sensors_per_tracker;
+  const uint32_t baud;
+
+  FrameReader reader;
+  uint32_t frame_time_us = 0;     //When the frame being read arrived
+  uint8_t scratch[FrameCodec::MAX_ENCODED_SIZE];
+  FrameCodec::LinkEventsFrame incoming;
+
+  uint8_t tx[TX_CAPACITY];
+  uint32_t tx_read = 0;
+  uint32_t tx_write = 0;
+  uint16_t sequence = 0;
+
+  bool beacon_due = false;
+  uint8_t beacon_hops = 0;
+  uint32_t last_beacon_us = 0;
+
+  //The aggregator's clock less ours as of base_us, in whole us and a Q16 fraction, and how
+  //fast it changes (Q32 us per us)
+  bool started = false;
+  uint8_t good = 0;
+  uint8_t outliers_in_row = 0;
+  uint32_t base_us = 0;
+  int32_t offset_us = 0;
+  uint32_t offset_frac = 0;
+  int32_t drift_q32 = 0;
+
+  FrameCodec::LinkEventsFrame pending;
+  uint32_t pending_since_us = 0;
+  PulseRing<SweepEvent, RECEIVED_CAPACITY> received;
+
+  uint32_t beacons_sent = 0;
+  uint32_t beacons_received = 0;
+  uint32_t outlier_count = 0;
+  uint32_t restart_count = 0;
+  uint32_t events_sent = 0;
+  uint32_t events_received = 0;
+  uint32_t events_dropped = 0;
+  uint32_t frames_forwarded = 0;
+  uint32_t frames_dropped = 0;
+  uint32_t bad_frames = 0;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  //Every tracker on the ring must have the same number of sensors. baud is the line rate,
+  //for the time each frame spends on the wire
+  TrackerLink(LinkPort& port, uint8_t tracker_id, uint8_t sensors_per_tracker, uint32_t baud);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Reads what has arrived, flushes events that have waited long enough, and sends
+  //whatever is queued, including any beacon due. Called every pass of the main loop
+  void service();
+
+  //Follower side. Queues a batch of decoded events to be sent to the aggregator
+  void send(const SweepEvent* events, uint32_t count);
+
+  //Aggregator side. Takes up to max_count of the events other trackers have sent, in the
+  //order they arrived
+  uint32_t take(SweepEvent* events, uint32_t max_count);
+
+  bool is_aggregator() const { return tracker_id == AGGREGATOR_ID; }
+  bool locked() const { return is_aggregator() || good >= LOCK_COUNT; }
+
+  //A time in the local clock, as the aggregator's clock would give it
+  uint32_t link_time(uint32_t local_us) const;
+
+  //How fast the aggregator's clock runs against ours, in parts per billion
+  int32_t drift_ppb() const { return (int32_t)(((int64_t)drift_q32 * 1000000000) >> 32); }
+
+  uint32_t beacons_out() const { return beacons_sent; }
+  uint32_t beacons_in() const { return beacons_received; }
+  uint32_t outliers() const { return outlier_count; }
+  uint32_t restarts() const { return restart_count; }
+  uint32_t events_out() const { return events_sent; }
+  uint32_t events_in() const { return events_received; }
+  uint32_t events_lost() const { return events_dropped + received.dropped_count(); }   //Unlocked, or no room to send or take
+  uint32_t forwarded() const { return frames_forwarded; }
+  uint32_t frames_lost() const { return frames_dropped; }   //No room to queue
+  uint32_t bad_count() const { return bad_frames + reader.bad_count(); }
+private:
+  static void on_frame(const uint8_t* data, uint32_t length, void* context);
+  void handle_beacon(const uint8_t* data, uint32_t length);
+  void handle_events(const uint8_t* data, uint32_t length);
+  void update_clock(uint32_t time_us, int32_t sample_us);
+  void restart(uint32_t time_us, int32_t sample_us);
+  int64_t predict_q16(uint32_t time_us) const;
+  uint32_t transit_us(uint32_t decoded_length) const;
+  void flush_events();
+  void send_beacon();
+  bool queue(const uint8_t* data, uint32_t length);
+  void flush_tx();
+};
@@ -0,0 +1,75 @@
+#include "TrackerState.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TrackerState::publish(const TrackerSnapshot& snapshot) {
+  uint32_t count = published.load(std::memory_order_relaxed);
+  Slot& slot = slots[count % SLOTS];
+
+  //Mark the slot as being written before any of it changes
+  uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.snapshot = snapshot;
+  slot.snapshot.sequence = count + 1;
+
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+  latest_us.store(snapshot.timestamp_us, std::memory_order_relaxed);
+  published.store(count + 1, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TrackerState::read(TrackerSnapshot& out, uint32_t* retries) const {
+  while(true) {
+    uint32_t count = published.load(std::memory_order_acquire);
+    if(count == 0)
+      return false;
+
+    const Slot& slot = slots[(count - 1) % SLOTS];
+    uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if((sequence & 1) == 0) {
+      out = slot.snapshot;
+
+      //The copy must be finished before the sequence is checked again
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(slot.sequence.load(std::memory_order_relaxed) == sequence)
+        return true;
+    }
+    if(retries != nullptr)
+      (*retries)++;
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+StateSubscriber::StateSubscriber(const TrackerState& state, uint32_t interval_us) :
+  state(state), interval_us(interval_us) {
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool StateSubscriber::poll(TrackerSnapshot& out) {
+  uint32_t count = state.publish_count();
+  if(count == last_sequence)
+    return false;
+  if(last_sequence != 0 && state.latest_timestamp_us() - last_us < interval_us)
+    return false;
+
+  if(!state.read(out, &retries))
+    return false;
+
+  skipped += out.sequence - last_sequence - 1;
+  last_sequence = out.sequence;
+  last_us = out.timestamp_us;
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "PoseSolver.hpp"
+
+// The latest angles (and pose) the tracker has output, as one consistent record.
+struct TrackerSnapshot {
+  static const uint8_t MAX_SENSORS = 32;
+
+  uint32_t sequence;                  //Snapshots published before and including this one
+  uint32_t timestamp_us;              //When the sample was taken, as time_us_32()
+  uint8_t station;
+  uint8_t sensor_count;
+  uint32_t valid_mask;                //Bit n set if sensor n has fresh angles
+  int32_t x_angle[MAX_SENSORS];       //Degrees as Q16.16, calibrated when the station's OOTX info is known
+  int32_t y_angle[MAX_SENSORS];
+  uint32_t sweep_us[MAX_SENSORS];     //When each sensor's angles were measured, or predicted for
+
+  bool has_pose;
+  uint8_t pose_status;                //A PoseSolver::Result
+  int32_t pose_residual;              //RMS image error as a Q16.16 tangent
+  Pose pose;
+};
+
+// Publishes TrackerSnapshots from the output loop to any number of readers, on either
+// core, without the writer ever waiting for them.
+//
+// Each snapshot is written into the next of SLOTS slots, under that slot's sequence
+// count, which is odd while the write is in progress. A reader copies the latest slot
+// and checks its count is even and unchanged afterwards, otherwise it copies again. As
+// the writer moves to a fresh slot for every snapshot, a copy can only be torn (and
+// retried) if the writer laps the other SLOTS - 1 slots while it is in progress, so even
+// a reader interrupted for a few snapshots gets through first time. There must only be
+// one writer. It has no dependency on the Pico SDK
+class TrackerState {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint32_t SLOTS = 4;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  struct Slot {
+    std::atomic<uint32_t> sequence{0};
+    TrackerSnapshot snapshot;
+  };
+
+  Slot slots[SLOTS];
+  std::atomic<uint32_t> published{0};     //Only stored by the writer
+  std::atomic<uint32_t> latest_us{0};     //The latest snapshot's timestamp, for checking before copying it
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Writer side. Sets the snapshot's sequence as it is published
+  void publish(const TrackerSnapshot& snapshot);
+
+  //Reader side. Copies out the latest snapshot, returning false if there has not been one.
+  //If retries is given, the number of torn copies is added to it
+  bool read(TrackerSnapshot& out, uint32_t* retries = nullptr) const;
+
+  uint32_t publish_count() const { return published.load(std::memory_order_acquire); }
+  uint32_t latest_timestamp_us() const { return latest_us.load(std::memory_order_relaxed); }
+};
+
+// One reader's subscription to a TrackerState, taking at most one snapshot per
+// interval_us (by their timestamps) so a slow consumer, such as the LED, decimates the
+// stream rather than falling behind it. Snapshots published in between are skipped,
+// without being copied
+class StateSubscriber {
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  const TrackerState& state;
+  const uint32_t interval_us;
+
+  uint32_t last_sequence = 0;
+  uint32_t last_us = 0;
+  uint32_t skipped = 0;
+  uint32_t retries = 0;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  //An interval of 0 takes every snapshot still the latest when polled
+  StateSubscriber(const TrackerState& state, uint32_t interval_us = 0);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Copies out the latest snapshot, if there is one newer than the last taken and its interval has passed
+  bool poll(TrackerSnapshot& out);
+
+  uint32_t skipped_count() const { return skipped; }    //Published but never taken
+  uint32_t retry_count() const { return retries; }      //Torn copies taken again
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+// Set to 0 from the build to compile out the hot-path statistics. Everything that records
+// them checks TrackerStats::ENABLED, so a disabled build keeps no more than the counters
+#ifndef TT_STATS_ENABLED
+#define TT_STATS_ENABLED 1
+#endif
+
+// A histogram of cycle counts in power-of-two buckets, for seeing how close a stage comes
+// to its budget rather than just its average. Bucket 0 holds everything under
+// 2^(MIN_BITS + 1) cycles, bucket b holds [2^(b + MIN_BITS), 2^(b + MIN_BITS + 1)),
+// and the last bucket everything above.
+//
+// Written by one context only (an interrupt or one loop), read as a snapshot elsewhere
+class CycleHistogram {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint8_t NUM_BUCKETS  = 12;
+  static const uint8_t MIN_BITS     = 4;    //So the buckets split at 32, 64, ... 32768 cycles
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  volatile uint32_t buckets[NUM_BUCKETS] = {};
+  volatile uint32_t total = 0;
+  volatile uint32_t max_cycles = 0;
+  volatile uint32_t samples = 0;
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  inline void record(uint32_t cycles) {
+    uint8_t bits = (cycles == 0) ? 0 : 32 - __builtin_clz(cycles);
+    uint8_t b = (bits > MIN_BITS + 1) ? bits - (MIN_BITS + 1) : 0;
+    if(b >= NUM_BUCKETS)
+      b = NUM_BUCKETS - 1;
+    buckets[b] = buckets[b] + 1;
+    total = total + cycles;
+    if(cycles > max_cycles)
+      max_cycles = cycles;
+    samples = samples + 1;
+  }
+
+  void reset() {
+    for(uint8_t b = 0; b < NUM_BUCKETS; b++)
+      buckets[b] = 0;
+    total = 0;
+    max_cycles = 0;
+    samples = 0;
+  }
+
+  uint32_t bucket(uint8_t b) const { return buckets[b]; }
+  uint32_t count() const { return samples; }
+  uint32_t cycles() const { return total; }
+  uint32_t max() const { return max_cycles; }
+  uint32_t mean() const { return samples > 0 ? total / samples : 0; }
+
+  //The lowest cycle count of a bucket
+  static constexpr uint32_t bucket_floor(uint8_t b) { return b == 0 ? 0 : 1u << (b + MIN_BITS); }
+};
+
+// Counts of how the decoder classified the words it was given
+struct DecodeCounts {
+  uint32_t syncs    = 0;    //Syncs opening a counting window, from station 0
+  uint32_t csyncs   = 0;    //Long pulses later in a window, from station 1
+  uint32_t sweeps   = 0;
+  uint32_t rejected = 0;    //Empty words, and sweeps no sync claimed
+  uint32_t replaced = 0;    //Sweeps used, then replaced by a longer one in the same window
+};
+
+class TrackerStats {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static constexpr bool ENABLED = TT_STATS_ENABLED;
+};
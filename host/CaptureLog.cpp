@@ -0,0 +1,139 @@
+#include "CaptureLog.hpp"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+CaptureLogWriter::~CaptureLogWriter() {
+  close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+CaptureLog::~CaptureLog() {
+  close();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CaptureLogWriter::open(const std::string& path, uint8_t sensor_count, uint32_t sys_clock_hz, uint16_t freq_divider,
+                            uint32_t high_resolution) {
+  close();
+  file = fopen(path.c_str(), "wb");
+  if(file == nullptr)
+    return false;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "TTCL", 4);
+  header.version = CaptureHeader::VERSION;
+  header.header_size = sizeof(CaptureHeader);
+  header.sys_clock_hz = sys_clock_hz;
+  header.freq_divider = freq_divider;
+  header.sensor_count = sensor_count;
+  header.high_resolution = high_resolution;
+  return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CaptureLogWriter::append(const CaptureRecord* records, uint32_t count) {
+  if(file == nullptr || fwrite(records, sizeof(CaptureRecord), count, file) != count)
+    return false;
+  header.record_count += count;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CaptureLogWriter::append_word(uint8_t sensor, uint32_t time_us, uint32_t word, bool window_age) {
+  CaptureRecord record = { word, CaptureRecord::make_tag(sensor, time_us, window_age) };
+  return append(&record, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CaptureLogWriter::append_gap(uint32_t lost_words) {
+  CaptureRecord record = { 0, lost_words };
+  return append(&record, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CaptureLogWriter::close() {
+  if(file == nullptr)
+    return true;
+
+  //Go back and fill in how many records were written
+  bool ok = fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+  ok &= (fclose(file) == 0);
+  file = nullptr;
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CaptureLog::open(const std::string& path) {
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0) {
+    error_message = "cannot open " + path;
+    return false;
+  }
+
+  struct stat info;
+  if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(CaptureHeader)) {
+    ::close(fd);
+    error_message = path + " is too short to be a capture log";
+    return false;
+  }
+
+  mapping_size = (size_t)info.st_size;
+  mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(mapping == MAP_FAILED) {
+    mapping = nullptr;
+    error_message = "cannot map " + path;
+    return false;
+  }
+  madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+  header = static_cast<const CaptureHeader*>(mapping);
+  if(memcmp(header->magic, "TTCL", 4) != 0 || header->version == 0 || header->version > CaptureHeader::VERSION
+     || header->header_size < sizeof(CaptureHeader) || header->header_size > mapping_size) {
+    error_message = path + " is not a capture log";
+    close();
+    return false;
+  }
+
+  //Trust the file length over the header, so a log cut short by a crash still reads
+  records_start = reinterpret_cast<const CaptureRecord*>(static_cast<const uint8_t*>(mapping) + header->header_size);
+  num_records = (mapping_size - header->header_size) / sizeof(CaptureRecord);
+
+  //Before version 3 the flag's bit was the top of the time, which replay only needs modulo TIME_MASK
+  if(header->version < 3) {
+    converted.assign(records_start, records_start + num_records);
+    for(CaptureRecord& record : converted) {
+      if(!record.is_gap())
+        record.tag &= ~CaptureRecord::WINDOW_FLAG;
+    }
+    records_start = converted.data();
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void CaptureLog::close() {
+  if(mapping != nullptr) {
+    munmap(mapping, mapping_size);
+  }
+  mapping = nullptr;
+  header = nullptr;
+  records_start = nullptr;
+  num_records = 0;
+  converted.clear();
+  converted.shrink_to_fit();
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// A recorded session of raw PIO words from every sensor, laid out so it can be
+// memory-mapped and read in place.
+//
+// The file is a 32 byte header followed by 8 byte records, all little-endian:
+//   char magic[4] "TTCL", uint16 version, uint16 header size,
+//   uint32 system clock Hz, uint16 PIO clock divider, uint8 sensor count, uint8 reserved,
+//   uint64 record count, uint32 high resolution mask, uint32 reserved
+//
+// The mask has bit n set if sensor n's words are in the high resolution format (see
+// EdgeTimer). It was added in version 2, and version 1 logs, where it was reserved and
+// zero, are still read as all standard resolution. The window flag was added in version 3,
+// taking the top bit of the earlier 27 bit times, so older logs have it cleared as they
+// are opened.
+//
+// Each record holds the raw word and a tag packing the sensor (top 5 bits), a window flag
+// (bit 26) and the microsecond it was drained (low 26 bits, wrapping every ~67s). With the
+// flag set, the word opened a counting window, so has a start of 0, and its top 16 bits
+// hold how many microseconds before the drain the window opened, as the firmware latched
+// it. A record with a word of 0, which the PIO program never produces, marks a gap: its
+// tag holds how many words were lost there, or 0 if whole frames were lost on the link.
+struct CaptureRecord {
+  static const uint32_t TIME_BITS = 26;
+  static const uint32_t TIME_MASK = (1u << TIME_BITS) - 1;
+  static const uint32_t WINDOW_FLAG = 1u << TIME_BITS;
+  static const uint32_t SENSOR_SHIFT = TIME_BITS + 1;
+
+  uint32_t word;
+  uint32_t tag;
+
+  bool is_gap() const { return word == 0; }
+  uint8_t sensor() const { return tag >> SENSOR_SHIFT; }
+  uint32_t time_us() const { return tag & TIME_MASK; }
+  uint32_t lost_words() const { return tag; }
+
+  bool has_window_age() const { return tag & WINDOW_FLAG; }
+  uint32_t window_age_us() const { return word >> 16; }
+  uint32_t pulse_word() const { return has_window_age() ? (word & 0xffff) : word; }
+
+  static uint32_t make_tag(uint8_t sensor, uint32_t time_us, bool window_age = false) {
+    return ((uint32_t)sensor << SENSOR_SHIFT) | (window_age ? WINDOW_FLAG : 0) | (time_us & TIME_MASK);
+  }
+};
+static_assert(sizeof(CaptureRecord) == 8, "Records must pack to 8 bytes");
+
+struct CaptureHeader {
+  static const uint16_t VERSION = 3;
+
+  char magic[4];
+  uint16_t version;
+  uint16_t header_size;
+  uint32_t sys_clock_hz;
+  uint16_t freq_divider;
+  uint8_t sensor_count;
+  uint8_t reserved0;
+  uint64_t record_count;
+  uint32_t high_resolution;
+  uint32_t reserved1;
+};
+static_assert(sizeof(CaptureHeader) == 32, "Header must pack to 32 bytes");
+
+// Appends records to a new capture log, filling in the record count when closed
+class CaptureLogWriter {
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  FILE* file = nullptr;
+  CaptureHeader header;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  CaptureLogWriter() {}
+  ~CaptureLogWriter();
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  bool open(const std::string& path, uint8_t sensor_count, uint32_t sys_clock_hz, uint16_t freq_divider, uint32_t high_resolution = 0);
+  bool append(const CaptureRecord* records, uint32_t count);
+  //With window_age, the word opened a window and carries its age, see FrameCodec::capture_window_word
+  bool append_word(uint8_t sensor, uint32_t time_us, uint32_t word, bool window_age = false);
+  bool append_gap(uint32_t lost_words);
+  bool close();
+
+  uint64_t record_count() const { return header.record_count; }
+};
+
+// A read-only, memory-mapped capture log
+class CaptureLog {
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  void* mapping = nullptr;
+  size_t mapping_size = 0;
+  const CaptureHeader* header = nullptr;
+  const CaptureRecord* records_start = nullptr;
+  uint64_t num_records = 0;
+  std::vector<CaptureRecord> converted;   //The records of a log older than version 3, with their window flags cleared
+  std::string error_message;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  CaptureLog() {}
+  ~CaptureLog();
+  CaptureLog(const CaptureLog&) = delete;
+  CaptureLog& operator=(const CaptureLog&) = delete;
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Maps the file. Returns false, with error() set, if it is missing or malformed
+  bool open(const std::string& path);
+  void close();
+
+  const CaptureRecord* records() const { return records_start; }
+  uint64_t count() const { return num_records; }
+  uint8_t sensor_count() const { return header->sensor_count; }
+  uint32_t sys_clock_hz() const { return header->sys_clock_hz; }
+  uint16_t freq_divider() const { return header->freq_divider; }
+  uint32_t high_resolution() const { return header->high_resolution; }
+  const std::string& error() const { return error_message; }
+};
@@ -0,0 +1,145 @@
+#include "CaptureReplay.hpp"
+#include "PulseSource.hpp"
+#include <chrono>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+CaptureReplay::CaptureReplay(uint8_t num_sensors) :
+  num_sensors(num_sensors < PulseDecoder::MAX_SENSORS ? num_sensors : PulseDecoder::MAX_SENSORS), decoder(this->num_sensors) {
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void CaptureReplay::set_geometry_um(const int32_t (*positions)[3], uint8_t count) {
+  for(uint8_t st = 0; st < PulseDecoder::NUM_STATIONS; st++) {
+    pose_solvers[st].set_geometry_um(positions, count);
+  }
+  pose_enabled = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void CaptureReplay::set_high_resolution(uint32_t mask) {
+  high_resolution = mask;
+  for(uint8_t s = 0; s < num_sensors; s++) {
+    decoder.set_high_resolution(s, (mask >> s) & 1);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ReplayStats CaptureReplay::run(const CaptureRecord* records, uint64_t count, SampleFunc on_sample, void* context) {
+  ReplayStats stats;
+  auto start = std::chrono::steady_clock::now();
+
+  uint32_t words[PulseDecoder::DRAIN_BATCH];
+  uint32_t window_starts[PulseDecoder::DRAIN_BATCH];
+  SweepEvent events[PulseDecoder::DRAIN_BATCH];
+  uint64_t time_us = 0;
+  uint32_t last_tag_time = 0;
+  bool have_time = false;
+
+  uint64_t i = 0;
+  while(i < count) {
+    const CaptureRecord& record = records[i];
+    if(record.is_gap()) {
+      stats.gaps++;
+      stats.lost_words += record.lost_words();
+      i++;
+      continue;
+    }
+
+    //Unwrap the 27 bit drain time, holding it rather than wrapping if a record is out of order
+    uint32_t tag_time = record.time_us();
+    uint32_t delta = (tag_time - last_tag_time) & CaptureRecord::TIME_MASK;
+    if(have_time && delta < (CaptureRecord::TIME_MASK >> 1))
+      time_us += delta;
+    last_tag_time = tag_time;
+    have_time = true;
+
+    //Decode the whole pass (every record sharing this time) in per-sensor batches
+    uint32_t now = (uint32_t)time_us;
+    while(i < count && !records[i].is_gap() && records[i].time_us() == tag_time) {
+      uint8_t sensor = records[i].sensor();
+      bool high = (high_resolution >> sensor) & 1;
+      uint32_t batch = 0;
+      uint32_t windows = 0;
+      while(i < count && batch < PulseDecoder::DRAIN_BATCH && !records[i].is_gap()
+            && records[i].time_us() == tag_time && records[i].sensor() == sensor) {
+        const CaptureRecord& word_record = records[i++];
+        uint32_t word = word_record.pulse_word();
+        if(LighthouseTiming::word_start(word) == 0) {
+          if(word_record.has_window_age()) {
+            window_starts[windows++] = now - word_record.window_age_us();
+            stats.latched_windows++;
+          }
+          else {
+            window_starts[windows++] = PulseSource::window_start(word, now, high);
+            stats.derived_windows++;
+          }
+        }
+        words[batch++] = word;
+      }
+      if(sensor < num_sensors) {
+        uint32_t num_events = decoder.process(sensor, words, batch, events, window_starts);
+        for(uint32_t e = 0; e < num_events; e++) {
+          if(events[e].type == SweepEvent::SWEEP && events[e].axis == 1)
+            sweep_us[events[e].station][events[e].sensor] = events[e].timestamp_us;
+        }
+      }
+      stats.records += batch;
+    }
+
+    sample(time_us, on_sample, context, stats);
+  }
+
+  stats.span_us = time_us;
+  stats.elapsed_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void CaptureReplay::sample(uint64_t time_us, SampleFunc on_sample, void* context, ReplayStats& stats) {
+  int32_t x_angles[PulseDecoder::MAX_SENSORS];
+  int32_t y_angles[PulseDecoder::MAX_SENSORS];
+
+  for(uint8_t st = 0; st < PulseDecoder::NUM_STATIONS; st++) {
+    if(!decoder.has_new_data(st))
+      continue;
+
+    uint32_t valid_mask = decoder.new_data_mask(st);
+    for(uint8_t s = 0; s < num_sensors; s++) {
+      x_angles[s] = decoder.x_angle(s, st);
+      y_angles[s] = decoder.y_angle(s, st);
+      if(calibration_enabled)
+        decoder.correct(st, x_angles[s], y_angles[s]);
+    }
+    decoder.clear_new_data(st);
+
+    PoseSolver::Result pose_result = PoseSolver::SOLVE_TOO_FEW_SENSORS;
+    if(pose_enabled) {
+      pose_result = pose_solvers[st].solve(x_angles, y_angles, valid_mask);
+      if(pose_result == PoseSolver::SOLVE_OK)
+        stats.poses_solved++;
+    }
+    stats.samples++;
+
+    if(on_sample != nullptr) {
+      ReplaySample sample;
+      sample.time_us = time_us;
+      sample.station = st;
+      sample.sensor_count = num_sensors;
+      sample.valid_mask = valid_mask;
+      sample.x_angles = x_angles;
+      sample.y_angles = y_angles;
+      sample.sweep_us = sweep_us[st];
+      sample.pose = pose_enabled ? &pose_solvers[st].pose() : nullptr;
+      sample.pose_result = pose_result;
+      on_sample(sample, context);
+    }
+  }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
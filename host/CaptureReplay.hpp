@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include "CaptureLog.hpp"
+#include "PulseDecoder.hpp"
+#include "PoseSolver.hpp"
+
+// One output of the replayed pipeline, equivalent to a line of the firmware's output
+struct ReplaySample {
+  uint64_t time_us;           //Unwrapped from the log's 27 bit timestamps
+  uint8_t station;
+  uint8_t sensor_count;
+  uint32_t valid_mask;
+  const int32_t* x_angles;    //Q16.16 degrees
+  const int32_t* y_angles;
+  const uint32_t* sweep_us;   //When each sensor's last Y sweep crossed it, from its window's start time
+  const Pose* pose;           //nullptr unless pose solving is enabled
+  PoseSolver::Result pose_result;
+};
+
+struct ReplayStats {
+  uint64_t records = 0;
+  uint64_t gaps = 0;
+  uint64_t lost_words = 0;
+  uint64_t latched_windows = 0;   //Windows timed from the start time the firmware latched
+  uint64_t derived_windows = 0;   //Windows timed from the drain time, from logs without latched times
+  uint64_t samples = 0;
+  uint64_t poses_solved = 0;
+  uint64_t span_us = 0;       //Time covered by the log
+  uint64_t elapsed_ns = 0;    //Wall time the replay took
+};
+
+// Feeds a capture log through the same decoder, calibration and pose code as the
+// firmware's single core loop. Records drained in the same pass share a timestamp, so
+// each pass is decoded in per-sensor batches and then sampled, just as the firmware
+// does after each pass over its sensors.
+//
+// Each batch is decoded with its windows' start times, so sync tracking and sweep
+// timestamps work as they do live. They come from the times latched into the log, or
+// for logs without them, from the drain time less the sync's length, as the firmware
+// does for a window it has no latched time for.
+class CaptureReplay {
+  //--------------------------------------------------
+  // Types
+  //--------------------------------------------------
+public:
+  typedef void (*SampleFunc)(const ReplaySample& sample, void* context);
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  const uint8_t num_sensors;
+  PulseDecoder decoder;
+  PoseSolver pose_solvers[PulseDecoder::NUM_STATIONS];
+  bool pose_enabled = false;
+  bool calibration_enabled = false;
+  uint32_t high_resolution = 0;
+  uint32_t sweep_us[PulseDecoder::NUM_STATIONS][PulseDecoder::MAX_SENSORS] = {};
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  CaptureReplay(uint8_t num_sensors);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Enables pose solving, with sensor positions in micrometres as in the firmware
+  void set_geometry_um(const int32_t (*positions)[3], uint8_t count);
+  void set_calibration(bool enabled) { calibration_enabled = enabled; }
+  void set_sync_tracking(bool enabled) { decoder.set_sync_tracking(enabled); }
+
+  //Sets which sensors' words are in the high resolution format, as CaptureLog::high_resolution()
+  void set_high_resolution(uint32_t mask);
+
+  //Replays the records, calling on_sample (if given) for each output
+  ReplayStats run(const CaptureRecord* records, uint64_t count, SampleFunc on_sample = nullptr, void* context = nullptr);
+
+  const PulseDecoder& pulse_decoder() const { return decoder; }
+private:
+  void sample(uint64_t time_us, SampleFunc on_sample, void* context, ReplayStats& stats);
+};
@@ -0,0 +1,518 @@
+#include "PioAssembler.hpp"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <ctype.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// STATICS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+  std::string trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t\r\n");
+    if(start == std::string::npos)
+      return "";
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(start, end - start + 1);
+  }
+
+  std::string strip_comment(const std::string& line) {
+    size_t semi = line.find(';');
+    size_t slashes = line.find("//");
+    size_t cut = semi < slashes ? semi : slashes;
+    return cut == std::string::npos ? line : line.substr(0, cut);
+  }
+
+  //Splits on commas and whitespace, keeping "x!=y" and "x--" style tokens intact
+  std::vector<std::string> split_args(const std::string& text) {
+    std::vector<std::string> args;
+    std::string current;
+    for(char c : text) {
+      if(c == ',' || isspace((unsigned char)c)) {
+        if(!current.empty()) {
+          args.push_back(current);
+          current.clear();
+        }
+      }
+      else {
+        current += c;
+      }
+    }
+    if(!current.empty())
+      args.push_back(current);
+    return args;
+  }
+
+  std::string lower(std::string text) {
+    for(char& c : text) c = (char)tolower((unsigned char)c);
+    return text;
+  }
+
+  int find_name(const char* const* names, uint8_t count, const std::string& name) {
+    for(uint8_t i = 0; i < count; i++) {
+      if(names[i] != nullptr && name == names[i])
+        return i;
+    }
+    return -1;
+  }
+
+  //Recursive descent over + - * / ( ) and unary -, with names looked up by the caller
+  class Expression {
+  public:
+    Expression(const std::string& text, const std::map<std::string, int32_t>& defines, const std::map<std::string, uint8_t>& labels) :
+      text(text), defines(defines), labels(labels) {}
+
+    bool parse(int32_t& value) {
+      if(!sum(value))
+        return false;
+      skip();
+      return position == text.size();
+    }
+
+  private:
+    const std::string& text;
+    const std::map<std::string, int32_t>& defines;
+    const std::map<std::string, uint8_t>& labels;
+    size_t position = 0;
+
+    void skip() { while(position < text.size() && isspace((unsigned char)text[position])) position++; }
+
+    bool sum(int32_t& value) {
+      if(!product(value))
+        return false;
+      while(true) {
+        skip();
+        if(position >= text.size() || (text[position] != '+' && text[position] != '-'))
+          return true;
+        char op = text[position++];
+        int32_t rhs;
+        if(!product(rhs))
+          return false;
+        value = (op == '+') ? value + rhs : value - rhs;
+      }
+    }
+
+    bool product(int32_t& value) {
+      if(!unary(value))
+        return false;
+      while(true) {
+        skip();
+        if(position >= text.size() || (text[position] != '*' && text[position] != '/'))
+          return true;
+        char op = text[position++];
+        int32_t rhs;
+        if(!unary(rhs) || (op == '/' && rhs == 0))
+          return false;
+        value = (op == '*') ? value * rhs : value / rhs;
+      }
+    }
+
+    bool unary(int32_t& value) {
+      skip();
+      if(position < text.size() && text[position] == '-') {
+        position++;
+        if(!unary(value))
+          return false;
+        value = -value;
+        return true;
+      }
+      if(position < text.size() && text[position] == '(') {
+        position++;
+        if(!sum(value))
+          return false;
+        skip();
+        if(position >= text.size() || text[position] != ')')
+          return false;
+        position++;
+        return true;
+      }
+
+      size_t start = position;
+      while(position < text.size() && (isalnum((unsigned char)text[position]) || text[position] == '_'))
+        position++;
+      if(start == position)
+        return false;
+
+      std::string token = text.substr(start, position - start);
+      if(isdigit((unsigned char)token[0])) {
+        char* end;
+        if(token.size() > 2 && token[0] == '0' && (token[1] == 'b' || token[1] == 'B'))
+          value = (int32_t)strtol(token.c_str() + 2, &end, 2);
+        else
+          value = (int32_t)strtol(token.c_str(), &end, 0);
+        return *end == '\0';
+      }
+
+      auto define = defines.find(token);
+      if(define != defines.end()) {
+        value = define->second;
+        return true;
+      }
+      auto label = labels.find(token);
+      if(label != labels.end()) {
+        value = label->second;
+        return true;
+      }
+      return false;
+    }
+  };
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PioAssembler::assemble_file(const std::string& path, const std::string& name, PioProgram& program) {
+  std::ifstream file(path);
+  if(!file) {
+    line_number = 0;
+    return fail("cannot open " + path);
+  }
+  std::stringstream source;
+  source << file.rdbuf();
+  return assemble(source.str(), name, program);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PioAssembler::assemble(const std::string& source, const std::string& name, PioProgram& program) {
+  program = PioProgram();
+  program.name = name;
+  error_message.clear();
+
+  //First pass finds the program's labels and instructions, and any defines before or in it
+  std::vector<std::pair<int, std::string>> lines;
+  bool in_program = false;
+  bool found = false;
+  bool in_code_block = false;
+  bool have_wrap = false;
+  bool have_wrap_target = false;
+
+  std::istringstream stream(source);
+  std::string raw;
+  line_number = 0;
+  while(std::getline(stream, raw)) {
+    line_number++;
+
+    if(in_code_block) {
+      if(trim(raw).rfind("%}", 0) == 0)
+        in_code_block = false;
+      continue;
+    }
+    if(trim(raw).rfind("%", 0) == 0) {
+      in_code_block = (raw.find('{') != std::string::npos);
+      continue;
+    }
+
+    std::string line = trim(strip_comment(raw));
+    if(line.empty())
+      continue;
+
+    if(line[0] == '.') {
+      std::vector<std::string> args = split_args(line);
+      const std::string& directive = args[0];
+
+      if(directive == ".program") {
+        in_program = (args.size() > 1 && args[1] == name);
+        found |= in_program;
+      }
+      else if(directive == ".define") {
+        size_t first = 1;
+        if(args.size() > 1 && args[1] == "public")
+          first = 2;
+        if(args.size() < first + 2)
+          return fail("bad .define");
+
+        //Re-join the value so expressions containing spaces survive the split
+        size_t name_pos = line.find(args[first], line.find(".define") + 7);
+        std::string expression = trim(line.substr(name_pos + args[first].size()));
+        int32_t value;
+        if(!evaluate(expression, program, value))
+          return fail("bad .define value: " + expression);
+        defines[args[first]] = value;
+      }
+      else if(!in_program) {
+        continue;
+      }
+      else if(directive == ".side_set") {
+        int32_t count;
+        if(args.size() < 2 || !evaluate(args[1], program, count) || count < 0 || count > 5)
+          return fail("bad .side_set");
+        for(size_t i = 2; i < args.size(); i++) {
+          if(args[i] == "opt") program.sideset_optional = true;
+          else if(args[i] == "pindirs") program.sideset_pindirs = true;
+          else return fail("unknown .side_set option " + args[i]);
+        }
+        program.sideset_count = (uint8_t)(count + (program.sideset_optional ? 1 : 0));
+        if(program.sideset_count > 5)
+          return fail("too many side-set bits");
+      }
+      else if(directive == ".wrap_target") {
+        program.wrap_target = (uint8_t)lines.size();
+        have_wrap_target = true;
+      }
+      else if(directive == ".wrap") {
+        if(lines.empty())
+          return fail(".wrap before any instruction");
+        program.wrap = (uint8_t)(lines.size() - 1);
+        have_wrap = true;
+      }
+      else if(directive == ".origin") {
+        int32_t origin;
+        if(args.size() < 2 || !evaluate(args[1], program, origin))
+          return fail("bad .origin");
+        program.origin = (int8_t)origin;
+      }
+      else if(directive == ".word") {
+        lines.push_back(std::make_pair(line_number, line));
+      }
+      else if(directive == ".lang_opt" || directive == ".pio_version" || directive == ".clock_div" ||
+              directive == ".fifo" || directive == ".mov_status" || directive == ".in" || directive == ".out" || directive == ".set") {
+        continue;   //Configuration hints, which the caller sets up itself
+      }
+      else {
+        return fail("unknown directive " + directive);
+      }
+      continue;
+    }
+
+    if(!in_program)
+      continue;
+
+    //Labels, optionally public, may share a line with an instruction
+    size_t colon = line.find(':');
+    if(colon != std::string::npos && line.compare(colon, 2, "::") != 0) {
+      std::string label = trim(line.substr(0, colon));
+      if(label.rfind("public ", 0) == 0)
+        label = trim(label.substr(7));
+      program.labels[label] = (uint8_t)lines.size();
+      line = trim(line.substr(colon + 1));
+      if(line.empty())
+        continue;
+    }
+
+    if(lines.size() >= PioProgram::MAX_INSTRUCTIONS)
+      return fail("program is longer than 32 instructions");
+    lines.push_back(std::make_pair(line_number, line));
+  }
+
+  if(!found) {
+    line_number = 0;
+    return fail("no program named " + name);
+  }
+  if(!have_wrap)
+    program.wrap = (uint8_t)(lines.size() - 1);
+  if(!have_wrap_target)
+    program.wrap_target = 0;
+
+  //Second pass encodes, now every label is known
+  for(size_t i = 0; i < lines.size(); i++) {
+    line_number = lines[i].first;
+    const std::string& text = lines[i].second;
+
+    if(text.rfind(".word", 0) == 0) {
+      int32_t value;
+      if(!evaluate(trim(text.substr(5)), program, value))
+        return fail("bad .word");
+      program.instructions[i] = (uint16_t)value;
+    }
+    else if(!encode(text, program, program.instructions[i])) {
+      return false;
+    }
+  }
+  program.length = (uint8_t)lines.size();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PioAssembler::fail(const std::string& message) {
+  error_message = (line_number > 0) ? ("line " + std::to_string(line_number) + ": " + message) : message;
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PioAssembler::evaluate(const std::string& expression, const PioProgram& program, int32_t& value) {
+  Expression parser(expression, defines, program.labels);
+  return parser.parse(value);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PioAssembler::encode(const std::string& line, const PioProgram& program, uint16_t& instruction) {
+  static const char* const JMP_CONDITIONS[] = { "", "!x", "x--", "!y", "y--", "x!=y", "pin", "!osre" };
+  static const char* const IN_SOURCES[] = { "pins", "x", "y", "null", nullptr, nullptr, "isr", "osr" };
+  static const char* const OUT_DESTS[] = { "pins", "x", "y", "null", "pindirs", "pc", "isr", "exec" };
+  static const char* const MOV_DESTS[] = { "pins", "x", "y", nullptr, "exec", "pc", "isr", "osr" };
+  static const char* const MOV_SOURCES[] = { "pins", "x", "y", "null", nullptr, "status", "isr", "osr" };
+  static const char* const SET_DESTS[] = { "pins", "x", "y", nullptr, "pindirs" };
+  static const char* const WAIT_SOURCES[] = { "gpio", "pin", "irq" };
+
+  std::string text = line;
+
+  //Pull off the delay and side-set, which follow the operands in either order
+  int32_t delay = 0;
+  size_t bracket = text.rfind('[');
+  if(bracket != std::string::npos) {
+    size_t close = text.find(']', bracket);
+    if(close == std::string::npos || !evaluate(text.substr(bracket + 1, close - bracket - 1), program, delay))
+      return fail("bad delay in: " + line);
+    text = text.substr(0, bracket) + text.substr(close + 1);
+  }
+
+  int32_t side = -1;
+  std::vector<std::string> words = split_args(text);
+  for(size_t i = 0; i < words.size(); i++) {
+    if(words[i] == "side" || words[i] == "sideset") {
+      if(i + 1 >= words.size() || !evaluate(words[i + 1], program, side))
+        return fail("bad side-set in: " + line);
+      text = text.substr(0, text.find(words[i]));
+      break;
+    }
+  }
+  if(words.empty())
+    return fail("empty instruction");
+
+  //Operands are comma separated where there are several, or a condition and target for jmp
+  std::string op = lower(words[0]);
+  std::string operands = trim(trim(text).substr(words[0].size()));
+  std::vector<std::string> args;
+  if(operands.find(',') != std::string::npos) {
+    size_t position = 0;
+    while(position <= operands.size()) {
+      size_t comma = operands.find(',', position);
+      if(comma == std::string::npos)
+        comma = operands.size();
+      args.push_back(trim(operands.substr(position, comma - position)));
+      position = comma + 1;
+    }
+  }
+  else if(op == "jmp") {
+    std::vector<std::string> tokens = split_args(operands);
+    if(tokens.size() > 1 && find_name(JMP_CONDITIONS, 8, lower(tokens[0])) > 0) {
+      args.push_back(tokens[0]);
+      args.push_back(trim(operands.substr(tokens[0].size())));
+    }
+    else if(!operands.empty()) {
+      args.push_back(operands);
+    }
+  }
+  else {
+    args = split_args(operands);
+  }
+  uint16_t encoded;
+
+  if(op == "nop") {
+    encoded = 0xa042;   //mov y, y
+  }
+  else if(op == "jmp") {
+    uint8_t condition = 0;
+    if(args.size() == 2) {
+      int found = find_name(JMP_CONDITIONS, 8, lower(args[0]));
+      if(found <= 0)
+        return fail("bad jmp condition " + args[0]);
+      condition = (uint8_t)found;
+      args.erase(args.begin());
+    }
+    int32_t target;
+    if(args.size() != 1 || !evaluate(args[0], program, target) || target < 0 || target > 31)
+      return fail("bad jmp target in: " + line);
+    encoded = (uint16_t)(0x0000 | (condition << 5) | target);
+  }
+  else if(op == "wait") {
+    if(args.size() < 3)
+      return fail("bad wait");
+    int32_t polarity, index;
+    int source = find_name(WAIT_SOURCES, 3, lower(args[1]));
+    if(!evaluate(args[0], program, polarity) || source < 0 || !evaluate(args[2], program, index))
+      return fail("bad wait in: " + line);
+    if(args.size() > 3 && args[3] == "rel")
+      index |= 0x10;
+    encoded = (uint16_t)(0x2000 | ((polarity & 1) << 7) | (source << 5) | (index & 0x1f));
+  }
+  else if(op == "in" || op == "out") {
+    int32_t count;
+    int target = (op == "in") ? find_name(IN_SOURCES, 8, lower(args.size() > 0 ? args[0] : ""))
+                              : find_name(OUT_DESTS, 8, lower(args.size() > 0 ? args[0] : ""));
+    if(args.size() != 2 || target < 0 || !evaluate(args[1], program, count) || count < 1 || count > 32)
+      return fail("bad " + op + " in: " + line);
+    encoded = (uint16_t)((op == "in" ? 0x4000 : 0x6000) | (target << 5) | (count & 0x1f));
+  }
+  else if(op == "push" || op == "pull") {
+    bool block = true;
+    bool conditional = false;
+    for(const std::string& arg : args) {
+      if(arg == "block") block = true;
+      else if(arg == "noblock") block = false;
+      else if((op == "push" && arg == "iffull") || (op == "pull" && arg == "ifempty")) conditional = true;
+      else return fail("bad " + op + " option " + arg);
+    }
+    encoded = (uint16_t)(0x8000 | (op == "pull" ? 0x80 : 0) | (conditional ? 0x40 : 0) | (block ? 0x20 : 0));
+  }
+  else if(op == "mov") {
+    //Rejoin the operands, as the operation can be written as "~y", "~ y" or ":: y"
+    size_t comma = text.find(',');
+    if(comma == std::string::npos)
+      return fail("bad mov in: " + line);
+    std::string dest = lower(trim(text.substr(text.find("mov") + 3, comma - text.find("mov") - 3)));
+    std::string source = lower(trim(text.substr(comma + 1)));
+    uint8_t operation = 0;
+    if(!source.empty() && (source[0] == '~' || source[0] == '!')) {
+      operation = 1;
+      source = trim(source.substr(1));
+    }
+    else if(source.rfind("::", 0) == 0) {
+      operation = 2;
+      source = trim(source.substr(2));
+    }
+    int d = find_name(MOV_DESTS, 8, dest);
+    int s = find_name(MOV_SOURCES, 8, source);
+    if(d < 0 || s < 0)
+      return fail("bad mov in: " + line);
+    encoded = (uint16_t)(0xa000 | (d << 5) | (operation << 3) | s);
+  }
+  else if(op == "irq") {
+    bool clear = false;
+    bool wait = false;
+    size_t i = 0;
+    if(i < args.size() && (args[i] == "set" || args[i] == "nowait")) i++;
+    else if(i < args.size() && args[i] == "wait") { wait = true; i++; }
+    else if(i < args.size() && args[i] == "clear") { clear = true; i++; }
+    int32_t index;
+    if(i >= args.size() || !evaluate(args[i], program, index))
+      return fail("bad irq in: " + line);
+    if(i + 1 < args.size() && args[i + 1] == "rel")
+      index |= 0x10;
+    encoded = (uint16_t)(0xc000 | (clear ? 0x40 : 0) | (wait ? 0x20 : 0) | (index & 0x1f));
+  }
+  else if(op == "set") {
+    int32_t value;
+    int dest = find_name(SET_DESTS, 5, lower(args.size() > 0 ? args[0] : ""));
+    if(args.size() != 2 || dest < 0 || !evaluate(args[1], program, value) || value < 0 || value > 31)
+      return fail("bad set in: " + line);
+    encoded = (uint16_t)(0xe000 | (dest << 5) | value);
+  }
+  else {
+    return fail("unknown instruction " + op);
+  }
+
+  //The delay/side-set field is 5 bits, with side-set taking the top bits
+  uint8_t delay_bits = 5 - program.sideset_count;
+  if(delay < 0 || delay >= (1 << delay_bits))
+    return fail("delay too long in: " + line);
+  uint16_t field = (uint16_t)delay;
+  if(side >= 0) {
+    uint8_t value_bits = program.sideset_count - (program.sideset_optional ? 1 : 0);
+    if(program.sideset_count == 0 || side >= (1 << value_bits))
+      return fail("bad side-set value in: " + line);
+    field |= (uint16_t)(side << delay_bits);
+    if(program.sideset_optional)
+      field |= 0x10;
+  }
+  else if(program.sideset_count > 0 && !program.sideset_optional) {
+    return fail("side-set required in: " + line);
+  }
+
+  instruction = (uint16_t)(encoded | (field << 8));
+  return true;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <map>
+
+// An assembled PIO program, in the same form pioasm would produce
+struct PioProgram {
+  static const uint8_t MAX_INSTRUCTIONS = 32;
+
+  std::string name;
+  uint16_t instructions[MAX_INSTRUCTIONS];
+  uint8_t length = 0;
+  int8_t origin = -1;
+  uint8_t wrap_target = 0;
+  uint8_t wrap = 0;
+
+  uint8_t sideset_count = 0;      //Side-set bits, including the enable bit when optional
+  bool sideset_optional = false;
+  bool sideset_pindirs = false;
+
+  std::map<std::string, uint8_t> labels;
+};
+
+// Assembles a program from a .pio source file, so the host can run exactly what
+// is in the repo without needing pioasm.
+//
+// Covers the full RP2040 instruction set, along with .program, .side_set, .wrap,
+// .wrap_target, .origin, .word and .define, labels and integer expressions. Code
+// blocks such as "% c-sdk { ... %}" are skipped.
+class PioAssembler {
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  std::map<std::string, int32_t> defines;
+  std::string error_message;
+  int line_number = 0;
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Assembles the named program from the file. Returns false, with error() set, on failure
+  bool assemble_file(const std::string& path, const std::string& name, PioProgram& program);
+  bool assemble(const std::string& source, const std::string& name, PioProgram& program);
+
+  //Overrides or adds a define, as if it were at the top of the source
+  void define(const std::string& name, int32_t value) { defines[name] = value; }
+
+  const std::string& error() const { return error_message; }
+private:
+  bool fail(const std::string& message);
+  bool evaluate(const std::string& expression, const PioProgram& program, int32_t& value);
+  bool encode(const std::string& text, const PioProgram& program, uint16_t& instruction);
+};
@@ -0,0 +1,356 @@
+#include "PioStateMachine.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PioStateMachine::PioStateMachine(const PioProgram& program, const PioConfig& config, PinFunc read_pins, void* context, uint8_t offset) :
+  program(program), offset(offset), config(config), read_pins(read_pins), context(context) {
+  for(uint8_t i = 0; i < 32; i++) {
+    memory[i] = 0;
+  }
+
+  //Relocate the program to its offset, as pio_add_program does for jmp targets
+  for(uint8_t i = 0; i < program.length; i++) {
+    uint16_t instruction = program.instructions[i];
+    if((instruction & 0xe000) == 0x0000)
+      instruction = (instruction & ~0x1f) | ((instruction + offset) & 0x1f);
+    memory[(offset + i) & 0x1f] = instruction;
+  }
+  pc = offset;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PioStateMachine::exec(uint16_t instruction) {
+  exec_pending = true;
+  exec_instruction = instruction;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t PioStateMachine::step() {
+  uint64_t executed = cycle;
+
+  //The divider is 16.8 fixed point, so carry the fraction between steps
+  frac_accumulator += config.clkdiv_frac;
+  cycle += (config.clkdiv_int == 0 ? 65536 : config.clkdiv_int) + (frac_accumulator >> 8);
+  frac_accumulator &= 0xff;
+  steps++;
+
+  if(delay > 0) {
+    delay--;
+    return executed;
+  }
+
+  bool from_exec = exec_pending;
+  uint16_t instruction = from_exec ? exec_instruction : memory[pc];
+  exec_pending = false;
+
+  //Side-set happens on the first cycle of the instruction, even if it then stalls
+  uint8_t delay_bits = 5 - program.sideset_count;
+  uint8_t field = (instruction >> 8) & 0x1f;
+  if(program.sideset_count > 0) {
+    uint8_t value_bits = program.sideset_count - (program.sideset_optional ? 1 : 0);
+    bool enabled = !program.sideset_optional || (field & 0x10);
+    if(enabled && value_bits > 0) {
+      uint32_t value = (field >> delay_bits) & ((1u << value_bits) - 1);
+      write_pins(value, config.sideset_base, value_bits, program.sideset_pindirs);
+    }
+  }
+
+  jumped = false;
+  if(!execute(instruction)) {
+    stalls++;
+    if(from_exec) {
+      exec_pending = true;
+      exec_instruction = instruction;
+    }
+    return executed;
+  }
+
+  //Instructions run by exec() do not move the program counter, unless they jump
+  delay = field & ((1u << delay_bits) - 1);
+  if(!from_exec && !jumped) {
+    advance_pc();
+  }
+  return executed;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PioStateMachine::run_until(uint64_t end_cycle) {
+  while(cycle < end_cycle) {
+    step();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PioStateMachine::rx_get(RxWord& word) {
+  if(rx_count == 0)
+    return false;
+  word = rx_fifo[rx_head];
+  rx_head = (rx_head + 1) % (FIFO_DEPTH * 2);
+  rx_count--;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PioStateMachine::tx_put(uint32_t value) {
+  if(tx_count >= tx_capacity())
+    return false;
+  tx_fifo[(tx_head + tx_count) % (FIFO_DEPTH * 2)] = value;
+  tx_count++;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t PioStateMachine::input_pins() {
+  uint32_t pins = read_pins(cycle, context);
+  uint8_t base = config.in_base & 0x1f;
+  return base == 0 ? pins : ((pins >> base) | (pins << (32 - base)));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PioStateMachine::write_pins(uint32_t value, uint8_t base, uint8_t count, bool directions) {
+  for(uint8_t i = 0; i < count && i < 32; i++) {
+    uint32_t mask = 1u << ((base + i) & 0x1f);
+    uint32_t& target = directions ? pindirs : pins_out;
+    if(value & (1u << i))
+      target |= mask;
+    else
+      target &= ~mask;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PioStateMachine::push(bool block) {
+  if(rx_count >= rx_capacity()) {
+    if(block)
+      return false;
+    rx_dropped++;
+  }
+  else {
+    RxWord& word = rx_fifo[(rx_head + rx_count) % (FIFO_DEPTH * 2)];
+    word.value = isr;
+    word.cycle = cycle;
+    rx_count++;
+  }
+  isr = 0;
+  isr_count = 0;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PioStateMachine::pull(bool block) {
+  if(tx_count == 0) {
+    if(block)
+      return false;
+    osr = x;    //A non-blocking pull from an empty FIFO copies X
+  }
+  else {
+    osr = tx_fifo[tx_head];
+    tx_head = (tx_head + 1) % (FIFO_DEPTH * 2);
+    tx_count--;
+  }
+  osr_count = 0;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PioStateMachine::advance_pc() {
+  if(pc == ((offset + program.wrap) & 0x1f))
+    pc = (offset + program.wrap_target) & 0x1f;
+  else
+    pc = (pc + 1) & 0x1f;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PioStateMachine::execute(uint16_t instruction) {
+  uint8_t opcode = instruction >> 13;
+  uint8_t arg1 = (instruction >> 5) & 0x7;
+  uint8_t arg2 = instruction & 0x1f;
+
+  switch(opcode) {
+  case 0: { //JMP
+      bool jump;
+      switch(arg1) {
+      case 0: jump = true; break;
+      case 1: jump = (x == 0); break;
+      case 2: jump = (x != 0); x--; break;
+      case 3: jump = (y == 0); break;
+      case 4: jump = (y != 0); y--; break;
+      case 5: jump = (x != y); break;
+      case 6: jump = (read_pins(cycle, context) >> config.jmp_pin) & 1; break;
+      default: jump = (osr_count < config.pull_threshold); break;
+      }
+      if(jump) {
+        pc = arg2;
+        jumped = true;
+      }
+      return true;
+    }
+
+  case 1: { //WAIT
+      bool polarity = instruction & 0x80;
+      uint8_t source = (instruction >> 5) & 0x3;
+      bool level;
+      if(source == 0) {
+        level = (read_pins(cycle, context) >> arg2) & 1;
+      }
+      else if(source == 1) {
+        level = input_pins() & (1u << arg2);
+      }
+      else {
+        uint8_t flag = arg2 & 0x7;
+        level = irq_flags & (1u << flag);
+        if(level == polarity && polarity)
+          irq_flags &= ~(1u << flag);
+        return level == polarity;
+      }
+      return level == polarity;
+    }
+
+  case 2: { //IN
+      uint8_t count = arg2 == 0 ? 32 : arg2;
+      if(config.autopush && isr_count >= config.push_threshold && rx_count >= rx_capacity())
+        return false;
+
+      uint32_t data;
+      switch(arg1) {
+      case 0: data = input_pins(); break;
+      case 1: data = x; break;
+      case 2: data = y; break;
+      case 6: data = isr; break;
+      case 7: data = osr; break;
+      default: data = 0; break;
+      }
+      uint32_t mask = count == 32 ? 0xffffffff : ((1u << count) - 1);
+      data &= mask;
+      if(config.in_shift_right)
+        isr = count == 32 ? data : ((isr >> count) | (data << (32 - count)));
+      else
+        isr = count == 32 ? data : ((isr << count) | data);
+      isr_count = (isr_count + count > 32) ? 32 : isr_count + count;
+
+      if(config.autopush && isr_count >= config.push_threshold)
+        push(false);
+      return true;
+    }
+
+  case 3: { //OUT
+      uint8_t count = arg2 == 0 ? 32 : arg2;
+      if(config.autopull && osr_count >= config.pull_threshold) {
+        if(!pull(true))
+          return false;
+      }
+
+      uint32_t data;
+      if(config.out_shift_right) {
+        data = count == 32 ? osr : (osr & ((1u << count) - 1));
+        osr = count == 32 ? 0 : (osr >> count);
+      }
+      else {
+        data = count == 32 ? osr : (osr >> (32 - count));
+        osr = count == 32 ? 0 : (osr << count);
+      }
+      osr_count = (osr_count + count > 32) ? 32 : osr_count + count;
+
+      switch(arg1) {
+      case 0: write_pins(data, config.out_base, config.out_count, false); break;
+      case 1: x = data; break;
+      case 2: y = data; break;
+      case 4: write_pins(data, config.out_base, config.out_count, true); break;
+      case 5: pc = data & 0x1f; jumped = true; break;
+      case 6: isr = data; isr_count = count; break;
+      case 7: exec((uint16_t)data); break;
+      default: break;
+      }
+      return true;
+    }
+
+  case 4: { //PUSH/PULL
+      bool is_pull = instruction & 0x80;
+      bool conditional = instruction & 0x40;
+      bool block = instruction & 0x20;
+      if(is_pull) {
+        if(conditional && osr_count < config.pull_threshold)
+          return true;
+        return pull(block);
+      }
+      if(conditional && isr_count < config.push_threshold)
+        return true;
+      return push(block);
+    }
+
+  case 5: { //MOV
+      uint8_t operation = (instruction >> 3) & 0x3;
+      uint32_t data;
+      switch(instruction & 0x7) {
+      case 0: data = input_pins(); break;
+      case 1: data = x; break;
+      case 2: data = y; break;
+      case 6: data = isr; break;
+      case 7: data = osr; break;
+      default: data = 0; break;
+      }
+      if(operation == 1) {
+        data = ~data;
+      }
+      else if(operation == 2) {
+        uint32_t reversed = 0;
+        for(uint8_t i = 0; i < 32; i++) {
+          reversed = (reversed << 1) | ((data >> i) & 1);
+        }
+        data = reversed;
+      }
+
+      switch(arg1) {
+      case 0: write_pins(data, config.out_base, config.out_count, false); break;
+      case 1: x = data; break;
+      case 2: y = data; break;
+      case 4: exec((uint16_t)data); break;
+      case 5: pc = data & 0x1f; jumped = true; break;
+      case 6: isr = data; isr_count = 0; break;
+      case 7: osr = data; osr_count = 0; break;
+      default: break;
+      }
+      return true;
+    }
+
+  case 6: { //IRQ
+      bool clear = instruction & 0x40;
+      bool wait = instruction & 0x20;
+      uint8_t flag = arg2 & 0x7;
+      if(clear) {
+        irq_flags &= ~(1u << flag);
+        return true;
+      }
+      if(!wait) {
+        irq_flags |= 1u << flag;
+        return true;
+      }
+      if(!irq_wait_set) {
+        irq_flags |= 1u << flag;
+        irq_wait_set = true;
+      }
+      if(irq_flags & (1u << flag))
+        return false;
+      irq_wait_set = false;
+      return true;
+    }
+
+  default: { //SET
+      switch(arg1) {
+      case 0: write_pins(arg2, config.set_base, config.set_count, false); break;
+      case 1: x = arg2; break;
+      case 2: y = arg2; break;
+      case 4: write_pins(arg2, config.set_base, config.set_count, true); break;
+      default: break;
+      }
+      return true;
+    }
+  }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
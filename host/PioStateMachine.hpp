@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stdint.h>
+#include "PioAssembler.hpp"
+
+// The parts of pio_sm_config that affect how a program runs
+struct PioConfig {
+  uint16_t clkdiv_int = 1;
+  uint8_t clkdiv_frac = 0;
+
+  uint8_t in_base = 0;
+  uint8_t jmp_pin = 0;
+  uint8_t out_base = 0;
+  uint8_t out_count = 32;
+  uint8_t set_base = 0;
+  uint8_t set_count = 5;
+  uint8_t sideset_base = 0;
+
+  bool in_shift_right = true;
+  bool autopush = false;
+  uint8_t push_threshold = 32;
+  bool out_shift_right = true;
+  bool autopull = false;
+  uint8_t pull_threshold = 32;
+
+  bool join_rx = false;
+  bool join_tx = false;
+};
+
+// A cycle-accurate interpreter for one PIO state machine, for running the firmware's
+// PIO programs on the host against generated pin waveforms.
+//
+// Time is counted in system clock cycles, with the state machine stepping once per
+// clock divider period. Input pins are read through a callback at each step, and every
+// word pushed to the RX FIFO is stamped with the cycle it was pushed on. Instruction
+// delays, side-set, FIFO stalls, autopush/autopull and wrapping follow the RP2040
+// datasheet; IRQ flags are local to this state machine.
+class PioStateMachine {
+  //--------------------------------------------------
+  // Types
+  //--------------------------------------------------
+public:
+  //Returns the level of all 32 GPIOs at the given system clock cycle
+  typedef uint32_t (*PinFunc)(uint64_t cycle, void* context);
+
+  struct RxWord {
+    uint32_t value;
+    uint64_t cycle;
+  };
+
+
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint8_t FIFO_DEPTH = 4;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  uint16_t memory[32];
+  PioProgram program;
+  uint8_t offset;
+  PioConfig config;
+
+  PinFunc read_pins;
+  void* context;
+
+  uint8_t pc;
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t isr = 0;
+  uint32_t osr = 0;
+  uint8_t isr_count = 0;
+  uint8_t osr_count = 32;     //Shifted out bits, so an empty OSR is 32
+  uint8_t irq_flags = 0;
+  bool irq_wait_set = false;
+  uint32_t pins_out = 0;
+  uint32_t pindirs = 0;
+
+  uint8_t delay = 0;
+  bool jumped = false;
+  bool exec_pending = false;
+  uint16_t exec_instruction = 0;
+
+  RxWord rx_fifo[FIFO_DEPTH * 2];
+  uint8_t rx_head = 0;
+  uint8_t rx_count = 0;
+  uint32_t tx_fifo[FIFO_DEPTH * 2];
+  uint8_t tx_head = 0;
+  uint8_t tx_count = 0;
+  uint32_t rx_dropped = 0;
+
+  uint64_t cycle = 0;
+  uint32_t frac_accumulator = 0;
+  uint64_t steps = 0;
+  uint64_t stalls = 0;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  PioStateMachine(const PioProgram& program, const PioConfig& config, PinFunc read_pins, void* context = nullptr, uint8_t offset = 0);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Executes an instruction immediately, like pio_sm_exec
+  void exec(uint16_t instruction);
+
+  //Advances one state machine clock. Returns the system cycle it executed on
+  uint64_t step();
+
+  //Steps until the system clock reaches the given cycle
+  void run_until(uint64_t end_cycle);
+
+  bool rx_get(RxWord& word);
+  bool tx_put(uint32_t value);
+  uint8_t rx_level() const { return rx_count; }
+  uint32_t rx_dropped_count() const { return rx_dropped; }   //Words lost to push noblock when full
+
+  uint64_t current_cycle() const { return cycle; }
+  uint64_t step_count() const { return steps; }
+  uint64_t stall_count() const { return stalls; }
+  uint8_t program_counter() const { return pc - offset; }
+  uint32_t output_pins() const { return pins_out; }
+  uint32_t x_register() const { return x; }
+  uint32_t y_register() const { return y; }
+private:
+  uint8_t rx_capacity() const { return config.join_rx ? FIFO_DEPTH * 2 : (config.join_tx ? 0 : FIFO_DEPTH); }
+  uint8_t tx_capacity() const { return config.join_tx ? FIFO_DEPTH * 2 : (config.join_rx ? 0 : FIFO_DEPTH); }
+  uint32_t input_pins();
+  void write_pins(uint32_t value, uint8_t base, uint8_t count, bool directions);
+  bool push(bool block);
+  bool pull(bool block);
+  bool execute(uint16_t instruction);   //Returns false if it stalled
+  void advance_pc();
+};
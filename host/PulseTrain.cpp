@@ -0,0 +1,47 @@
+#include "PulseTrain.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PulseTrain::PulseTrain(uint32_t sys_clock_hz) :
+  sys_clock_hz(sys_clock_hz) {
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PulseTrain::add_pulse(uint64_t start_cycle, uint64_t length_cycles) {
+  if(length_cycles == 0)
+    return;
+  edges.push_back({ start_cycle, true });
+  edges.push_back({ start_cycle + length_cycles, false });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PulseTrain::add_pulse_ns(uint64_t start_ns, uint64_t length_ns) {
+  uint64_t start = ns_to_cycles(start_ns);
+  add_pulse(start, ns_to_cycles(start_ns + length_ns) - start);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PulseTrain::add_lighthouse_cycle(uint64_t start_ns, uint32_t sweep_offset_ns, bool second_sync) {
+  add_pulse_ns(start_ns, SYNC_NS);
+  if(second_sync) {
+    add_pulse_ns(start_ns + SECOND_SYNC_OFFSET_NS, SECOND_SYNC_NS);
+  }
+  add_pulse_ns(start_ns + sweep_offset_ns, SWEEP_NS);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PulseTrain::level_at(uint64_t cycle) const {
+  //Edges take effect on their cycle, so find the last one at or before it
+  if(cursor > edges.size() || (cursor > 0 && edges[cursor - 1].cycle > cycle))
+    cursor = 0;
+  while(cursor < edges.size() && edges[cursor].cycle <= cycle)
+    cursor++;
+  return cursor > 0 && edges[cursor - 1].level;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
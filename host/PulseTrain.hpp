@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// A single pin's waveform, as a list of edges in system clock cycles, for feeding
+// generated lighthouse signals into a PioStateMachine.
+//
+// The default cycle shape follows simulated_lh.pio: a 65us sync at the start of each
+// 8333us cycle, a 125us sync from the second station 400us later, and a 10us sweep
+// pulse whose position sets the angle.
+class PulseTrain {
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint32_t CYCLE_NS              = 8333000;
+  static const uint32_t SYNC_NS               = 65000;
+  static const uint32_t SECOND_SYNC_OFFSET_NS = 400000;
+  static const uint32_t SECOND_SYNC_NS        = 125000;
+  static const uint32_t SWEEP_NS              = 10000;
+  static const uint32_t SWEEP_OFFSET_NS       = 3995000;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  struct Edge {
+    uint64_t cycle;
+    bool level;
+  };
+
+  const uint32_t sys_clock_hz;
+  std::vector<Edge> edges;
+  mutable size_t cursor = 0;    //Where the last lookup landed, as the simulator reads forwards
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  PulseTrain(uint32_t sys_clock_hz);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  //Adds a high pulse. Pulses must be added in time order and not overlap
+  void add_pulse(uint64_t start_cycle, uint64_t length_cycles);
+  void add_pulse_ns(uint64_t start_ns, uint64_t length_ns);
+
+  //Adds one simulated lighthouse cycle starting at start_ns, with its sweep offset_ns into it
+  void add_lighthouse_cycle(uint64_t start_ns, uint32_t sweep_offset_ns = SWEEP_OFFSET_NS, bool second_sync = true);
+
+  //Records the waveform on one output pin of a state machine, such as one running simulated_lh.pio
+  template<class SM>
+  void record(SM& sm, uint8_t pin, uint64_t end_cycle) {
+    bool level = false;
+    while(sm.current_cycle() < end_cycle) {
+      uint64_t cycle = sm.step();
+      bool now = (sm.output_pins() >> pin) & 1;
+      if(now != level) {
+        edges.push_back({ cycle, now });
+        level = now;
+      }
+    }
+  }
+
+  bool level_at(uint64_t cycle) const;
+  uint64_t ns_to_cycles(uint64_t ns) const { return ns * sys_clock_hz / 1000000000ull; }
+  uint64_t end_cycle() const { return edges.empty() ? 0 : edges.back().cycle; }
+  size_t pulse_count() const { return edges.size() / 2; }
+};
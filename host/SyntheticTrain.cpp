@@ -0,0 +1,130 @@
+#include <math.h>
+#include <algorithm>
+#include "SyntheticTrain.hpp"
+#include "EdgeTimer.hpp"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// STATICS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static uint32_t ns_to_counts(uint64_t ns) {
+  return (uint32_t)(ns * 1000 / LighthouseTiming::PS_PER_COUNT);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static uint32_t sync_ns(uint8_t sync_data) {
+  //The middle of the range of 48MHz ticks that encodes the data
+  return (uint32_t)(((uint64_t)LighthouseTiming::SYNC_BASE_TICKS + LighthouseTiming::SYNC_STEP_TICKS * sync_data
+                     + LighthouseTiming::SYNC_STEP_TICKS / 2) * 1000000000ull / LighthouseTiming::LH_TICK_HZ);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS / DESTRUCTOR
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SyntheticTrain::SyntheticTrain(const Settings& settings) :
+  settings(settings), random_state(settings.seed != 0 ? settings.seed : 1),
+  streams(settings.sensors), sweep_centre_ns(settings.sensors), sweep_angle(settings.sensors) {
+  std::vector<std::vector<Pulse>> pulses(settings.sensors);
+  uint64_t start_ns = 1000000;
+  for(uint32_t c = 0; c < settings.cycles; c++) {
+    uint32_t period = (uint32_t)(CYCLE_NS * (1.0 + settings.drift_ppm * 1e-6 * c / settings.cycles));
+    cycle_start_ns.push_back(start_ns);
+    cycle_period_ns.push_back(period);
+
+    for(uint8_t s = 0; s < settings.sensors; s++) {
+      //One station sweeps, alternating axes, and the other flashes its sync with the skip bit set
+      uint8_t axis = c & 1;
+      uint8_t skip0 = settings.sweeping == 0 ? 0 : 0b100;
+      std::vector<Pulse> cycle;
+      cycle.push_back({ start_ns, sync_ns(skip0 | axis) });
+      cycle.push_back({ start_ns + SECOND_SYNC_NS, sync_ns((skip0 ^ 0b100) | axis) });
+
+      //Each sensor moves slowly along its own path, its angle timed from the sweeping station's sync
+      double angle = 40.0 * sin(2 * M_PI * c / 700.0 + s) + 5.0 * (s % 8);
+      double centre = period / 2.0 + angle * period / 180.0;
+      uint64_t sync_start = start_ns + (settings.sweeping == 0 ? 0 : SECOND_SYNC_NS);
+      uint64_t sweep_start = sync_start + (uint64_t)(centre - SWEEP_NS / 2.0);
+      cycle.push_back({ sweep_start, SWEEP_NS });
+      sweep_centre_ns[s].push_back(sweep_start + SWEEP_NS / 2.0);
+      sweep_angle[s].push_back(angle);
+
+      for(double n = random_unit(); n < settings.noise; n += 1.0)
+        cycle.push_back({ start_ns + 600000 + (uint64_t)(random_unit() * (period - 700000)), NOISE_NS });
+      for(double n = random_unit(); n < settings.flashes; n += 1.0)
+        cycle.push_back({ start_ns + 600000 + (uint64_t)(random_unit() * (period - 700000)), FLASH_NS });
+
+      //Overlapping pulses merge, as they would on the sensor
+      std::sort(cycle.begin(), cycle.end(), [](const Pulse& a, const Pulse& b) { return a.start_ns < b.start_ns; });
+      std::vector<Pulse>& out = pulses[s];
+      for(const Pulse& pulse : cycle) {
+        if(!out.empty() && pulse.start_ns <= out.back().start_ns + out.back().length_ns) {
+          uint64_t end = std::max(out.back().start_ns + out.back().length_ns, pulse.start_ns + pulse.length_ns);
+          out.back().length_ns = (uint32_t)(end - out.back().start_ns);
+        }
+        else {
+          out.push_back(pulse);
+        }
+      }
+    }
+    start_ns += period;
+  }
+
+  for(uint8_t s = 0; s < settings.sensors; s++)
+    time_pulses(pulses[s], streams[s]);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// METHODS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t SyntheticTrain::total_words() const {
+  uint64_t total = 0;
+  for(const Stream& sensor_stream : streams)
+    total += sensor_stream.words.size();
+  return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int32_t SyntheticTrain::cycle_at(uint64_t time_ns) const {
+  return (int32_t)(std::upper_bound(cycle_start_ns.begin(), cycle_start_ns.end(), time_ns) - cycle_start_ns.begin()) - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+double SyntheticTrain::random_unit() {
+  //xorshift32, so every run with the same seed sees the same train
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state / 4294967296.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SyntheticTrain::time_pulses(const std::vector<Pulse>& pulses, Stream& stream) {
+  const uint64_t min_pulse_ns = (uint64_t)EdgeTimer::MIN_PULSE_CYCLES * 1000000000ull / LighthouseTiming::SYS_CLOCK_HZ;
+  const uint64_t window_ns = LighthouseTiming::counts_to_ns(EdgeTimer::WINDOW_COUNTS);
+  bool open = false;
+  uint64_t window_start = 0;
+  for(const Pulse& pulse : pulses) {
+    if(open && pulse.start_ns + pulse.length_ns - window_start >= window_ns)
+      open = false;
+
+    if(!open) {
+      if(pulse.length_ns < min_pulse_ns)
+        continue;
+      open = true;
+      window_start = pulse.start_ns;
+      stream.window_starts.push_back((uint32_t)(window_start / 1000) + (uint32_t)(random_unit() * (settings.jitter_us + 1)));
+      stream.windows_before.push_back((uint32_t)stream.window_starts.size() - 1);
+      stream.words.push_back(ns_to_counts(pulse.length_ns));
+      continue;
+    }
+    uint32_t start = ns_to_counts(pulse.start_ns - window_start);
+    uint32_t end = ns_to_counts(pulse.start_ns + pulse.length_ns - window_start);
+    stream.windows_before.push_back((uint32_t)stream.window_starts.size());
+    stream.words.push_back((start << 16) | end);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "PulseDecoder.hpp"
+
+// The pulse words lighthouse.pio would push for every sensor of a tracker in view of
+// one lighthouse, built directly rather than through the PIO simulator so thousands of
+// cycles take milliseconds, along with the truth they were built from.
+//
+// Each cycle follows PulseTrain's shape: station 0's sync, station 1's sync 400us
+// later with its skip bit set, and a sweep from station 0 on alternating axes. Either
+// station can be the one sweeping, the other setting its skip bit, and the sweep is
+// timed from the sweeping station's own sync. The cycle
+// period can drift over the run, window start times carry the CPU latch's jitter, and
+// stray short pulses and longer flashes (which can open a window of their own) can be
+// added. Counting windows are opened and closed as lighthouse.pio does, and the same
+// seed always gives the same words.
+class SyntheticTrain {
+  //--------------------------------------------------
+  // Types
+  //--------------------------------------------------
+public:
+  struct Settings {
+    uint32_t cycles = 1000;
+    uint8_t sensors = 4;
+    double drift_ppm = 0;       //How far the period drifts from CYCLE_NS by the last cycle
+    uint32_t jitter_us = 3;     //The largest error in each window's start time
+    double noise = 0;           //Short stray pulses per sensor per cycle
+    double flashes = 0;         //Stray pulses per sensor per cycle long enough to open a window
+    uint8_t sweeping = 0;       //The station that sweeps
+    uint32_t seed = 0x2545f491;
+  };
+
+  //One sensor's words, as PulseSource::get_received_batch gives them
+  struct Stream {
+    std::vector<uint32_t> words;
+    std::vector<uint32_t> window_starts;
+    std::vector<uint32_t> windows_before;   //Windows opened before each word, for slicing batches
+  };
+
+
+  //--------------------------------------------------
+  // Constants
+  //--------------------------------------------------
+public:
+  static const uint32_t CYCLE_NS        = 8333000;  //As PulseTrain
+  static const uint32_t SECOND_SYNC_NS  = 400000;
+  static const uint32_t SWEEP_NS        = 10000;
+  static const uint32_t NOISE_NS        = 5000;
+  static const uint32_t FLASH_NS        = 55000;
+
+
+  //--------------------------------------------------
+  // Variables
+  //--------------------------------------------------
+private:
+  struct Pulse {
+    uint64_t start_ns;
+    uint32_t length_ns;
+  };
+
+  const Settings settings;
+  uint32_t random_state;
+
+  std::vector<Stream> streams;
+  std::vector<uint64_t> cycle_start_ns;
+  std::vector<uint32_t> cycle_period_ns;
+  std::vector<std::vector<double>> sweep_centre_ns;   //Per sensor, per cycle
+  std::vector<std::vector<double>> sweep_angle;
+
+
+  //--------------------------------------------------
+  // Constructors/Destructor
+  //--------------------------------------------------
+public:
+  SyntheticTrain(const Settings& settings);
+
+
+  //--------------------------------------------------
+  // Methods
+  //--------------------------------------------------
+public:
+  uint8_t sensor_count() const { return settings.sensors; }
+  uint32_t cycle_count() const { return settings.cycles; }
+  const Stream& stream(uint8_t sensor) const { return streams[sensor]; }
+  uint64_t total_words() const;
+
+  uint64_t cycle_start(uint32_t cycle) const { return cycle_start_ns[cycle]; }
+  uint32_t period_ns(uint32_t cycle) const { return cycle_period_ns[cycle]; }
+
+  //When the sweep's centre crossed a sensor, and its true angle: 0 at the middle of the
+  //cycle and 180 degrees per period
+  double sweep_ns(uint8_t sensor, uint32_t cycle) const { return sweep_centre_ns[sensor][cycle]; }
+  double angle(uint8_t sensor, uint32_t cycle) const { return sweep_angle[sensor][cycle]; }
+
+  //The cycle a time falls in, or -1 if it is before the first
+  int32_t cycle_at(uint64_t time_ns) const;
+
+  //Decodes every stream a batch per sensor in turn, as the firmware drains them, calling
+  //on_batch after each with the events it produced
+  template<class CALLBACK>
+  void decode(PulseDecoder& decoder, CALLBACK on_batch) const {
+    std::vector<uint32_t> cursor(settings.sensors, 0);
+    SweepEvent events[PulseDecoder::DRAIN_BATCH];
+    bool more = true;
+    while(more) {
+      more = false;
+      for(uint8_t s = 0; s < settings.sensors; s++) {
+        const Stream& sensor_stream = streams[s];
+        uint32_t first = cursor[s];
+        uint32_t count = (uint32_t)sensor_stream.words.size() - first;
+        if(count == 0)
+          continue;
+        if(count > PulseDecoder::DRAIN_BATCH)
+          count = PulseDecoder::DRAIN_BATCH;
+        more = true;
+        cursor[s] += count;
+
+        uint32_t num_events = decoder.process(s, &sensor_stream.words[first], count, events,
+                                              sensor_stream.window_starts.data() + sensor_stream.windows_before[first]);
+        on_batch(s, first, count, events, num_events);
+      }
+    }
+  }
+private:
+  double random_unit();
+  void time_pulses(const std::vector<Pulse>& pulses, Stream& stream);
+};
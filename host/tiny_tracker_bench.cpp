@@ -0,0 +1,530 @@
+// Microbenchmarks of the firmware's hardware-independent stages, driven by synthetic
+// lighthouse pulse trains at 1 to 32 sensors, printing one line per benchmark:
+//   benchmark, sensors, ns per op, op, checksum
+//
+// Usage: tiny_tracker_bench [filter] [--sensors n,n,...] [--min-ms n]
+//   filter      only run benchmarks whose name contains it
+//   --sensors   the sensor counts to run at (default 1,2,4,8,16,32)
+//   --min-ms    how long to repeat each benchmark for (default 200)
+//
+// Every input is generated from fixed seeds, so each benchmark does exactly the same work
+// on every run. Each repeats its whole workload until min-ms has passed and reports the
+// fastest repeat, which is far steadier than the mean on a busy machine. The checksum
+// covers the workload's outputs, so a change in results shows up next to a change in speed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "SyntheticTrain.hpp"
+#include "PulseRing.hpp"
+#include "SweepFilter.hpp"
+#include "PoseSolver.hpp"
+#include "FrameCodec.hpp"
+#include "BinaryOutput.hpp"
+
+static const uint32_t TRAIN_CYCLES    = 240;    //Two seconds of lighthouse cycles
+static const uint32_t POSE_STEPS      = 120;
+static const uint32_t OUTPUT_FRAMES   = 1000;
+static const uint32_t FILTER_RATE_US  = 4000;
+static const uint32_t POSE_TRIALS     = 3000;
+static const double POSE_NOISE_DEG    = 0.005;
+
+//The inputs every benchmark at one sensor count shares
+struct Fixture {
+  struct Sweep {
+    uint8_t sensor;
+    uint8_t axis;
+    uint32_t mid2;
+    int32_t angle;
+    uint32_t timestamp_us;
+  };
+
+  uint8_t sensors;
+  SyntheticTrain clean;
+  SyntheticTrain noisy;
+  std::vector<Sweep> sweeps;                    //Every sweep decoded from the clean train
+  std::vector<uint32_t> words;                  //Every sensor's words, one after the other
+  int32_t positions_um[PoseSolver::MAX_SENSORS][3];
+  std::vector<std::vector<int32_t>> pose_x;    //Angles seen from each pose step
+  std::vector<std::vector<int32_t>> pose_y;
+
+  Fixture(uint8_t sensors);
+};
+
+struct Benchmark {
+  const char* name;
+  const char* op;
+  uint8_t min_sensors;
+  uint64_t (*run)(const Fixture& fixture, uint64_t& checksum);   //Returns the number of ops
+  void (*report)(const Fixture& fixture);                        //Prints how well it did, as '#' lines, if set
+};
+
+static SyntheticTrain::Settings train_settings(uint8_t sensors, bool noisy) {
+  SyntheticTrain::Settings settings;
+  settings.cycles = TRAIN_CYCLES;
+  settings.sensors = sensors;
+  settings.drift_ppm = 500;
+  if(noisy) {
+    settings.noise = 1.0;
+    settings.flashes = 0.01;
+  }
+  return settings;
+}
+
+static inline uint64_t mix(uint64_t checksum, uint32_t value) {
+  //FNV-1a over the whole word, which is all a checksum of results needs
+  return (checksum ^ value) * 1099511628211ull;
+}
+
+Fixture::Fixture(uint8_t sensors) :
+  sensors(sensors), clean(train_settings(sensors, false)), noisy(train_settings(sensors, true)) {
+  PulseDecoder decoder(sensors);
+  clean.decode(decoder, [&](uint8_t, uint32_t, uint32_t, const SweepEvent* events, uint32_t num_events) {
+    for(uint32_t e = 0; e < num_events; e++) {
+      if(events[e].type == SweepEvent::SWEEP) {
+        sweeps.push_back({ events[e].sensor, events[e].axis, events[e].mid2, LighthouseTiming::mid2_to_angle(events[e].mid2),
+                           events[e].timestamp_us });
+      }
+    }
+  });
+  for(uint8_t s = 0; s < sensors; s++) {
+    const std::vector<uint32_t>& stream = clean.stream(s).words;
+    words.insert(words.end(), stream.begin(), stream.end());
+  }
+
+  //Sensors on a 30mm ring, alternately raised by 10mm so no four are coplanar
+  for(uint8_t s = 0; s < sensors; s++) {
+    double theta = 2 * M_PI * s / sensors;
+    positions_um[s][0] = (int32_t)(30000 * cos(theta));
+    positions_um[s][1] = (int32_t)(30000 * sin(theta));
+    positions_um[s][2] = (s & 1) * 10000;
+  }
+
+  //The tracker drifting about 2m in front of the lighthouse
+  PoseSolver projector;
+  for(uint32_t step = 0; step < POSE_STEPS; step++) {
+    Pose pose = {};
+    pose.position[0] = (int32_t)(65536 * 0.05 * sin(step / 10.0));
+    pose.position[1] = (int32_t)(65536 * 0.03 * cos(step / 10.0));
+    pose.position[2] = 2 << 16;
+    for(uint8_t i = 0; i < 3; i++)
+      pose.rotation[i][i] = PoseSolver::ONE_Q30;
+
+    std::vector<int32_t> x(sensors), y(sensors);
+    for(uint8_t s = 0; s < sensors; s++) {
+      int32_t point[3];
+      for(uint8_t i = 0; i < 3; i++)
+        point[i] = (int32_t)(((int64_t)positions_um[s][i] << 16) / 1000000);
+      int32_t u = 0, v = 0;
+      projector.project(pose, point, u, v);
+      x[s] = PoseSolver::tangent_to_angle(u);
+      y[s] = PoseSolver::tangent_to_angle(v);
+    }
+    pose_x.push_back(x);
+    pose_y.push_back(y);
+  }
+}
+
+static uint64_t decode_train(const SyntheticTrain& train, uint8_t sensors, bool tracking, bool reflections, uint64_t& checksum) {
+  PulseDecoder decoder(sensors);
+  decoder.set_sync_tracking(tracking);
+  decoder.set_reject_reflections(reflections);
+  train.decode(decoder, [&](uint8_t, uint32_t, uint32_t, const SweepEvent* events, uint32_t num_events) {
+    for(uint32_t e = 0; e < num_events; e++)
+      checksum = mix(checksum, events[e].mid2);
+  });
+  return train.total_words();
+}
+
+//The state main() kept for each sensor before PulseDecoder, indexed by sensor
+struct InlineState {
+  int last_axis[PulseDecoder::MAX_SENSORS] = {};
+  int last_data[PulseDecoder::MAX_SENSORS] = {};
+  int last_skip[PulseDecoder::MAX_SENSORS] = {};
+  float last_x[PulseDecoder::MAX_SENSORS] = {};
+  float last_y[PulseDecoder::MAX_SENSORS] = {};
+  bool new_data[PulseDecoder::MAX_SENSORS] = {};
+};
+
+//The decode main() repeated for each sensor before PulseDecoder, float maths and all, kept as
+//the baseline to compare it with
+static inline void decode_inline_word(InlineState& state, uint8_t s, uint32_t received) {
+  static constexpr float US_TO_LH_TICK = 48.0f;
+  if(received > 0) {
+    uint32_t istart = (received & 0xffff0000) >> 16;
+    float start = (float)((received & 0xffff0000) >> 16) * 15.0f * 0.008f;
+    float end = (float)(received & 0xffff) * 15.0f * 0.008f;
+    float length = end - start;
+    float tick_length = length * US_TO_LH_TICK;
+
+    if(istart == 0) {
+      int sync_data = (int)((tick_length - 2751) / 500.0f);
+      state.last_axis[s] = sync_data & 0b001;
+      state.last_data[s] = (sync_data & 0b010) >> 1;
+      state.last_skip[s] = (sync_data & 0b100) >> 2;
+    }
+    else {
+      if(length > 50.0f) {
+        int sync_data = (int)((tick_length - 2751) / 500.0f);
+        state.last_axis[s] = sync_data & 0b001;
+      }
+      else {
+        if(state.last_axis[s]) {
+          state.last_y[s] = (start + end) / 2.0f;
+          state.new_data[s] = true;
+        }
+        else {
+          state.last_x[s] = (start + end) / 2.0f;
+        }
+      }
+    }
+  }
+}
+
+static uint64_t decode_inline(const Fixture& fixture, uint64_t& checksum) {
+  //A word per sensor in turn, as the old main loop took them
+  InlineState state;
+  std::vector<size_t> cursor(fixture.sensors, 0);
+  bool more = true;
+  while(more) {
+    more = false;
+    for(uint8_t s = 0; s < fixture.sensors; s++) {
+      const std::vector<uint32_t>& words = fixture.clean.stream(s).words;
+      if(cursor[s] == words.size())
+        continue;
+      more = true;
+      decode_inline_word(state, s, words[cursor[s]++]);
+      if(state.new_data[s]) {
+        uint32_t bits;
+        memcpy(&bits, &state.last_y[s], sizeof(bits));
+        checksum = mix(checksum, bits);
+        state.new_data[s] = false;
+      }
+    }
+  }
+  return fixture.clean.total_words();
+}
+
+static uint64_t decode(const Fixture& fixture, uint64_t& checksum) {
+  return decode_train(fixture.clean, fixture.sensors, false, false, checksum);
+}
+
+static uint64_t decode_tracked(const Fixture& fixture, uint64_t& checksum) {
+  return decode_train(fixture.clean, fixture.sensors, true, false, checksum);
+}
+
+static uint64_t decode_noisy(const Fixture& fixture, uint64_t& checksum) {
+  return decode_train(fixture.noisy, fixture.sensors, true, true, checksum);
+}
+
+static uint64_t angles(const Fixture& fixture, uint64_t& checksum) {
+  for(const Fixture::Sweep& sweep : fixture.sweeps)
+    checksum = mix(checksum, (uint32_t)LighthouseTiming::mid2_to_angle(sweep.mid2));
+  return fixture.sweeps.size();
+}
+
+static uint64_t angles_float(const Fixture& fixture, uint64_t& checksum) {
+  //The float conversion main() made before LighthouseTiming, from the same midpoints
+  static constexpr float MID2_TO_US = 15.0f * 0.008f / 2.0f / (1 << LighthouseTiming::MID2_FRACTION_BITS);
+  for(const Fixture::Sweep& sweep : fixture.sweeps) {
+    float angle = (((float)sweep.mid2 * MID2_TO_US - 4000.0f) / 4000.0f) * 90.0f;
+    checksum = mix(checksum, (uint32_t)(int32_t)(angle * 65536.0f));
+  }
+  return fixture.sweeps.size();
+}
+
+static uint64_t ring(const Fixture& fixture, uint64_t& checksum) {
+  //Filled a batch at a time and drained, on one thread, so this is the ring's own bookkeeping
+  PulseRing<uint32_t, 256> words;
+  uint32_t batch[PulseDecoder::DRAIN_BATCH];
+  for(size_t i = 0; i < fixture.words.size(); i++) {
+    words.push(fixture.words[i]);
+    if((i % PulseDecoder::DRAIN_BATCH) == PulseDecoder::DRAIN_BATCH - 1 || i == fixture.words.size() - 1) {
+      uint32_t count = words.pop_batch(batch, PulseDecoder::DRAIN_BATCH);
+      for(uint32_t w = 0; w < count; w++)
+        checksum = mix(checksum, batch[w]);
+    }
+  }
+  return fixture.words.size();
+}
+
+static uint64_t ring_threaded(const Fixture& fixture, uint64_t& checksum) {
+  //Pushed from another thread, waiting whenever the ring is full so nothing is lost, and drained
+  //a batch at a time here. The checksum follows the words' order, so reordering shows up
+  PulseRing<uint32_t, 256> words;
+  std::thread producer([&]() {
+    for(uint32_t word : fixture.words) {
+      while(!words.push(word))
+        std::this_thread::yield();
+    }
+  });
+
+  uint32_t batch[PulseDecoder::DRAIN_BATCH];
+  size_t received = 0;
+  while(received < fixture.words.size()) {
+    uint32_t count = words.pop_batch(batch, PulseDecoder::DRAIN_BATCH);
+    if(count == 0)
+      std::this_thread::yield();
+    for(uint32_t w = 0; w < count; w++)
+      checksum = mix(checksum, batch[w]);
+    received += count;
+  }
+  producer.join();
+  return fixture.words.size();
+}
+
+static uint64_t filter(const Fixture& fixture, uint64_t& checksum) {
+  SweepFilter sweep_filter(fixture.sensors, FILTER_RATE_US);
+  for(const Fixture::Sweep& sweep : fixture.sweeps) {
+    sweep_filter.update(sweep.sensor, sweep.axis, sweep.angle, sweep.timestamp_us);
+    checksum = mix(checksum, (uint32_t)sweep_filter.predict(sweep.sensor, sweep.axis, sweep.timestamp_us + FILTER_RATE_US));
+  }
+  return fixture.sweeps.size();
+}
+
+static uint64_t pose(const Fixture& fixture, uint64_t& checksum) {
+  PoseSolver solver;
+  solver.set_geometry_um(fixture.positions_um, fixture.sensors);
+  uint32_t valid_mask = fixture.sensors < 32 ? (1u << fixture.sensors) - 1 : 0xffffffff;
+  for(uint32_t step = 0; step < POSE_STEPS; step++) {
+    PoseSolver::Result result = solver.solve(fixture.pose_x[step].data(), fixture.pose_y[step].data(), valid_mask);
+    checksum = mix(checksum, result);
+    for(uint8_t i = 0; i < 3; i++)
+      checksum = mix(checksum, (uint32_t)solver.pose().position[i]);
+  }
+  return POSE_STEPS;
+}
+
+//How a run of solves along a known track went
+struct PoseSummary {
+  uint32_t solves = 0;
+  uint32_t converged = 0;
+  uint32_t iterations = 0;
+  uint32_t max_iterations = 0;
+  double error_mm = 0;
+  double max_error_mm = 0;
+
+  void add(const PoseSolver& solver, PoseSolver::Result result, const Pose& truth) {
+    solves++;
+    iterations += solver.iterations();
+    if(solver.iterations() > max_iterations)
+      max_iterations = solver.iterations();
+    if(result != PoseSolver::SOLVE_OK)
+      return;
+
+    converged++;
+    double sum_sq = 0;
+    for(uint8_t i = 0; i < 3; i++) {
+      double error = (solver.pose().position[i] - truth.position[i]) / 65536.0 * 1000.0;
+      sum_sq += error * error;
+    }
+    error_mm += sqrt(sum_sq);
+    if(sqrt(sum_sq) > max_error_mm)
+      max_error_mm = sqrt(sum_sq);
+  }
+
+  double mean_iterations() const { return solves > 0 ? (double)iterations / solves : 0.0; }
+
+  void print(const char* name, uint8_t sensors) const {
+    printf("# pose, %u, %s: %u/%u converged, %.2f iterations mean, %u max, position error %.2fmm mean, %.2fmm max\n",
+           sensors, name, converged, solves, mean_iterations(), max_iterations, converged > 0 ? error_mm / converged : 0.0,
+           max_error_mm);
+  }
+};
+
+//A track from 1 to 3m out and up to 30cm across, turning up to 20 degrees about each axis
+static Pose track_pose(uint32_t trial) {
+  double t = trial;
+  double position[3] = { 0.3 * sin(t / 50), 0.2 * cos(t / 70), 2.0 + sin(t / 90) };
+  double a = 0.35 * sin(t / 60), b = 0.35 * sin(t / 80 + 1), c = 0.35 * sin(t / 110 + 2);
+
+  //R = Rz(c) Ry(b) Rx(a)
+  double r[3][3] = {
+    { cos(c) * cos(b), cos(c) * sin(b) * sin(a) - sin(c) * cos(a), cos(c) * sin(b) * cos(a) + sin(c) * sin(a) },
+    { sin(c) * cos(b), sin(c) * sin(b) * sin(a) + cos(c) * cos(a), sin(c) * sin(b) * cos(a) - cos(c) * sin(a) },
+    { -sin(b), cos(b) * sin(a), cos(b) * cos(a) },
+  };
+  Pose pose;
+  for(uint8_t i = 0; i < 3; i++) {
+    pose.position[i] = (int32_t)lround(position[i] * 65536);
+    for(uint8_t j = 0; j < 3; j++)
+      pose.rotation[i][j] = (int32_t)lround(r[i][j] * PoseSolver::ONE_Q30);
+  }
+  return pose;
+}
+
+static void pose_report(const Fixture& fixture) {
+  //Every solve along the track warm-started from the last, as while tracking, and every one
+  //started cold, with noise on every angle. Not timed, as this is about the answers
+  PoseSolver warm_solver, cold_solver, projector;
+  warm_solver.set_geometry_um(fixture.positions_um, fixture.sensors);
+  cold_solver.set_geometry_um(fixture.positions_um, fixture.sensors);
+  uint32_t valid_mask = fixture.sensors < 32 ? (1u << fixture.sensors) - 1 : 0xffffffff;
+  uint32_t random_state = 0x2545f491;
+  int32_t noise_q16 = (int32_t)(POSE_NOISE_DEG * 65536);
+
+  PoseSummary warm, cold;
+  for(uint32_t trial = 0; trial < POSE_TRIALS; trial++) {
+    Pose truth = track_pose(trial);
+    int32_t x[PoseSolver::MAX_SENSORS], y[PoseSolver::MAX_SENSORS];
+    for(uint8_t s = 0; s < fixture.sensors; s++) {
+      int32_t point[3];
+      for(uint8_t i = 0; i < 3; i++)
+        point[i] = (int32_t)(((int64_t)fixture.positions_um[s][i] << 16) / 1000000);
+      int32_t u = 0, v = 0;
+      projector.project(truth, point, u, v);
+
+      //xorshift32, for noise spread evenly over +-POSE_NOISE_DEG
+      random_state ^= random_state << 13;
+      random_state ^= random_state >> 17;
+      random_state ^= random_state << 5;
+      x[s] = PoseSolver::tangent_to_angle(u) + (int32_t)(random_state % (2 * noise_q16 + 1)) - noise_q16;
+      random_state ^= random_state << 13;
+      random_state ^= random_state >> 17;
+      random_state ^= random_state << 5;
+      y[s] = PoseSolver::tangent_to_angle(v) + (int32_t)(random_state % (2 * noise_q16 + 1)) - noise_q16;
+    }
+
+    //The first solve, and any after losing track, start cold whatever the solver is given
+    bool tracking = warm_solver.is_tracking();
+    PoseSolver::Result result = warm_solver.solve(x, y, valid_mask);
+    if(tracking)
+      warm.add(warm_solver, result, truth);
+    cold_solver.reset();
+    cold.add(cold_solver, cold_solver.solve(x, y, valid_mask), truth);
+  }
+
+  warm.print("warm", fixture.sensors);
+  cold.print("cold", fixture.sensors);
+
+  //The budget allows every warm iteration, at the Cortex-M0+ costs PoseSolver estimates
+  uint32_t mean_cycles = PoseSolver::solve_cycles(fixture.sensors, (uint8_t)ceil(warm.mean_iterations()));
+  uint32_t budget = PoseSolver::solve_budget_cycles(fixture.sensors);
+  printf("# pose, %u, budget: %u cycles (%.2fms at %uMHz), a warm solve of %u iterations about %u cycles\n", fixture.sensors,
+         budget, budget * 1000.0 / LighthouseTiming::SYS_CLOCK_HZ, LighthouseTiming::SYS_CLOCK_HZ / 1000000,
+         (uint32_t)ceil(warm.mean_iterations()), mean_cycles);
+}
+
+static void fill_frame(const Fixture& fixture, uint32_t index, FrameCodec::AnglesFrame& frame) {
+  const std::vector<int32_t>& x = fixture.pose_x[index % POSE_STEPS];
+  const std::vector<int32_t>& y = fixture.pose_y[index % POSE_STEPS];
+  frame.header.timestamp_us = index * FILTER_RATE_US;
+  frame.header.sensor_count = fixture.sensors;
+  frame.valid_mask = fixture.sensors < 32 ? (1u << fixture.sensors) - 1 : 0xffffffff;
+  frame.station = 0;
+  for(uint8_t s = 0; s < fixture.sensors; s++) {
+    frame.x_angle[s] = x[s];
+    frame.y_angle[s] = y[s];
+  }
+}
+
+static uint64_t encode(const Fixture& fixture, uint64_t& checksum) {
+  FrameCodec::AnglesFrame frame = {};
+  uint8_t out[FrameCodec::MAX_ENCODED_SIZE];
+  for(uint32_t i = 0; i < OUTPUT_FRAMES; i++) {
+    fill_frame(fixture, i, frame);
+    frame.header.sequence = (uint16_t)i;
+    uint32_t length = FrameCodec::encode_angles(frame, out);
+    checksum = mix(checksum, length);
+    checksum = mix(checksum, FrameCodec::crc16(out, length));
+  }
+  return OUTPUT_FRAMES;
+}
+
+static uint64_t output_checksum = 0;
+
+static uint32_t write_all(const uint8_t* data, uint32_t length) {
+  output_checksum = mix(output_checksum, FrameCodec::crc16(data, length));
+  return length;
+}
+
+static uint64_t output(const Fixture& fixture, uint64_t& checksum) {
+  //A transport that takes everything, so this is the cost of queueing and encoding
+  BinaryOutput sender(write_all);
+  FrameCodec::AnglesFrame frame = {};
+  output_checksum = checksum;
+  for(uint32_t i = 0; i < OUTPUT_FRAMES; i++) {
+    fill_frame(fixture, i, frame);
+    sender.submit_angles(frame);
+    sender.service();
+  }
+  checksum = output_checksum;
+  return OUTPUT_FRAMES;
+}
+
+static const Benchmark BENCHMARKS[] = {
+  { "decode",          "word",   1, decode, nullptr },
+  { "decode-inline",   "word",   1, decode_inline, nullptr },
+  { "decode-tracked",  "word",   1, decode_tracked, nullptr },
+  { "decode-noisy",    "word",   1, decode_noisy, nullptr },
+  { "angles",          "sweep",  1, angles, nullptr },
+  { "angles-float",    "sweep",  1, angles_float, nullptr },
+  { "ring",            "word",   1, ring, nullptr },
+  { "ring-threaded",   "word",   1, ring_threaded, nullptr },
+  { "filter",          "sweep",  1, filter, nullptr },
+  { "pose",            "solve",  PoseSolver::MIN_SENSORS, pose, pose_report },
+  { "encode",          "frame",  1, encode, nullptr },
+  { "output",          "frame",  1, output, nullptr },
+};
+
+int main(int argc, char* argv[]) {
+  const char* filter_name = nullptr;
+  std::vector<uint8_t> sensor_counts = { 1, 2, 4, 8, 16, 32 };
+  double min_seconds = 0.2;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--sensors") == 0 && i + 1 < argc) {
+      sensor_counts.clear();
+      for(char* item = strtok(argv[++i], ","); item != nullptr; item = strtok(nullptr, ",")) {
+        int count = atoi(item);
+        if(count < 1 || count > PulseDecoder::MAX_SENSORS) {
+          fprintf(stderr, "sensor counts must be 1 to %u\n", PulseDecoder::MAX_SENSORS);
+          return 1;
+        }
+        sensor_counts.push_back((uint8_t)count);
+      }
+    }
+    else if(strcmp(argv[i], "--min-ms") == 0 && i + 1 < argc) {
+      min_seconds = atoi(argv[++i]) / 1000.0;
+    }
+    else {
+      filter_name = argv[i];
+    }
+  }
+
+  printf("# benchmark, sensors, ns per op, op, checksum\n");
+  for(uint8_t sensors : sensor_counts) {
+    Fixture fixture(sensors);
+    for(const Benchmark& benchmark : BENCHMARKS) {
+      if(filter_name != nullptr && strstr(benchmark.name, filter_name) == nullptr)
+        continue;
+      if(sensors < benchmark.min_sensors)
+        continue;
+
+      double best = 1e30;
+      double total = 0;
+      uint64_t first_checksum = 0;
+      bool first = true;
+      while(first || total < min_seconds) {
+        uint64_t checksum = 1469598103934665603ull;
+        auto start = std::chrono::steady_clock::now();
+        uint64_t ops = benchmark.run(fixture, checksum);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        total += seconds;
+        if(ops > 0 && seconds / ops < best)
+          best = seconds / ops;
+        if(first)
+          first_checksum = checksum;
+        first = false;
+      }
+      printf("%s, %u, %.1f, %s, %016llx\n", benchmark.name, sensors, best * 1e9, benchmark.op, (unsigned long long)first_checksum);
+      if(benchmark.report != nullptr)
+        benchmark.report(fixture);
+    }
+  }
+  return 0;
+}
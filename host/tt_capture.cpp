@@ -0,0 +1,113 @@
+// Records the raw capture stream from a TinyTracker built with RAW_CAPTURE_ENABLED
+// into a capture log, for replaying later with tt_replay.
+//
+// Usage: tt_capture output.ttcl [path]     (reads stdin when no path is given)
+
+#include <stdio.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "FrameReader.hpp"
+#include "CaptureLog.hpp"
+#include "LighthouseTiming.hpp"
+
+struct CaptureState {
+  CaptureLogWriter writer;
+  const char* path;
+  bool opened = false;
+  bool failed = false;
+  bool have_sequence = false;
+  uint16_t last_sequence = 0;
+  uint64_t words = 0;
+  uint64_t lost_words = 0;
+};
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int) {
+  stopping = 1;
+}
+
+static void on_frame(const uint8_t* data, uint32_t length, void* context) {
+  CaptureState& state = *static_cast<CaptureState*>(context);
+  FrameCodec::CaptureFrame frame;
+  if(state.failed || !FrameCodec::parse_capture(data, length, frame))
+    return;
+
+  //The log has to be created from the first frame, as that is where the sensor count and resolutions come from
+  if(!state.opened) {
+    if(!state.writer.open(state.path, frame.header.sensor_count, LighthouseTiming::SYS_CLOCK_HZ, LighthouseTiming::FREQ_DIVIDER,
+                          frame.high_resolution)) {
+      perror(state.path);
+      state.failed = true;
+      return;
+    }
+    state.opened = true;
+  }
+
+  //Mark frames lost on the link, whose size is unknown
+  if(state.have_sequence && (uint16_t)(frame.header.sequence - state.last_sequence) != 1)
+    state.writer.append_gap(0);
+  state.have_sequence = true;
+  state.last_sequence = frame.header.sequence;
+
+  for(uint8_t i = 0; i < frame.count; i++) {
+    state.writer.append_word(frame.sensor[i] & ~FrameCodec::CAPTURE_WINDOW, frame.header.timestamp_us + frame.offset_us[i], frame.word[i],
+                             frame.sensor[i] & FrameCodec::CAPTURE_WINDOW);
+  }
+  state.words += frame.count;
+
+  if(frame.dropped > 0) {
+    state.writer.append_gap(frame.dropped);
+    state.lost_words += frame.dropped;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if(argc < 2) {
+    fprintf(stderr, "usage: %s output.ttcl [path]\n", argv[0]);
+    return 1;
+  }
+
+  int fd = STDIN_FILENO;
+  if(argc > 2) {
+    fd = open(argv[2], O_RDONLY | O_NOCTTY);
+    if(fd < 0) {
+      perror(argv[2]);
+      return 1;
+    }
+  }
+
+  //Serial devices and ptys need to be in raw mode or the line discipline will mangle the frames
+  if(isatty(fd)) {
+    struct termios tio;
+    if(tcgetattr(fd, &tio) == 0) {
+      cfmakeraw(&tio);
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+  }
+
+  //Recording runs until interrupted, so finish the log cleanly on Ctrl-C
+  struct sigaction action = {};
+  action.sa_handler = stop;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  CaptureState state;
+  state.path = argv[1];
+  FrameReader reader(on_frame, &state);
+  uint8_t buffer[4096];
+  ssize_t count;
+  while(!stopping && !state.failed && (count = read(fd, buffer, sizeof(buffer))) > 0) {
+    reader.feed(buffer, (uint32_t)count);
+  }
+
+  bool closed = state.writer.close();
+  fprintf(stderr, "%llu words, %llu dropped on the tracker, %u frames lost on the link\n",
+          (unsigned long long)state.words, (unsigned long long)state.lost_words, reader.lost_count());
+
+  if(fd != STDIN_FILENO)
+    close(fd);
+  return (state.failed || !closed) ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+// Reads a TinyTracker binary output stream from a file, pipe or serial pty and
+// prints each frame as CSV:
+//   sequence, timestamp_us, station, valid_mask, x0, y0, x1, y1, ...
+//   pose, sequence, timestamp_us, station, status, iterations, x, y, z, r00 ... r22, residual
+//   stats, sequence, timestamp_us, capture pulses, then per stage (capture, decode, output)
+//     count, max cycles, median bucket floor; syncs, csyncs, sweeps, rejected, replaced, then per sensor
+//     high-water mark, dropped, overwritten
+//   link sync, sequence, timestamp_us, hops
+//   link events, sequence, timestamp_us, tracker, then per event
+//     timestamp_us, sensor, axis, station, mid2
+// (the link frames are only seen when reading the wire between chained trackers)
+//
+// Usage: tt_decode [path]     (reads stdin when no path is given)
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "FrameReader.hpp"
+
+static void print_pose(const uint8_t* data, uint32_t length) {
+  FrameCodec::PoseFrame frame;
+  if(!FrameCodec::parse_pose(data, length, frame))
+    return;
+
+  printf("pose, %u, %u, %u, %u, %u, %f, %f, %f", frame.header.sequence, frame.header.timestamp_us,
+         frame.station, frame.status, frame.iterations,
+         frame.position[0] / 65536.0, frame.position[1] / 65536.0, frame.position[2] / 65536.0);
+  for(uint8_t i = 0; i < 3; i++) {
+    for(uint8_t j = 0; j < 3; j++) {
+      printf(", %f", frame.rotation[i][j] / 1073741824.0);
+    }
+  }
+  printf(", %f\n", frame.residual / 65536.0);
+}
+
+static void print_stats(const uint8_t* data, uint32_t length) {
+  FrameCodec::StatsFrame frame;
+  if(!FrameCodec::parse_stats(data, length, frame))
+    return;
+
+  printf("stats, %u, %u, %u", frame.header.sequence, frame.header.timestamp_us, frame.capture_pulses);
+  for(uint8_t st = 0; st < FrameCodec::NUM_STAGES; st++) {
+    //The bucket holding the median, as its lowest cycle count
+    uint32_t seen = 0;
+    uint8_t median = 0;
+    for(uint8_t b = 0; b < CycleHistogram::NUM_BUCKETS; b++) {
+      seen += frame.stage_buckets[st][b];
+      if(seen * 2 >= frame.stage_count[st]) {
+        median = b;
+        break;
+      }
+    }
+    printf(", %u, %u, %u", frame.stage_count[st], frame.stage_max[st], CycleHistogram::bucket_floor(median));
+  }
+  printf(", %u, %u, %u, %u, %u", frame.decode.syncs, frame.decode.csyncs, frame.decode.sweeps, frame.decode.rejected,
+         frame.decode.replaced);
+  for(uint8_t s = 0; s < frame.header.sensor_count; s++) {
+    printf(", %u, %u, %u", frame.high_water[s], frame.dropped[s], frame.overwritten[s]);
+  }
+  printf("\n");
+}
+
+static void print_link(const uint8_t* data, uint32_t length) {
+  FrameCodec::LinkSyncFrame sync;
+  if(FrameCodec::parse_link_sync(data, length, sync)) {
+    printf("link sync, %u, %u, %u\n", sync.header.sequence, sync.header.timestamp_us, sync.hops);
+    return;
+  }
+
+  static FrameCodec::LinkEventsFrame frame;
+  if(!FrameCodec::parse_link_events(data, length, frame))
+    return;
+
+  printf("link events, %u, %u, %u", frame.header.sequence, frame.header.timestamp_us, frame.tracker);
+  for(uint8_t i = 0; i < frame.count; i++) {
+    printf(", %u, %u, %u, %u, %u", frame.timestamp_us[i], frame.sensor[i], frame.axis[i], frame.station[i], frame.mid2[i]);
+  }
+  printf("\n");
+}
+
+static void print_frame(const uint8_t* data, uint32_t length, void* context) {
+  (void)context;
+  if(data[0] == FrameCodec::FRAME_POSE) {
+    print_pose(data, length);
+    return;
+  }
+  if(data[0] == FrameCodec::FRAME_STATS) {
+    print_stats(data, length);
+    return;
+  }
+  if(data[0] == FrameCodec::FRAME_LINK_SYNC || data[0] == FrameCodec::FRAME_LINK_EVENTS) {
+    print_link(data, length);
+    return;
+  }
+
+  FrameCodec::AnglesFrame frame;
+  if(!FrameCodec::parse_angles(data, length, frame))
+    return;
+
+  printf("%u, %u, %u, 0x%08x", frame.header.sequence, frame.header.timestamp_us, frame.station, frame.valid_mask);
+  for(uint8_t s = 0; s < frame.header.sensor_count; s++) {
+    printf(", %f, %f", frame.x_angle[s] / 65536.0, frame.y_angle[s] / 65536.0);
+  }
+  printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+  int fd = STDIN_FILENO;
+  if(argc > 1) {
+    fd = open(argv[1], O_RDONLY | O_NOCTTY);
+    if(fd < 0) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+
+  //Serial devices and ptys need to be in raw mode or the line discipline will mangle the frames
+  if(isatty(fd)) {
+    struct termios tio;
+    if(tcgetattr(fd, &tio) == 0) {
+      cfmakeraw(&tio);
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+  }
+
+  FrameReader reader(print_frame);
+  uint8_t buffer[4096];
+  ssize_t count;
+  while((count = read(fd, buffer, sizeof(buffer))) > 0) {
+    reader.feed(buffer, (uint32_t)count);
+  }
+
+  fprintf(stderr, "%u frames, %u corrupt, %u lost\n", reader.frame_count(), reader.bad_count(), reader.lost_count());
+
+  if(fd != STDIN_FILENO)
+    close(fd);
+  return 0;
+}
@@ -0,0 +1,117 @@
+// Follows a sensor swinging on a sinusoid with SweepFilter, and checks its predictions
+// between sweeps beat holding the last sweep.
+//
+// Usage: tt_filter [seconds] [--amplitude deg] [--rate rad/s] [--noise deg] [--max-error deg]
+//   seconds       how long to follow the sensor for (default 10)
+//   --amplitude   the peak angle of the swing (default 10)
+//   --rate        how fast it swings (default 2)
+//   --noise       the largest error added to each measured sweep (default 0)
+//   --max-error   the largest prediction error allowed, in degrees (default 0.05)
+//
+// The sweeps alternate X then Y every 8333us, as one lighthouse gives them, so each axis is
+// measured every other cycle. Y swings a quarter turn behind X. Between sweeps both axes are
+// predicted every millisecond and compared against the true angle, as is the last measured
+// sweep. The first second is left out, while the rates settle. The fixed rate output is
+// also checked to give FILTER_OUTPUT_HZ samples when polled every millisecond. Exits with 1
+// if the worst prediction error is over the limit, or is not at least 4 times smaller than
+// holding the last sweep
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "SweepFilter.hpp"
+
+static const uint32_t CYCLE_US            = 8333;
+static const uint32_t STEP_US             = 1000;
+static const uint32_t SETTLE_US           = 1000000;
+static const uint32_t OUTPUT_HZ           = 250;
+static const double MIN_IMPROVEMENT       = 4.0;
+
+static inline double true_angle(uint8_t axis, uint32_t time_us, double amplitude, double rate) {
+  double t = time_us * 1e-6;
+  return amplitude * sin(rate * t - axis * M_PI / 2);
+}
+
+static inline int32_t to_q16(double degrees) {
+  return (int32_t)lround(degrees * 65536.0);
+}
+
+//Uniform in -1 to 1, from a fixed seed so runs can be compared
+static double uniform(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return (state / 4294967295.0) * 2.0 - 1.0;
+}
+
+int main(int argc, char* argv[]) {
+  double seconds = 10, amplitude = 10, rate = 2, noise = 0, max_error = 0.05;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--amplitude") == 0 && i + 1 < argc)
+      amplitude = atof(argv[++i]);
+    else if(strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+      rate = atof(argv[++i]);
+    else if(strcmp(argv[i], "--noise") == 0 && i + 1 < argc)
+      noise = atof(argv[++i]);
+    else if(strcmp(argv[i], "--max-error") == 0 && i + 1 < argc)
+      max_error = atof(argv[++i]);
+    else
+      seconds = atof(argv[i]);
+  }
+  if(seconds * 1e6 <= SETTLE_US) {
+    fprintf(stderr, "need to run for more than %.1fs\n", SETTLE_US * 1e-6);
+    return 1;
+  }
+
+  SweepFilter filter(1, 1000000 / OUTPUT_HZ);
+  double held[SweepFilter::NUM_AXES] = { 0, 0 };
+  double worst_predicted = 0, worst_held = 0, sum_predicted = 0, sum_held = 0;
+  uint32_t compared = 0, outputs = 0, output_polls = 0;
+  uint32_t noise_state = 0x1234567;
+
+  uint32_t end_us = (uint32_t)(seconds * 1e6);
+  uint32_t next_sweep_us = 0;
+  uint8_t next_axis = 0;
+  for(uint32_t now = 0; now < end_us; now += STEP_US) {
+    //Every sweep up to now, at the time it happened
+    while(next_sweep_us <= now) {
+      double measured = true_angle(next_axis, next_sweep_us, amplitude, rate) + noise * uniform(noise_state);
+      filter.update(0, next_axis, to_q16(measured), next_sweep_us);
+      held[next_axis] = measured;
+      next_sweep_us += CYCLE_US;
+      next_axis ^= 1;
+    }
+
+    if(now >= SETTLE_US) {
+      for(uint8_t axis = 0; axis < SweepFilter::NUM_AXES; axis++) {
+        double truth = true_angle(axis, now, amplitude, rate);
+        double predicted = fabs(filter.predict(0, axis, now) / 65536.0 - truth);
+        double held_error = fabs(held[axis] - truth);
+        worst_predicted = fmax(worst_predicted, predicted);
+        worst_held = fmax(worst_held, held_error);
+        sum_predicted += predicted;
+        sum_held += held_error;
+        compared++;
+      }
+      output_polls++;
+      if(filter.output_due(now))
+        outputs++;
+    }
+  }
+
+  double improvement = worst_predicted > 0 ? worst_held / worst_predicted : INFINITY;
+  uint32_t expected_outputs = output_polls * STEP_US * OUTPUT_HZ / 1000000;
+
+  printf("# %.0f deg at %.1f rad/s, +-%.3f deg noise: %u predictions over %.1fs\n", amplitude, rate, noise,
+         compared, (end_us - SETTLE_US) * 1e-6);
+  printf("# predicted: worst %.4f deg, mean %.4f deg\n", worst_predicted, compared > 0 ? sum_predicted / compared : 0.0);
+  printf("# held:      worst %.4f deg, mean %.4f deg (%.1fx the worst predicted)\n", worst_held,
+         compared > 0 ? sum_held / compared : 0.0, improvement);
+  printf("# %u outputs at %uHz, expected %u\n", outputs, OUTPUT_HZ, expected_outputs);
+
+  bool passed = worst_predicted <= max_error && improvement >= MIN_IMPROVEMENT
+                && outputs + 1 >= expected_outputs && outputs <= expected_outputs + 1;
+  printf("# %s\n", passed ? "passed" : "FAILED");
+  return passed ? 0 : 1;
+}
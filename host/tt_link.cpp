@@ -0,0 +1,309 @@
+// Runs a ring of chained trackers over pipes (or ptys) standing in for their UART links,
+// each with its own drifting clock, and checks the aggregator's merged stream against
+// the truth: how far each forwarded sweep's time is from the aggregator's own view of
+// it, and whether any were lost, duplicated or given the wrong sensor.
+//
+// Usage: tt_link [seconds] [--trackers n] [--sensors n] [--ppm n] [--baud n] [--pty]
+//   seconds     how long to simulate (default 5)
+//   --trackers  trackers on the ring, including the aggregator (default 3)
+//   --sensors   sensors on each tracker (default 4)
+//   --ppm       the largest clock error of each board's crystal (default 50)
+//   --baud      the link's line rate (default 921600)
+//   --pty       join the trackers with ptys in raw mode instead of pipes
+//
+// Time is simulated in TICK_NS steps. Each link's bytes are clocked onto the wire at
+// the line rate from a 32 byte FIFO, and only written to the pipe once their stop bit
+// would have arrived, with a step ending there so they are read as they arrive. Every tracker sees the same lighthouse, sweeping each sensor once
+// per cycle, and hands its sweeps to its link DECODE_LATENCY_NS later, timed in its own
+// clock. Exits with 1 if a follower fails to lock, or any sweep arrives late, misplaced
+// or not at all
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include <pty.h>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "TrackerLink.hpp"
+
+static const uint64_t TICK_NS           = 5000;
+static const uint64_t CYCLE_NS          = 8333000;
+static const uint64_t SWEEP_OFFSET_NS   = 4000000;    //From the start of the cycle to the first sensor's sweep
+static const uint64_t SENSOR_SPACING_NS = 50000;
+static const uint64_t DECODE_LATENCY_NS = 1000000;
+static const uint64_t SETTLE_NS         = 2000000000; //Left out of the error summary, while the clocks lock
+static const uint64_t DRAIN_NS          = 100000000;  //Quiet time at the end, for the last sweeps to arrive
+static const uint32_t UART_FIFO_BYTES   = 32;
+static const double MAX_ERROR_US        = 10.0;
+
+//A board's crystal, running fast or slow from its own starting point
+struct Clock {
+  uint32_t start_us;
+  double ppm;
+
+  uint32_t local_us(uint64_t true_ns) const {
+    return start_us + (uint32_t)(uint64_t)(true_ns * 1e-3 * (1.0 + ppm * 1e-6));
+  }
+};
+
+//One tracker's UART, as seen through the ends of the pipes it shares with its neighbours
+class SimPort : public LinkPort {
+  struct WireByte {
+    uint8_t value;
+    uint64_t done_ns;   //When its stop bit arrives at the far end
+  };
+
+  const Clock& clock;
+  const uint64_t& now_ns;
+  const int rx_fd;
+  const int tx_fd;
+  const uint64_t byte_ns;
+
+  std::deque<WireByte> fifo;
+  uint64_t line_free_ns = 0;
+  uint8_t rx[256];
+  uint32_t rx_length = 0;
+  uint32_t rx_offset = 0;
+  uint32_t rx_time_us = 0;
+
+public:
+  SimPort(const Clock& clock, const uint64_t& now_ns, int rx_fd, int tx_fd, uint32_t baud) :
+    clock(clock), now_ns(now_ns), rx_fd(rx_fd), tx_fd(tx_fd), byte_ns(10000000000ull / baud) {
+  }
+
+  uint32_t read(uint8_t* data, uint32_t max_length, uint32_t& time_us) override {
+    if(rx_offset == rx_length) {
+      ssize_t count = ::read(rx_fd, rx, sizeof(rx));
+      rx_offset = 0;
+      rx_length = count > 0 ? (uint32_t)count : 0;
+      rx_time_us = clock.local_us(now_ns);
+    }
+
+    uint32_t length = 0;
+    while(rx_offset < rx_length && length < max_length) {
+      data[length] = rx[rx_offset++];
+      if(data[length++] == 0)
+        break;
+    }
+    time_us = rx_time_us;
+    return length;
+  }
+
+  uint32_t write(const uint8_t* data, uint32_t length) override {
+    uint32_t taken = 0;
+    while(taken < length && fifo.size() < UART_FIFO_BYTES) {
+      uint64_t start = line_free_ns > now_ns ? line_free_ns : now_ns;
+      line_free_ns = start + byte_ns;
+      fifo.push_back({ data[taken++], line_free_ns });
+    }
+    return taken;
+  }
+
+  bool tx_idle() const override { return fifo.empty(); }
+  uint64_t next_done_ns() const { return fifo.empty() ? UINT64_MAX : fifo.front().done_ns; }
+  uint32_t time_us() const override { return clock.local_us(now_ns); }
+
+  //Passes on the bytes that have finished arriving. Returns how many
+  uint32_t tick() {
+    uint8_t out[UART_FIFO_BYTES];
+    uint32_t count = 0;
+    while(!fifo.empty() && fifo.front().done_ns <= now_ns) {
+      out[count++] = fifo.front().value;
+      fifo.pop_front();
+    }
+    if(count > 0 && ::write(tx_fd, out, count) != (ssize_t)count) {
+      perror("link write");
+      exit(1);
+    }
+    return count;
+  }
+};
+
+//Makes one link's pair of file descriptors, read end first
+static bool open_link(bool use_pty, int fds[2]) {
+  if(use_pty) {
+    int master, slave;
+    if(openpty(&master, &slave, nullptr, nullptr, nullptr) != 0)
+      return false;
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    fds[0] = slave;
+    fds[1] = master;
+  }
+  else if(pipe(fds) != 0) {
+    return false;
+  }
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  double seconds = 5;
+  uint32_t num_trackers = 3;
+  uint32_t sensors = 4;
+  double max_ppm = 50;
+  uint32_t baud = 921600;
+  bool use_pty = false;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--trackers") == 0 && i + 1 < argc)
+      num_trackers = (uint32_t)atoi(argv[++i]);
+    else if(strcmp(argv[i], "--sensors") == 0 && i + 1 < argc)
+      sensors = (uint32_t)atoi(argv[++i]);
+    else if(strcmp(argv[i], "--ppm") == 0 && i + 1 < argc)
+      max_ppm = atof(argv[++i]);
+    else if(strcmp(argv[i], "--baud") == 0 && i + 1 < argc)
+      baud = (uint32_t)atoi(argv[++i]);
+    else if(strcmp(argv[i], "--pty") == 0)
+      use_pty = true;
+    else
+      seconds = atof(argv[i]);
+  }
+  if(num_trackers < 2 || num_trackers > TrackerLink::MAX_TRACKERS || sensors == 0
+     || num_trackers * sensors > PulseDecoder::MAX_SENSORS || baud == 0 || seconds * 1e9 <= SETTLE_NS + DRAIN_NS) {
+    fprintf(stderr, "need 2 to %u trackers, at most %u sensors between them, and more than %.1f seconds\n",
+            TrackerLink::MAX_TRACKERS, PulseDecoder::MAX_SENSORS, (SETTLE_NS + DRAIN_NS) / 1e9);
+    return 1;
+  }
+
+  //Link k runs from tracker k's TX to the next tracker's RX, and the last back to the aggregator
+  std::vector<int> rx_fds(num_trackers), tx_fds(num_trackers);
+  for(uint32_t k = 0; k < num_trackers; k++) {
+    int fds[2];
+    if(!open_link(use_pty, fds)) {
+      perror("link");
+      return 1;
+    }
+    rx_fds[(k + 1) % num_trackers] = fds[0];
+    tx_fds[k] = fds[1];
+  }
+
+  //Spread the crystals across the range, and start the clocks close enough to wrapping that they do
+  uint64_t now_ns = 0;
+  std::vector<Clock> clocks(num_trackers);
+  std::vector<std::unique_ptr<SimPort>> ports;
+  std::vector<std::unique_ptr<TrackerLink>> links;
+  for(uint32_t k = 0; k < num_trackers; k++) {
+    clocks[k].ppm = max_ppm * (2.0 * k / (num_trackers - 1) - 1.0);
+    clocks[k].start_us = UINT32_MAX - (uint32_t)(seconds * 1e6 / 2) + k * 123457;
+    ports.emplace_back(new SimPort(clocks[k], now_ns, rx_fds[k], tx_fds[k], baud));
+    links.emplace_back(new TrackerLink(*ports[k], (uint8_t)k, (uint8_t)sensors, baud));
+  }
+
+  uint64_t end_ns = (uint64_t)(seconds * 1e9);
+  uint32_t num_cycles = (uint32_t)((end_ns - DRAIN_NS) / CYCLE_NS);
+  std::vector<uint32_t> next_cycle(num_trackers, 0);
+  std::vector<uint8_t> seen(num_cycles * num_trackers * sensors, 0);
+
+  double sum_sq = 0;
+  double max_error = 0;
+  uint32_t scored = 0;
+  uint32_t misplaced = 0;
+  uint32_t duplicates = 0;
+  uint32_t sent = 0;
+  std::vector<uint64_t> lock_ns(num_trackers, 0);
+
+  while(now_ns < end_ns) {
+    for(uint32_t k = 0; k < num_trackers; k++) {
+      //Make sure what went onto a pty has come out the other side before anyone reads
+      if(ports[k]->tick() > 0) {
+        struct pollfd pfd = { rx_fds[(k + 1) % num_trackers], POLLIN, 0 };
+        poll(&pfd, 1, 1000);
+      }
+    }
+
+    for(uint32_t k = 1; k < num_trackers; k++) {
+      while(next_cycle[k] < num_cycles && now_ns >= next_cycle[k] * CYCLE_NS + SWEEP_OFFSET_NS + DECODE_LATENCY_NS) {
+        uint32_t c = next_cycle[k]++;
+        SweepEvent events[PulseDecoder::MAX_SENSORS];
+        for(uint32_t s = 0; s < sensors; s++) {
+          events[s].mid2 = c;
+          events[s].timestamp_us = clocks[k].local_us(c * CYCLE_NS + SWEEP_OFFSET_NS + s * SENSOR_SPACING_NS);
+          events[s].sensor = (uint8_t)s;
+          events[s].axis = c & 1;
+          events[s].station = 0;
+          events[s].type = SweepEvent::SWEEP;
+        }
+        links[k]->send(events, sensors);
+      }
+      if(lock_ns[k] == 0 && links[k]->locked())
+        lock_ns[k] = now_ns;
+    }
+
+    for(uint32_t k = 0; k < num_trackers; k++) {
+      links[k]->service();
+    }
+
+    SweepEvent merged[32];
+    uint32_t count;
+    while((count = links[0]->take(merged, 32)) > 0) {
+      for(uint32_t e = 0; e < count; e++) {
+        const SweepEvent& event = merged[e];
+        uint32_t k = event.sensor / sensors;
+        uint32_t s = event.sensor % sensors;
+        uint32_t c = event.mid2;
+        if(k == 0 || k >= num_trackers || c >= num_cycles || event.axis != (c & 1)) {
+          misplaced++;
+          continue;
+        }
+        if(seen[(c * num_trackers + k) * sensors + s]++ > 0) {
+          duplicates++;
+          continue;
+        }
+
+        uint64_t true_ns = c * CYCLE_NS + SWEEP_OFFSET_NS + s * SENSOR_SPACING_NS;
+        if(true_ns < SETTLE_NS)
+          continue;
+        double error = (int32_t)(event.timestamp_us - clocks[0].local_us(true_ns));
+        sum_sq += error * error;
+        max_error = fmax(max_error, fabs(error));
+        scored++;
+      }
+    }
+
+    //Step to the next tick, or sooner if a byte finishes arriving before then
+    uint64_t next_ns = now_ns + TICK_NS;
+    for(uint32_t k = 0; k < num_trackers; k++) {
+      if(ports[k]->next_done_ns() < next_ns)
+        next_ns = ports[k]->next_done_ns();
+    }
+    now_ns = next_ns;
+  }
+
+  printf("# %u trackers of %u sensors over %s at %u baud, %.1f seconds\n", num_trackers, sensors,
+         use_pty ? "ptys" : "pipes", baud, seconds);
+  bool locked = true;
+  for(uint32_t k = 1; k < num_trackers; k++) {
+    const TrackerLink& link = *links[k];
+    printf("# tracker %u: %+.1fppm, locked after %.2fs, drift %+.3fppm measured, %u beacons, %u outliers, %u restarts, "
+           "%u events sent, %u lost, %u frames forwarded\n",
+           k, clocks[k].ppm, lock_ns[k] / 1e9, link.drift_ppb() / 1000.0, link.beacons_in(), link.outliers(), link.restarts(),
+           link.events_out(), link.events_lost(), link.forwarded());
+    locked = locked && lock_ns[k] > 0 && lock_ns[k] < SETTLE_NS && link.restarts() == 0;
+    sent += link.events_out();
+  }
+
+  const TrackerLink& aggregator = *links[0];
+  uint32_t missing = sent - aggregator.events_in();
+  printf("# aggregator: %u beacons sent, %u events merged, %u missing, %u misplaced, %u duplicated, %u bad frames\n",
+         aggregator.beacons_out(), aggregator.events_in(), missing, misplaced, duplicates, aggregator.bad_count());
+  printf("# time error after %.1fs: rms %.2fus, max %.0fus over %u sweeps\n", SETTLE_NS / 1e9,
+         scored > 0 ? sqrt(sum_sq / scored) : 0.0, max_error, scored);
+
+  bool passed = locked && missing == 0 && misplaced == 0 && duplicates == 0 && aggregator.bad_count() == 0
+                && scored > 0 && max_error <= MAX_ERROR_US;
+  printf("# %s\n", passed ? "passed" : "FAILED");
+
+  for(uint32_t k = 0; k < num_trackers; k++) {
+    close(rx_fds[k]);
+    close(tx_fds[k]);
+  }
+  return passed ? 0 : 1;
+}
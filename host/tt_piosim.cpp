@@ -0,0 +1,582 @@
+// Runs the firmware's lighthouse.pio program in a cycle-accurate PIO interpreter
+// against generated sensor waveforms, and prints every word it pushes:
+//   cycle, time_us, word, start, end, length_ns, kind
+//
+// Usage: tt_piosim [scenario] [--pio-dir dir] [--log file.ttcl]
+//   simulated [n]     n cycles of simulated_lh.pio's output (default 3)
+//   min-pulse         the shortest pulse the program accepts, in system cycles
+//   wrap              pulses either side of the counting window's 16 bit timer running out
+//   multi             sync, second sync and sweep pulses sharing counting windows
+//   pulses a:b,...    pulses starting at a us, b us long
+//   group [n]         n sensors (default 8) read by sensor_group.pio and EdgeDemux, compared
+//                     against one lighthouse.pio state machine each
+//   hires [n]         n cycles (default 100) of sweeps at sub-count offsets, timed by
+//                     lighthouse.pio and by lighthouse_hires.pio with EdgeTimer, comparing the
+//                     angle error of each
+//
+// With --log, the words are also written to a capture log for tt_replay. For hires these are
+// EdgeTimer's pulse words, and the log marks the sensor as high resolution
+//
+// Every scenario but pulses checks what it got against what the program should give, and
+// exits with 1 if it differs
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "PioStateMachine.hpp"
+#include "PulseTrain.hpp"
+#include "LighthouseTiming.hpp"
+#include "CaptureLog.hpp"
+#include "EdgeDemux.hpp"
+#include "EdgeTimer.hpp"
+#include <math.h>
+
+#ifndef TT_PIO_DIR
+#define TT_PIO_DIR "."
+#endif
+
+static const uint8_t SENSOR_PIN = 0;
+static const uint8_t DEBUG_PIN = 1;
+static const uint8_t SIMULATED_OUT_PIN = 2;
+static const uint16_t SET_X_0 = 0xe020;    //set x, 0, which lighthouse_program_start runs
+static const uint16_t MOV_OSR_NOT_NULL = 0xa0eb;   //mov osr, ~null and set y, 0, which sensor_group_program_start runs
+static const uint16_t SET_Y_0 = 0xe040;
+
+static const uint32_t CYCLES_PER_COUNT = LighthouseTiming::PIO_LOOP_CYCLES * LighthouseTiming::FREQ_DIVIDER;
+static const uint64_t MIN_PULSE_CYCLES = 6241;      //One past the 6240 cycle blocker in lighthouse.pio
+static const uint32_t COUNT_TOLERANCE = 2;          //Counts a word may be off by, for the cycles each edge takes to be seen
+static const double CYCLES_PER_COUNT_TOLERANCE = 0.01;
+static const double ANGLE_TOLERANCE_DEG = 0.02;
+static const double MIN_HIRES_GAIN = 3.0;           //How much finer lighthouse_hires.pio's sweeps must be
+
+static CaptureLogWriter log_writer;
+
+static uint32_t train_pins(uint64_t cycle, void* context) {
+  return (uint32_t)static_cast<const PulseTrain*>(context)->level_at(cycle) << SENSOR_PIN;
+}
+
+static uint32_t group_pins(uint64_t cycle, void* context) {
+  const std::vector<PulseTrain>& trains = *static_cast<const std::vector<PulseTrain>*>(context);
+  uint32_t pins = 0;
+  for(size_t s = 0; s < trains.size(); s++) {
+    pins |= (uint32_t)trains[s].level_at(cycle) << (SENSOR_PIN + s);
+  }
+  return pins;
+}
+
+static uint32_t no_pins(uint64_t cycle, void* context) {
+  (void)cycle;
+  (void)context;
+  return 0;
+}
+
+//The same setup as lighthouse_program_init
+static PioConfig lighthouse_config() {
+  PioConfig config;
+  config.clkdiv_int = LighthouseTiming::FREQ_DIVIDER;
+  config.jmp_pin = SENSOR_PIN;
+  config.in_base = SENSOR_PIN;
+  config.in_shift_right = false;
+  config.join_rx = true;
+  config.sideset_base = DEBUG_PIN;
+  return config;
+}
+
+enum WordKind { SYNC, CSYNC, SWEEP };
+
+static WordKind word_kind(uint32_t word) {
+  uint32_t start = LighthouseTiming::word_start(word);
+  if(start == 0)
+    return SYNC;
+  return (LighthouseTiming::word_end(word) - start >= LighthouseTiming::CSYNC_MIN_COUNTS) ? CSYNC : SWEEP;
+}
+
+static bool expect(bool passed, const char* what) {
+  if(!passed)
+    printf("# FAILED: %s\n", what);
+  return passed;
+}
+
+//Checks a word is of the given kind, and starts and ends within COUNT_TOLERANCE of the given counts
+static bool expect_word(const std::vector<PioStateMachine::RxWord>& words, size_t index, WordKind kind,
+                        uint32_t start, uint32_t end, const char* what) {
+  char message[120];
+  if(index >= words.size()) {
+    snprintf(message, sizeof(message), "%s: no word %zu", what, index);
+    return expect(false, message);
+  }
+  uint32_t value = words[index].value;
+  uint32_t start_error = abs((int32_t)LighthouseTiming::word_start(value) - (int32_t)start);
+  uint32_t end_error = abs((int32_t)LighthouseTiming::word_end(value) - (int32_t)end);
+  snprintf(message, sizeof(message), "%s: word %zu is 0x%08x, expected kind %d from %u to %u", what, index, value, kind, start, end);
+  return expect(word_kind(value) == kind && start_error <= COUNT_TOLERANCE && end_error <= COUNT_TOLERANCE, message);
+}
+
+static inline uint32_t cycles_to_counts(uint64_t cycles) {
+  return (uint32_t)(cycles / CYCLES_PER_COUNT);
+}
+
+static void print_word(const PioStateMachine::RxWord& word) {
+  uint32_t start = LighthouseTiming::word_start(word.value);
+  uint32_t end = LighthouseTiming::word_end(word.value);
+  uint32_t length = end - start;
+
+  char kind[32];
+  if(word_kind(word.value) == SYNC)
+    snprintf(kind, sizeof(kind), "sync %u", LighthouseTiming::sync_data(length));
+  else if(word_kind(word.value) == CSYNC)
+    snprintf(kind, sizeof(kind), "csync %u", LighthouseTiming::sync_data(length));
+  else
+    snprintf(kind, sizeof(kind), "sweep %.3f", LighthouseTiming::mid2_to_angle(LighthouseTiming::word_mid2(word.value)) / 65536.0);
+
+  printf("%llu, %.3f, 0x%08x, %u, %u, %u, %s\n", (unsigned long long)word.cycle,
+         word.cycle * 1e6 / LighthouseTiming::SYS_CLOCK_HZ, word.value, start, end,
+         LighthouseTiming::counts_to_ns(length), kind);
+}
+
+//Runs lighthouse.pio over the pulse train, printing, counting and optionally keeping the words it pushes
+static uint32_t run_lighthouse(const PioProgram& program, const PulseTrain& train, uint64_t end_cycle, bool print,
+                               std::vector<PioStateMachine::RxWord>* words = nullptr) {
+  PioStateMachine sm(program, lighthouse_config(), train_pins, (void*)&train);
+  sm.exec(SET_X_0);
+
+  uint32_t count = 0;
+  PioStateMachine::RxWord word;
+  while(sm.current_cycle() < end_cycle) {
+    sm.step();
+    while(sm.rx_get(word)) {
+      if(print) {
+        print_word(word);
+        log_writer.append_word(0, (uint32_t)(word.cycle / (LighthouseTiming::SYS_CLOCK_HZ / 1000000)), word.value);    //Does nothing without --log
+      }
+      if(words != nullptr)
+        words->push_back(word);
+      count++;
+    }
+  }
+  return count;
+}
+
+static bool load(PioAssembler& assembler, const std::string& dir, const char* file, const char* name, PioProgram& program) {
+  if(!assembler.assemble_file(dir + "/" + file, name, program)) {
+    fprintf(stderr, "%s: %s\n", file, assembler.error().c_str());
+    return false;
+  }
+  return true;
+}
+
+static int simulated(const PioProgram& lighthouse, const std::string& dir, uint32_t cycles) {
+  PioAssembler assembler;
+  PioProgram program;
+  if(!load(assembler, dir, "simulated_lh.pio", "simulated_lh_out", program))
+    return 1;
+
+  //The same setup as simulated_lh_out_program_init, at 1us per cycle
+  PioConfig config;
+  config.clkdiv_int = 125;
+  config.set_base = SIMULATED_OUT_PIN;
+  config.set_count = 1;
+
+  PioStateMachine generator(program, config, no_pins);
+  PulseTrain train(LighthouseTiming::SYS_CLOCK_HZ);
+  uint64_t end = train.ns_to_cycles((uint64_t)PulseTrain::CYCLE_NS * cycles);
+  train.record(generator, SIMULATED_OUT_PIN, end);
+
+  printf("# %zu pulses from simulated_lh.pio\n", train.pulse_count());
+  std::vector<PioStateMachine::RxWord> words;
+  run_lighthouse(lighthouse, train, end + train.ns_to_cycles(PulseTrain::CYCLE_NS), true, &words);
+
+  //Each cycle is a sync, a second station's sync and a sweep across the middle, as PulseTrain's default
+  bool passed = expect(train.pulse_count() == 3 * cycles && words.size() == 3 * cycles, "simulated: not 3 pulses and 3 words per cycle");
+  for(size_t i = 0; i + 2 < words.size(); i += 3) {
+    passed &= expect(word_kind(words[i].value) == SYNC && word_kind(words[i + 1].value) == CSYNC
+                     && word_kind(words[i + 2].value) == SWEEP, "simulated: words not a sync, C-sync and sweep");
+    double angle = LighthouseTiming::mid2_to_angle(LighthouseTiming::word_mid2(words[i + 2].value)) / 65536.0;
+    passed &= expect(fabs(angle) <= ANGLE_TOLERANCE_DEG, "simulated: sweep not in the middle of the cycle");
+  }
+  return passed ? 0 : 1;
+}
+
+static int min_pulse(const PioProgram& lighthouse) {
+  //Binary search for the shortest single pulse that produces a word
+  uint64_t low = 1;
+  uint64_t high = 100000;
+  while(low < high) {
+    uint64_t length = (low + high) / 2;
+    PulseTrain train(LighthouseTiming::SYS_CLOCK_HZ);
+    train.add_pulse(1000, length);
+    if(run_lighthouse(lighthouse, train, 1000 + length + 1000, false) > 0)
+      high = length;
+    else
+      low = length + 1;
+  }
+  printf("# shortest accepted pulse: %llu cycles, %.3fus, expected %llu\n", (unsigned long long)low,
+         low * 1e6 / LighthouseTiming::SYS_CLOCK_HZ, (unsigned long long)MIN_PULSE_CYCLES);
+  return expect(low == MIN_PULSE_CYCLES, "min-pulse: not the blocker length") ? 0 : 1;
+}
+
+static int wrap(const PioProgram& lighthouse) {
+  //The window's timer counts down from 0xffff, one count per loop, so it runs out
+  //after about 65535 counts. A sweep just inside it keeps its counts near the top, then
+  //a sweep just after it is too short to open a new window, and a sync does
+  uint64_t window = (uint64_t)0xffff * CYCLES_PER_COUNT;
+  uint64_t sync = 1000;
+  uint64_t inside = sync + window - 3000;
+  uint64_t second_sync = sync + window + 20000;
+  uint64_t sync_length = PulseTrain(LighthouseTiming::SYS_CLOCK_HZ).ns_to_cycles(PulseTrain::SYNC_NS);
+  uint64_t sweep_length = PulseTrain(LighthouseTiming::SYS_CLOCK_HZ).ns_to_cycles(PulseTrain::SWEEP_NS);
+  PulseTrain train(LighthouseTiming::SYS_CLOCK_HZ);
+  train.add_pulse(sync, sync_length);
+  train.add_pulse(inside, sweep_length);
+  train.add_pulse(sync + window + 5000, sweep_length);
+  train.add_pulse(second_sync, sync_length);
+
+  printf("# window of %llu cycles\n", (unsigned long long)window);
+  std::vector<PioStateMachine::RxWord> words;
+  run_lighthouse(lighthouse, train, sync + 2 * window, true, &words);
+
+  //The sweep after the window runs out is dropped, so only the two syncs and the sweep inside it
+  bool passed = expect(words.size() == 3, "wrap: not 3 words");
+  passed &= expect_word(words, 0, SYNC, 0, cycles_to_counts(sync_length), "wrap: first sync");
+  passed &= expect_word(words, 1, SWEEP, cycles_to_counts(inside - sync), cycles_to_counts(inside - sync + sweep_length),
+                        "wrap: sweep inside the window");
+  passed &= expect_word(words, 2, SYNC, 0, cycles_to_counts(sync_length), "wrap: second sync");
+  passed &= expect(words.size() < 3 || words[2].cycle > second_sync, "wrap: second sync word before the second sync");
+  return passed ? 0 : 1;
+}
+
+static int multi(const PioProgram& lighthouse) {
+  //Three cycles with their sweeps in different places, the last without a second sync. Then,
+  //with no window open, a short pulse followed by another before the first's blocker has finished
+  const uint32_t SWEEP_OFFSETS_NS[3] = { PulseTrain::SWEEP_OFFSET_NS, 2000000, 6000000 };
+  const uint32_t SHORT_NS = 5000;
+  const uint32_t SECOND_OFFSET_NS = 30000;    //After the short pulse ends, but inside its 49.92us blocker
+  const uint32_t SECOND_NS = 30000;           //Still high when the blocker finishes
+
+  PulseTrain train(LighthouseTiming::SYS_CLOCK_HZ);
+  for(uint32_t c = 0; c < 3; c++)
+    train.add_lighthouse_cycle((uint64_t)c * PulseTrain::CYCLE_NS, SWEEP_OFFSETS_NS[c], c != 2);
+  uint64_t last_cycle = 3ull * PulseTrain::CYCLE_NS;
+  train.add_pulse_ns(last_cycle, SHORT_NS);
+  train.add_pulse_ns(last_cycle + SECOND_OFFSET_NS, SECOND_NS);
+  std::vector<PioStateMachine::RxWord> words;
+  run_lighthouse(lighthouse, train, train.ns_to_cycles(5 * PulseTrain::CYCLE_NS), true, &words);
+
+  uint32_t sync_end = cycles_to_counts(train.ns_to_cycles(PulseTrain::SYNC_NS));
+  uint32_t second_start = cycles_to_counts(train.ns_to_cycles(PulseTrain::SECOND_SYNC_OFFSET_NS));
+  uint32_t second_end = cycles_to_counts(train.ns_to_cycles(PulseTrain::SECOND_SYNC_OFFSET_NS + PulseTrain::SECOND_SYNC_NS));
+  bool passed = expect(words.size() == 9, "multi: not 9 words");
+  size_t w = 0;
+  for(uint32_t c = 0; c < 3; c++) {
+    passed &= expect_word(words, w++, SYNC, 0, sync_end, "multi: sync");
+    if(c != 2)
+      passed &= expect_word(words, w++, CSYNC, second_start, second_end, "multi: second station's sync");
+    passed &= expect_word(words, w++, SWEEP, cycles_to_counts(train.ns_to_cycles(SWEEP_OFFSETS_NS[c])),
+                          cycles_to_counts(train.ns_to_cycles(SWEEP_OFFSETS_NS[c] + PulseTrain::SWEEP_NS)), "multi: sweep");
+  }
+
+  //The pin is only checked again once the blocker is done, so the two pulses come out as one
+  //window-opening word, from the short pulse's rise to the second's fall, which passes for a sync
+  passed &= expect_word(words, w++, SYNC, 0, cycles_to_counts(train.ns_to_cycles(SECOND_OFFSET_NS + SECOND_NS)),
+                        "multi: pulses inside one blocker not merged");
+
+  //Work back from a sweep's counts to the loop length, to check the timing constants
+  PulseTrain single(LighthouseTiming::SYS_CLOCK_HZ);
+  single.add_lighthouse_cycle(0);
+  std::vector<PioStateMachine::RxWord> single_words;
+  run_lighthouse(lighthouse, single, single.ns_to_cycles(PulseTrain::CYCLE_NS), false, &single_words);
+  double cycles_per_count = single_words.empty() ? 0.0 :
+    (double)single.ns_to_cycles(PulseTrain::SWEEP_OFFSET_NS) / LighthouseTiming::word_start(single_words.back().value);
+  printf("# %.3f cycles per count, PIO_LOOP_CYCLES is %u\n", cycles_per_count, LighthouseTiming::PIO_LOOP_CYCLES);
+  passed &= expect(fabs(cycles_per_count - CYCLES_PER_COUNT) <= CYCLES_PER_COUNT_TOLERANCE, "multi: cycles per count is not PIO_LOOP_CYCLES");
+  return passed ? 0 : 1;
+}
+
+static int pulses(const PioProgram& lighthouse, const char* list) {
+  PulseTrain train(LighthouseTiming::SYS_CLOCK_HZ);
+  std::string text(list);
+  size_t position = 0;
+  while(position < text.size()) {
+    size_t comma = text.find(',', position);
+    std::string pulse = text.substr(position, comma == std::string::npos ? std::string::npos : comma - position);
+    double start_us, length_us;
+    if(sscanf(pulse.c_str(), "%lf:%lf", &start_us, &length_us) != 2) {
+      fprintf(stderr, "bad pulse %s, expected start_us:length_us\n", pulse.c_str());
+      return 1;
+    }
+    train.add_pulse_ns((uint64_t)(start_us * 1000), (uint64_t)(length_us * 1000));
+    position = (comma == std::string::npos) ? text.size() : comma + 1;
+  }
+  run_lighthouse(lighthouse, train, train.end_cycle() + train.ns_to_cycles(PulseTrain::CYCLE_NS), true);
+  return 0;
+}
+
+static int group(const PioProgram& lighthouse, const std::string& dir, uint32_t num_sensors) {
+  PioAssembler assembler;
+  PioProgram program;
+  if(!load(assembler, dir, "sensor_group.pio", "sensor_group", program))
+    return 1;
+
+  if(num_sensors < 1 || num_sensors > EdgeDemux::MAX_CHANNELS) {
+    fprintf(stderr, "a group has 1 to %u sensors\n", EdgeDemux::MAX_CHANNELS);
+    return 1;
+  }
+
+  //The same patch as sensor_group_patch
+  uint8_t sample = program.labels["sample"];
+  uint8_t stamp = program.labels["stamp"];
+  program.instructions[sample] = (program.instructions[sample] & ~0x1f) | (num_sensors & 0x1f);
+  program.instructions[stamp] = (program.instructions[stamp] & ~0x1f) | ((32 - num_sensors) & 0x1f);
+
+  //Every sensor sees the same syncs, with sweeps spread out as if across a constellation,
+  //and a few pairs landing in the same sample
+  const uint32_t CYCLES = 3;
+  std::vector<PulseTrain> trains(num_sensors, PulseTrain(LighthouseTiming::SYS_CLOCK_HZ));
+  for(uint32_t s = 0; s < num_sensors; s++) {
+    for(uint32_t c = 0; c < CYCLES; c++) {
+      trains[s].add_lighthouse_cycle((uint64_t)c * PulseTrain::CYCLE_NS, 2000000 + (s / 2) * 400000 + c * 1000, c != 1);
+    }
+  }
+  uint64_t end = trains[0].ns_to_cycles((uint64_t)PulseTrain::CYCLE_NS * (CYCLES + 1));
+
+  //The same setup as sensor_group_program_init
+  PioConfig config;
+  config.clkdiv_int = LighthouseTiming::FREQ_DIVIDER;
+  config.in_base = SENSOR_PIN;
+  config.in_shift_right = false;
+  config.join_rx = true;
+
+  PioStateMachine sm(program, config, group_pins, &trains);
+  sm.exec(MOV_OSR_NOT_NULL);
+  sm.exec(SET_Y_0);
+
+  std::vector<PioStateMachine::RxWord> group_words;
+  PioStateMachine::RxWord word;
+  while(sm.current_cycle() < end) {
+    sm.step();
+    while(sm.rx_get(word))
+      group_words.push_back(word);
+  }
+
+  //Demux as the interrupt would, reading each word as it is pushed
+  const uint32_t CYCLES_PER_US = LighthouseTiming::SYS_CLOCK_HZ / 1000000;
+  std::vector<std::vector<uint32_t>> demuxed(num_sensors);
+  EdgeDemux demux((uint8_t)num_sensors);
+  uint32_t pulse_words[EdgeDemux::MAX_CHANNELS];
+  uint8_t channels[EdgeDemux::MAX_CHANNELS];
+  for(const PioStateMachine::RxWord& w : group_words) {
+    uint32_t count = demux.feed(w.value, (uint32_t)(w.cycle / CYCLES_PER_US), pulse_words, channels);
+    for(uint32_t i = 0; i < count; i++)
+      demuxed[channels[i]].push_back(pulse_words[i]);
+  }
+
+  //Compare against a lighthouse.pio state machine per sensor
+  uint32_t lighthouse_total = 0;
+  uint32_t demux_total = 0;
+  uint32_t max_error = 0;
+  uint32_t mismatched = 0;
+  printf("# sensor, lighthouse.pio words, demuxed words, max count difference\n");
+  for(uint32_t s = 0; s < num_sensors; s++) {
+    PioStateMachine single(lighthouse, lighthouse_config(), train_pins, &trains[s]);
+    single.exec(SET_X_0);
+    std::vector<uint32_t> expected;
+    while(single.current_cycle() < end) {
+      single.step();
+      while(single.rx_get(word))
+        expected.push_back(word.value);
+    }
+
+    uint32_t sensor_error = 0;
+    if(expected.size() != demuxed[s].size()) {
+      mismatched++;
+    }
+    for(size_t i = 0; i < expected.size() && i < demuxed[s].size(); i++) {
+      uint32_t start_error = abs((int32_t)LighthouseTiming::word_start(expected[i]) - (int32_t)LighthouseTiming::word_start(demuxed[s][i]));
+      uint32_t end_error = abs((int32_t)LighthouseTiming::word_end(expected[i]) - (int32_t)LighthouseTiming::word_end(demuxed[s][i]));
+      if(start_error > sensor_error)
+        sensor_error = start_error;
+      if(end_error > sensor_error)
+        sensor_error = end_error;
+    }
+    printf("%u, %zu, %zu, %u\n", s, expected.size(), demuxed[s].size(), sensor_error);
+
+    lighthouse_total += expected.size();
+    demux_total += demuxed[s].size();
+    if(sensor_error > max_error)
+      max_error = sensor_error;
+  }
+
+  //Time the demux alone, as the host's stand-in for the interrupt's cost per pulse
+  const uint32_t REPEATS = 2000;
+  uint64_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(uint32_t r = 0; r < REPEATS; r++) {
+    EdgeDemux timed((uint8_t)num_sensors);
+    for(const PioStateMachine::RxWord& w : group_words) {
+      uint32_t count = timed.feed(w.value, (uint32_t)(w.cycle / CYCLES_PER_US), pulse_words, channels);
+      checksum += count;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("# %u sensors on 1 state machine instead of %u\n", num_sensors, num_sensors);
+  printf("# FIFO words: %zu from sensor_group.pio, %u from lighthouse.pio, %.2f per pulse\n",
+         group_words.size(), lighthouse_total, demux_total > 0 ? (double)group_words.size() / demux_total : 0.0);
+  printf("# pulses: %u demuxed, %u expected, %u sensors with a different count, max difference %u counts (%uns)\n",
+         demux_total, lighthouse_total, mismatched, max_error, LighthouseTiming::counts_to_ns(max_error));
+  printf("# host demux: %.1fns per pulse (%llu)\n", checksum > 0 ? seconds * 1e9 / checksum : 0.0, (unsigned long long)checksum);
+  return mismatched == 0 ? 0 : 1;
+}
+
+//The spread of a set of angle errors, in degrees
+struct ErrorSummary {
+  uint32_t count = 0;
+  double sum = 0;
+  double sum_sq = 0;
+  double min = 1e9;
+  double max = -1e9;
+
+  void add(double error) {
+    count++;
+    sum += error;
+    sum_sq += error * error;
+    min = error < min ? error : min;
+    max = error > max ? error : max;
+  }
+  double mean() const { return count > 0 ? sum / count : 0.0; }
+  double deviation() const { return count > 1 ? sqrt((sum_sq - sum * sum / count) / (count - 1)) : 0.0; }
+};
+
+static void print_summary(const char* name, const ErrorSummary& summary, uint32_t words) {
+  printf("# %s: %u sweeps, %.2f FIFO words per pulse, bias %.5f deg, deviation %.5f deg, peak to peak %.5f deg\n",
+         name, summary.count, words / (summary.count * 2.0), summary.mean(), summary.deviation(), summary.max - summary.min);
+}
+
+static int hires(const PioProgram& lighthouse, const std::string& dir, uint32_t cycles) {
+  PioAssembler assembler;
+  PioProgram program;
+  if(!load(assembler, dir, "lighthouse_hires.pio", "lighthouse_hires", program))
+    return 1;
+
+  //One sync and sweep per cycle, with the sweep stepping by a prime number of ns so it lands
+  //at every offset within a count of both programs
+  const uint32_t STEP_NS = 997;
+  PulseTrain train(LighthouseTiming::SYS_CLOCK_HZ);
+  std::vector<double> expected;
+  for(uint32_t c = 0; c < cycles; c++) {
+    uint64_t start = (uint64_t)c * PulseTrain::CYCLE_NS;
+    uint32_t offset = 2000000 + c * STEP_NS;
+    train.add_lighthouse_cycle(start, offset, false);
+
+    //The sweep's true centre, in the same cycles the waveform was built from
+    uint64_t rise = train.ns_to_cycles(start);
+    double centre = (train.ns_to_cycles(start + offset) + train.ns_to_cycles(start + offset + PulseTrain::SWEEP_NS)) / 2.0 - rise;
+    double centre_ns = centre * 1e9 / LighthouseTiming::SYS_CLOCK_HZ;
+    expected.push_back((centre_ns - LighthouseTiming::SWEEP_CENTER_NS) * LighthouseTiming::SWEEP_HALF_RANGE_DEG
+                       / LighthouseTiming::SWEEP_HALF_RANGE_NS);
+  }
+  uint64_t end = train.end_cycle() + train.ns_to_cycles(PulseTrain::CYCLE_NS);
+
+  //lighthouse.pio, one word per pulse
+  ErrorSummary standard;
+  uint32_t standard_words = 0;
+  PioStateMachine sm(lighthouse, lighthouse_config(), train_pins, &train);
+  sm.exec(SET_X_0);
+  PioStateMachine::RxWord word;
+  while(sm.current_cycle() < end) {
+    sm.step();
+    while(sm.rx_get(word)) {
+      standard_words++;
+      if(LighthouseTiming::word_start(word.value) != 0 && standard.count < expected.size()) {
+        double angle = LighthouseTiming::mid2_to_angle(LighthouseTiming::word_mid2(word.value)) / 65536.0;
+        standard.add(angle - expected[standard.count]);
+      }
+    }
+  }
+
+  //The same setup as lighthouse_hires_program_init, starting at signal_low
+  PioConfig config = lighthouse_config();
+  config.autopush = true;
+  config.push_threshold = 32;
+
+  ErrorSummary high;
+  uint32_t high_words = 0;
+  EdgeTimer edges;
+  PioStateMachine hires_sm(program, config, train_pins, &train);
+  hires_sm.exec(program.labels["signal_low"]);    //jmp signal_low
+  hires_sm.exec(SET_X_0);
+  while(hires_sm.current_cycle() < end) {
+    hires_sm.step();
+    while(hires_sm.rx_get(word)) {
+      high_words++;
+      uint32_t pulse;
+      if(!edges.feed(word.value, pulse))
+        continue;
+      log_writer.append_word(0, (uint32_t)(word.cycle / (LighthouseTiming::SYS_CLOCK_HZ / 1000000)), pulse);    //Does nothing without --log
+      if(LighthouseTiming::word_start(pulse) != 0 && high.count < expected.size()) {
+        double angle = LighthouseTiming::mid2_to_angle(LighthouseTiming::hires_mid2(pulse)) / 65536.0;
+        high.add(angle - expected[high.count]);
+      }
+    }
+  }
+
+  print_summary("lighthouse.pio", standard, standard_words);
+  print_summary("lighthouse_hires.pio", high, high_words);
+  printf("# %.1fx finer, from %u to %u cycles per timer step\n", high.deviation() > 0 ? standard.deviation() / high.deviation() : 0.0,
+         LighthouseTiming::PIO_LOOP_CYCLES, LighthouseTiming::HIRES_LOOP_CYCLES);
+  bool passed = expect(standard.count == cycles && high.count == cycles, "hires: sweeps missing");
+  passed &= expect(high.deviation() * MIN_HIRES_GAIN <= standard.deviation(), "hires: not finer than lighthouse.pio by enough");
+  return passed ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+  std::string dir = TT_PIO_DIR;
+  const char* log_path = nullptr;
+  const char* positional[2] = { "simulated", nullptr };
+  int num_positional = 0;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--pio-dir") == 0 && i + 1 < argc) {
+      dir = argv[++i];
+    }
+    else if(strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+      log_path = argv[++i];
+    }
+    else if(num_positional < 2) {
+      positional[num_positional++] = argv[i];
+    }
+  }
+  const char* scenario = positional[0];
+  const char* argument = positional[1];
+
+  uint32_t high_resolution = (strcmp(scenario, "hires") == 0) ? 1 : 0;
+  if(log_path != nullptr && !log_writer.open(log_path, 1, LighthouseTiming::SYS_CLOCK_HZ, LighthouseTiming::FREQ_DIVIDER, high_resolution)) {
+    perror(log_path);
+    return 1;
+  }
+
+  PioAssembler assembler;
+  PioProgram lighthouse;
+  if(!load(assembler, dir, "lighthouse.pio", "lighthouse", lighthouse))
+    return 1;
+
+  if(strcmp(scenario, "simulated") == 0)
+    return simulated(lighthouse, dir, argument ? (uint32_t)atoi(argument) : 3);
+  if(strcmp(scenario, "min-pulse") == 0)
+    return min_pulse(lighthouse);
+  if(strcmp(scenario, "wrap") == 0)
+    return wrap(lighthouse);
+  if(strcmp(scenario, "multi") == 0)
+    return multi(lighthouse);
+  if(strcmp(scenario, "group") == 0)
+    return group(lighthouse, dir, argument ? (uint32_t)atoi(argument) : 8);
+  if(strcmp(scenario, "hires") == 0)
+    return hires(lighthouse, dir, argument ? (uint32_t)atoi(argument) : 100);
+  if(strcmp(scenario, "pulses") == 0 && argument != nullptr)
+    return pulses(lighthouse, argument);
+
+  fprintf(stderr, "unknown scenario %s\n", scenario);
+  return 1;
+}
@@ -0,0 +1,149 @@
+// Replays a capture log through the firmware's decoder, calibration and pose code,
+// as fast as it will go, and reports the throughput:
+//   time_us, station, valid_mask, x0, y0, x1, y1, ...
+//
+// Usage: tt_replay log.ttcl [--print] [--pose] [--geometry file] [--calibration] [--sync-tracking] [--repeat n]
+//   --pose alone solves with the firmware's placeholder constellation, while --geometry
+//   reads one "x y z" line per sensor, in micrometres. --calibration and --sync-tracking
+//   decode as CALIBRATION_ENABLED and SYNC_TRACKING_ENABLED do. A checksum of every output
+//   of the first run, sweep times included, is printed, so runs can be compared for regressions
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CaptureReplay.hpp"
+#include "LighthouseTiming.hpp"
+
+struct Output {
+  bool print;
+  uint64_t checksum = 1469598103934665603ull;
+};
+
+static void hash(Output& output, uint32_t value) {
+  //FNV-1a, over each byte
+  for(uint8_t i = 0; i < 4; i++) {
+    output.checksum ^= (value >> (8 * i)) & 0xff;
+    output.checksum *= 1099511628211ull;
+  }
+}
+
+static void on_sample(const ReplaySample& sample, void* context) {
+  Output& output = *static_cast<Output*>(context);
+  hash(output, sample.station);
+  hash(output, sample.valid_mask);
+  for(uint8_t s = 0; s < sample.sensor_count; s++) {
+    hash(output, (uint32_t)sample.x_angles[s]);
+    hash(output, (uint32_t)sample.y_angles[s]);
+    hash(output, sample.sweep_us[s]);
+  }
+  if(sample.pose != nullptr) {
+    for(uint8_t i = 0; i < 3; i++)
+      hash(output, (uint32_t)sample.pose->position[i]);
+  }
+
+  if(output.print) {
+    printf("%llu, %u, 0x%08x", (unsigned long long)sample.time_us, sample.station, sample.valid_mask);
+    for(uint8_t s = 0; s < sample.sensor_count; s++) {
+      printf(", %f, %f", sample.x_angles[s] / 65536.0, sample.y_angles[s] / 65536.0);
+    }
+    if(sample.pose != nullptr) {
+      printf(", %d, %f, %f, %f", (int)sample.pose_result,
+             sample.pose->position[0] / 65536.0, sample.pose->position[1] / 65536.0, sample.pose->position[2] / 65536.0);
+    }
+    printf("\n");
+  }
+}
+
+static bool load_geometry(const char* path, int32_t (*positions)[3], uint8_t& count) {
+  FILE* file = fopen(path, "r");
+  if(file == nullptr) {
+    perror(path);
+    return false;
+  }
+  count = 0;
+  long x, y, z;
+  while(count < PoseSolver::MAX_SENSORS && fscanf(file, "%ld %ld %ld", &x, &y, &z) == 3) {
+    positions[count][0] = (int32_t)x;
+    positions[count][1] = (int32_t)y;
+    positions[count][2] = (int32_t)z;
+    count++;
+  }
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  //The firmware's placeholder, a 20mm square
+  int32_t positions[PoseSolver::MAX_SENSORS][3] = {
+    { -10000, -10000, 0 }, { 10000, -10000, 0 }, { 10000, 10000, 0 }, { -10000, 10000, 0 },
+  };
+  uint8_t num_positions = 4;
+
+  const char* path = nullptr;
+  bool pose = false;
+  bool calibration = false;
+  bool sync_tracking = false;
+  uint32_t repeat = 1;
+  Output output;
+  output.print = false;
+
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--print") == 0) output.print = true;
+    else if(strcmp(argv[i], "--pose") == 0) pose = true;
+    else if(strcmp(argv[i], "--calibration") == 0) calibration = true;
+    else if(strcmp(argv[i], "--sync-tracking") == 0) sync_tracking = true;
+    else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = (uint32_t)atoi(argv[++i]);
+    else if(strcmp(argv[i], "--geometry") == 0 && i + 1 < argc) {
+      if(!load_geometry(argv[++i], positions, num_positions))
+        return 1;
+      pose = true;
+    }
+    else path = argv[i];
+  }
+  if(path == nullptr) {
+    fprintf(stderr, "usage: %s log.ttcl [--print] [--pose] [--geometry file] [--calibration] [--sync-tracking] [--repeat n]\n", argv[0]);
+    return 1;
+  }
+
+  CaptureLog log;
+  if(!log.open(path)) {
+    fprintf(stderr, "%s\n", log.error().c_str());
+    return 1;
+  }
+  if(log.sys_clock_hz() != LighthouseTiming::SYS_CLOCK_HZ || log.freq_divider() != LighthouseTiming::FREQ_DIVIDER) {
+    fprintf(stderr, "warning: log was recorded at %uHz / %u, but this build decodes for %uHz / %u\n",
+            log.sys_clock_hz(), log.freq_divider(), LighthouseTiming::SYS_CLOCK_HZ, LighthouseTiming::FREQ_DIVIDER);
+  }
+
+  ReplayStats total;
+  for(uint32_t r = 0; r < repeat; r++) {
+    //A fresh pipeline each time, so every repeat does the same work
+    CaptureReplay replay(log.sensor_count());
+    replay.set_calibration(calibration);
+    replay.set_high_resolution(log.high_resolution());
+    replay.set_sync_tracking(sync_tracking);
+    if(pose)
+      replay.set_geometry_um(positions, num_positions < log.sensor_count() ? num_positions : log.sensor_count());
+
+    ReplayStats stats = replay.run(log.records(), log.count(), r == 0 ? on_sample : nullptr, &output);
+    total.records += stats.records;
+    total.samples += stats.samples;
+    total.poses_solved += stats.poses_solved;
+    total.span_us += stats.span_us;
+    total.elapsed_ns += stats.elapsed_ns;
+    total.gaps = stats.gaps;
+    total.lost_words = stats.lost_words;
+    total.latched_windows = stats.latched_windows;
+    total.derived_windows = stats.derived_windows;
+  }
+
+  double seconds = total.elapsed_ns / 1e9;
+  fprintf(stderr, "%llu records, %llu gaps (%llu words lost), %llu windows (%llu latched), %llu samples, %llu poses\n",
+          (unsigned long long)total.records, (unsigned long long)total.gaps, (unsigned long long)total.lost_words,
+          (unsigned long long)(total.latched_windows + total.derived_windows), (unsigned long long)total.latched_windows,
+          (unsigned long long)total.samples, (unsigned long long)total.poses_solved);
+  fprintf(stderr, "%.3fs of capture in %.3fs, %.1fx real time, %.1f Mwords/s, checksum %016llx\n",
+          total.span_us / 1e6, seconds, seconds > 0 ? total.span_us / 1e6 / seconds : 0.0,
+          seconds > 0 ? total.records / seconds / 1e6 : 0.0, (unsigned long long)output.checksum);
+  return 0;
+}
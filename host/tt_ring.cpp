@@ -0,0 +1,295 @@
+// Checks PulseRing on its own and between a producer and a consumer thread, and reports
+// how fast words get through it. Also checks DmaRing against a stand-in DMA channel.
+//
+// Usage: tt_ring [words] [--batch n]
+//   words       words the producer pushes in each threaded run (default 10000000)
+//   --batch     the most words the consumer takes per pop_batch (default 32)
+//
+// The single threaded checks cover the counts wrapping past 2^32, rejecting pushes when
+// full and counting them as dropped, pop_batch copying out in two runs where the buffer
+// wraps, and the high water mark. The threaded runs push a running sequence, with the
+// counts starting just short of their wrap. The consumer checks nothing arrives out of
+// order or twice, that the gaps it sees add up to exactly the pushes the producer gave
+// up on, and that the dropped count matches the pushes rejected. One run retries
+// rejected pushes, so shows the lossless throughput, and one gives up on them as the
+// capture interrupt does.
+//
+// The DmaRing checks have the channel write each word's own count, so every word read
+// back shows whether it is the one that should be there. They cover the channel lapping
+// the consumer between pops and during a pop's copy, the dropped count in both cases, and
+// the counts and high water mark across their 2^32 wrap. Exits with 1 if any check fails
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "PulseRing.hpp"
+#include "DmaRing.hpp"
+
+static const uint32_t NEAR_WRAP = 0xffffffff - 5000;
+
+static uint32_t failures = 0;
+
+static void check(bool passed, const char* what) {
+  if(!passed) {
+    printf("# FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+static void wrap() {
+  //Starting a few items short, so the pushes and pops both cross the wrap
+  PulseRing<uint32_t, 16> ring(0xfffffffa);
+  uint32_t next_in = 0, next_out = 0;
+  bool in_order = true;
+  for(uint32_t round = 0; round < 12; round++) {
+    for(uint32_t i = 0; i < 3; i++)
+      ring.push(next_in++);
+    uint32_t item;
+    for(uint32_t i = 0; i < 2 && ring.pop(item); i++)
+      in_order = in_order && item == next_out++;
+  }
+  check(in_order && next_out == 24, "wrap: items missing or out of order across the count wrap");
+  check(ring.size() == 12 && !ring.empty(), "wrap: size wrong across the count wrap");
+  check(ring.dropped_count() == 0 && ring.high_water_mark() == 14, "wrap: drops or high water mark wrong across the count wrap");
+}
+
+static void full() {
+  PulseRing<uint32_t, 8> ring(0xfffffffd);
+  bool all_taken = true;
+  for(uint32_t i = 0; i < 8; i++)
+    all_taken = all_taken && ring.push(i);
+  check(all_taken, "full: rejected a push with room");
+  check(!ring.push(100) && !ring.push(101) && !ring.push(102), "full: accepted a push when full");
+  check(ring.dropped_count() == 3, "full: rejected pushes not counted as dropped");
+  check(ring.size() == 8 && ring.high_water_mark() == 8, "full: size or high water mark wrong");
+
+  //The rejected items must not have overwritten anything
+  uint32_t items[8];
+  bool intact = ring.pop_batch(items, 8) == 8;
+  for(uint32_t i = 0; intact && i < 8; i++)
+    intact = items[i] == i;
+  check(intact, "full: contents changed by rejected pushes");
+  check(ring.push(8) && ring.dropped_count() == 3, "full: no room after draining");
+}
+
+static void split() {
+  //Leave the read position 3 short of the end of the buffer, so a batch of 10 takes two runs
+  PulseRing<uint32_t, 16> ring;
+  uint32_t item;
+  for(uint32_t i = 0; i < 13; i++) {
+    ring.push(i);
+    ring.pop(item);
+  }
+  for(uint32_t i = 0; i < 10; i++)
+    ring.push(100 + i);
+
+  uint32_t items[16];
+  check(ring.pop_batch(items, 4) == 4, "split: batch not limited to max_count");
+  uint32_t count = ring.pop_batch(items + 4, 16);
+  bool in_order = count == 6;
+  for(uint32_t i = 0; in_order && i < 10; i++)
+    in_order = items[i] == 100 + i;
+  check(in_order, "split: batch across the end of the buffer out of order");
+  check(ring.empty() && ring.pop_batch(items, 16) == 0, "split: items left after draining");
+}
+
+static void high_water() {
+  PulseRing<uint32_t, 32> ring;
+  uint32_t items[32];
+  for(uint32_t i = 0; i < 5; i++)
+    ring.push(i);
+  ring.pop_batch(items, 32);
+  for(uint32_t i = 0; i < 3; i++)
+    ring.push(i);
+  check(ring.high_water_mark() == 5, "high water: not the most ever waiting");
+  for(uint32_t i = 0; i < 9; i++)
+    ring.push(i);
+  check(ring.high_water_mark() == 12, "high water: not raised");
+}
+
+//Stands in for the DMA channel, writing each word's count into the ring as it goes
+template<uint32_t CAPACITY>
+struct FakeDma {
+  DmaRing<CAPACITY>& ring;
+  uint32_t written;
+
+  void write(uint32_t count) {
+    for(uint32_t i = 0; i < count; i++, written++)
+      ring.data()[written & DmaRing<CAPACITY>::MASK] = written;
+  }
+};
+
+//True if the items are the words counted from first on
+static bool counted_from(const uint32_t* items, uint32_t count, uint32_t first) {
+  for(uint32_t i = 0; i < count; i++) {
+    if(items[i] != first + i)
+      return false;
+  }
+  return true;
+}
+
+static void dma_lapped() {
+  //Five words more than the ring holds. One more than those is given up, as it may be mid-write
+  DmaRing<16> ring;
+  FakeDma<16> dma{ring, 0};
+  auto written = [&]() { return dma.written; };
+  dma.write(21);
+  check(ring.size(dma.written) == 16, "dma lapped: size not held at capacity");
+
+  uint32_t items[32];
+  uint32_t count = ring.pop_batch(written, items, 32);
+  check(count == 15 && counted_from(items, count, 6), "dma lapped: overwritten words returned");
+  check(ring.dropped_count() == 6, "dma lapped: overwritten words not counted as dropped");
+
+  dma.write(3);
+  count = ring.pop_batch(written, items, 32);
+  check(count == 3 && counted_from(items, count, 21), "dma lapped: words lost after catching up");
+  check(ring.dropped_count() == 6 && ring.size(dma.written) == 0, "dma lapped: drops counted after catching up");
+}
+
+static void dma_copy_lap() {
+  //The channel writes ten more words once the consumer has read the count, so the first
+  //six slots it copies from have been overwritten with newer words by the time it does
+  DmaRing<16> ring;
+  FakeDma<16> dma{ring, 0};
+  dma.write(12);
+  bool lap = true;
+  auto written = [&]() {
+    uint32_t w = dma.written;
+    if(lap) {
+      dma.write(10);
+      lap = false;
+    }
+    return w;
+  };
+
+  uint32_t items[32];
+  uint32_t count = ring.pop_batch(written, items, 32);
+  check(count == 5 && counted_from(items, count, 7), "dma copy lap: words overwritten during the copy returned");
+  check(ring.dropped_count() == 7, "dma copy lap: words overwritten during the copy not counted as dropped");
+
+  count = ring.pop_batch(written, items, 32);
+  check(count == 10 && counted_from(items, count, 12), "dma copy lap: words after the lap lost");
+  check(ring.dropped_count() + 15 == dma.written, "dma copy lap: words neither returned nor dropped");
+}
+
+static void dma_wrap() {
+  //Starting eight words short, so the counts wrap partway through the second batch
+  DmaRing<16> ring(0xfffffff8);
+  FakeDma<16> dma{ring, 0xfffffff8};
+  auto written = [&]() { return dma.written; };
+  uint32_t items[32];
+  dma.write(5);
+  uint32_t count = ring.pop_batch(written, items, 32);
+  check(count == 5 && counted_from(items, count, 0xfffffff8), "dma wrap: words wrong before the wrap");
+
+  dma.write(11);
+  check(ring.size(dma.written) == 11, "dma wrap: size wrong across the count wrap");
+  count = ring.pop_batch(written, items, 4);
+  count += ring.pop_batch(written, items + count, 32);
+  check(count == 11 && counted_from(items, count, 0xfffffffd), "dma wrap: words missing or out of order across the count wrap");
+  check(ring.high_water_mark() == 11 && ring.dropped_count() == 0, "dma wrap: drops or high water mark wrong across the count wrap");
+
+  //Lapped just past the wrap, the mark stops at capacity
+  dma.write(20);
+  count = ring.pop_batch(written, items, 32);
+  check(count == 15 && counted_from(items, count, dma.written - 15), "dma wrap: overwritten words returned past the wrap");
+  check(ring.dropped_count() == 5 && ring.high_water_mark() == 16, "dma wrap: drops or high water mark wrong when lapped past the wrap");
+}
+
+//Pushes 1 to num_words, counting every push rejected and retrying them, or giving up on them
+static void produce(PulseRing<uint32_t, 256>& ring, uint32_t num_words, bool retry, uint32_t& rejected, uint32_t& lost) {
+  for(uint32_t i = 1; i <= num_words; i++) {
+    while(!ring.push(i)) {
+      rejected++;
+      if(!retry) {
+        lost++;
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+}
+
+static void threaded(uint32_t num_words, uint32_t batch, bool retry) {
+  PulseRing<uint32_t, 256> ring(NEAR_WRAP);
+
+  uint32_t rejected = 0, lost = 0;
+  std::atomic<bool> done{false};
+  auto start = std::chrono::steady_clock::now();
+  std::thread producer([&]() {
+    produce(ring, num_words, retry, rejected, lost);
+    done.store(true, std::memory_order_release);
+  });
+
+  std::vector<uint32_t> items(batch);
+  uint64_t received = 0, missing = 0, batches = 0;
+  uint32_t last = 0;
+  bool in_order = true;
+  while(true) {
+    bool finished = done.load(std::memory_order_acquire);
+    uint32_t count = ring.pop_batch(items.data(), batch);
+    for(uint32_t i = 0; i < count; i++) {
+      in_order = in_order && items[i] > last;
+      missing += items[i] - last - 1;
+      last = items[i];
+    }
+    received += count;
+    if(count > 0)
+      batches++;
+    else if(finished)
+      break;
+    else
+      std::this_thread::yield();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  producer.join();
+  missing += num_words - last;
+
+  const char* name = retry ? "lossless" : "dropping";
+  printf("# %s: %u words in %.3fs, %.1fns per word, %.1f words per batch, %u pushes rejected, %u words lost, high water %u\n",
+         name, num_words, seconds, seconds * 1e9 / num_words, batches > 0 ? (double)received / batches : 0.0, rejected, lost,
+         ring.high_water_mark());
+
+  char what[80];
+  snprintf(what, sizeof(what), "%s: words out of order or repeated", name);
+  check(in_order, what);
+  snprintf(what, sizeof(what), "%s: words missing that were not dropped", name);
+  check(missing == lost && received + lost == num_words, what);
+  snprintf(what, sizeof(what), "%s: dropped count is not the rejected pushes", name);
+  check(ring.dropped_count() == rejected, what);
+  snprintf(what, sizeof(what), "%s: high water mark above capacity", name);
+  check(ring.high_water_mark() <= ring.capacity(), what);
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t num_words = 10000000;
+  uint32_t batch = 32;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+      batch = (uint32_t)atoi(argv[++i]);
+    else
+      num_words = (uint32_t)atoi(argv[i]);
+  }
+  if(batch == 0 || num_words == 0) {
+    fprintf(stderr, "need at least one word and a batch of at least one\n");
+    return 1;
+  }
+
+  wrap();
+  full();
+  split();
+  high_water();
+  dma_lapped();
+  dma_copy_lap();
+  dma_wrap();
+  threaded(num_words, batch, true);
+  threaded(num_words, batch, false);
+
+  printf("# %s\n", failures == 0 ? "passed" : "FAILED");
+  return failures == 0 ? 0 : 1;
+}
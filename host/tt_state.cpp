@@ -0,0 +1,153 @@
+// Stress tests TrackerState with one writer publishing snapshots as fast as it can and
+// several readers copying them out at the same time, checking every copy is consistent,
+// and reports the throughput of each side.
+//
+// Usage: tt_state [ms] [--readers n] [--interval us]
+//   ms          how long to run for (default 1000)
+//   --readers   reader threads taking every snapshot they can (default 3)
+//   --interval  the interval of one more, decimated, subscriber (default 1000)
+//
+// Every field of a snapshot is derived from its sequence number, so a copy mixing two
+// snapshots is caught. Readers also check the sequence never goes backwards, and the
+// decimated subscriber that its snapshots are at least the interval apart. Snapshot
+// timestamps advance 1us per publish. Exits with 1 if any check fails
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "TrackerState.hpp"
+
+struct ReaderResult {
+  uint64_t snapshots = 0;
+  uint64_t torn = 0;
+  uint64_t backwards = 0;
+  uint64_t too_soon = 0;
+  uint32_t retries = 0;
+  uint32_t skipped = 0;
+};
+
+//Fills a snapshot whose every field follows from its sequence
+static void fill(TrackerSnapshot& snapshot, uint32_t sequence) {
+  snapshot.timestamp_us = sequence;
+  snapshot.station = sequence & 1;
+  snapshot.sensor_count = TrackerSnapshot::MAX_SENSORS;
+  snapshot.valid_mask = sequence * 2654435761u;
+  for(uint8_t s = 0; s < TrackerSnapshot::MAX_SENSORS; s++) {
+    snapshot.x_angle[s] = (int32_t)(sequence * 31 + s);
+    snapshot.y_angle[s] = ~snapshot.x_angle[s];
+    snapshot.sweep_us[s] = sequence - s;
+  }
+  snapshot.has_pose = true;
+  snapshot.pose_status = sequence & 3;
+  snapshot.pose_residual = (int32_t)(sequence ^ 0x5a5a5a5a);
+  for(uint8_t i = 0; i < 3; i++) {
+    snapshot.pose.position[i] = (int32_t)(sequence + i);
+    for(uint8_t j = 0; j < 3; j++)
+      snapshot.pose.rotation[i][j] = (int32_t)(sequence * 3 + i * 3 + j);
+  }
+}
+
+static bool consistent(const TrackerSnapshot& snapshot) {
+  TrackerSnapshot expected;
+  fill(expected, snapshot.timestamp_us);
+  return snapshot.sequence == snapshot.timestamp_us && snapshot.station == expected.station
+         && snapshot.sensor_count == expected.sensor_count && snapshot.valid_mask == expected.valid_mask
+         && snapshot.has_pose && snapshot.pose_status == expected.pose_status && snapshot.pose_residual == expected.pose_residual
+         && memcmp(snapshot.x_angle, expected.x_angle, sizeof(expected.x_angle)) == 0
+         && memcmp(snapshot.y_angle, expected.y_angle, sizeof(expected.y_angle)) == 0
+         && memcmp(snapshot.sweep_us, expected.sweep_us, sizeof(expected.sweep_us)) == 0
+         && memcmp(&snapshot.pose, &expected.pose, sizeof(expected.pose)) == 0;
+}
+
+static void read_all(const TrackerState& state, const std::atomic<bool>& running, ReaderResult& result) {
+  TrackerSnapshot snapshot;
+  uint32_t last = 0;
+  while(running.load(std::memory_order_relaxed)) {
+    if(!state.read(snapshot, &result.retries))
+      continue;
+    result.snapshots++;
+    if(!consistent(snapshot))
+      result.torn++;
+    if(snapshot.sequence < last)
+      result.backwards++;
+    last = snapshot.sequence;
+  }
+}
+
+static void subscribe(const TrackerState& state, uint32_t interval_us, const std::atomic<bool>& running, ReaderResult& result) {
+  StateSubscriber subscriber(state, interval_us);
+  TrackerSnapshot snapshot;
+  uint32_t last = 0;
+  while(running.load(std::memory_order_relaxed)) {
+    if(!subscriber.poll(snapshot))
+      continue;
+    if(!consistent(snapshot))
+      result.torn++;
+    if(snapshot.sequence <= last)
+      result.backwards++;
+    if(result.snapshots > 0 && snapshot.timestamp_us - last < interval_us)
+      result.too_soon++;
+    result.snapshots++;
+    last = snapshot.timestamp_us;
+  }
+  result.retries = subscriber.retry_count();
+  result.skipped = subscriber.skipped_count();
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t run_ms = 1000;
+  uint32_t num_readers = 3;
+  uint32_t interval_us = 1000;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--readers") == 0 && i + 1 < argc)
+      num_readers = (uint32_t)atoi(argv[++i]);
+    else if(strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+      interval_us = (uint32_t)atoi(argv[++i]);
+    else
+      run_ms = (uint32_t)atoi(argv[i]);
+  }
+
+  static TrackerState state;
+  std::atomic<bool> running{true};
+  std::vector<ReaderResult> results(num_readers + 1);
+  std::vector<std::thread> threads;
+  for(uint32_t r = 0; r < num_readers; r++)
+    threads.emplace_back(read_all, std::cref(state), std::cref(running), std::ref(results[r]));
+  threads.emplace_back(subscribe, std::cref(state), interval_us, std::cref(running), std::ref(results[num_readers]));
+
+  TrackerSnapshot snapshot;
+  uint32_t published = 0;
+  auto start = std::chrono::steady_clock::now();
+  auto end = start + std::chrono::milliseconds(run_ms);
+  while(std::chrono::steady_clock::now() < end) {
+    for(uint32_t i = 0; i < 1000; i++) {
+      fill(snapshot, ++published);
+      state.publish(snapshot);
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  running = false;
+  for(std::thread& thread : threads)
+    thread.join();
+
+  printf("# writer: %u snapshots, %.1fns per publish\n", published, seconds * 1e9 / published);
+  bool passed = published > 0;
+  for(uint32_t r = 0; r <= num_readers; r++) {
+    const ReaderResult& result = results[r];
+    if(r < num_readers)
+      printf("# reader %u: %llu snapshots, %.1fns per read, %u retries, %llu torn, %llu out of order\n", r,
+             (unsigned long long)result.snapshots, result.snapshots > 0 ? seconds * 1e9 / result.snapshots : 0.0, result.retries,
+             (unsigned long long)result.torn, (unsigned long long)result.backwards);
+    else
+      printf("# subscriber every %uus: %llu snapshots, %u skipped, %u retries, %llu torn, %llu out of order, %llu too soon\n",
+             interval_us, (unsigned long long)result.snapshots, result.skipped, result.retries,
+             (unsigned long long)result.torn, (unsigned long long)result.backwards, (unsigned long long)result.too_soon);
+    passed = passed && result.snapshots > 0 && result.torn == 0 && result.backwards == 0 && result.too_soon == 0;
+  }
+  printf("# %s\n", passed ? "passed" : "FAILED");
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// Decodes synthetic pulse trains from a lighthouse whose cycle period drifts, with and
+// without sync tracking, and reports how well each follows the sweeps, how much noise
+// gets through, and what the decoder costs per pulse.
+//
+// Usage: tt_sync [cycles] [--sensors n] [--drift ppm] [--jitter us] [--noise n] [--flashes n] [--station n]
+//   cycles      lighthouse cycles to generate (default 2000)
+//   --drift     how far the period drifts from 8333us over the run (default 2000ppm)
+//   --jitter    the largest error in each window's start time, as the CPU latch sees it (default 3)
+//   --noise     short stray pulses per sensor per cycle (default 0.5)
+//   --flashes   stray pulses per sensor per cycle long enough to open a window (default 0.01)
+//   --station   the station that sweeps, 0 or 1 (default 0). Station 1's sweeps are timed
+//               from its own sync, 400us into the window
+//
+// The words are built by SyntheticTrain the way lighthouse.pio would time them, windows
+// and all, and drained a batch per sensor at a time as the firmware does. Angles are
+// compared against the true sweep angle, 0 at the middle of the cycle and 180 degrees
+// per period. Exits with 1 if tracking fails to lock, follow the period, track the
+// angles to within MAX_TRACKED_RMS_DEG or beat the fixed decode
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+#include "SyntheticTrain.hpp"
+
+static const uint32_t SETTLE_CYCLES       = 100;    //Left out of the error summaries, while tracking locks
+static const double MAX_TRACKED_RMS_DEG   = 0.01;   //Well under the 8.6 degrees a sweep timed from the wrong sync is off by
+
+//The spread of a set of angle errors, in degrees
+struct ErrorSummary {
+  uint32_t count = 0;
+  double sum = 0;
+  double sum_sq = 0;
+
+  void add(double error) {
+    count++;
+    sum += error;
+    sum_sq += error * error;
+  }
+  double mean() const { return count > 0 ? sum / count : 0.0; }
+  double rms() const { return count > 0 ? sqrt(sum_sq / count) : 0.0; }
+};
+
+struct Result {
+  ErrorSummary error;
+  uint32_t noise_events = 0;
+  uint32_t missed_sweeps = 0;
+  int32_t lock_cycle = -1;
+  double max_period_error_us = 0;
+  DecodeCounts counts;
+};
+
+//Runs the train through a decoder and scores its events, which should all be from the sweeping station
+static Result decode(const SyntheticTrain& train, uint8_t station, bool tracking) {
+  PulseDecoder decoder(train.sensor_count());
+  decoder.set_sync_tracking(tracking);
+
+  Result result;
+  std::vector<uint32_t> hits(train.sensor_count(), 0);
+  train.decode(decoder, [&](uint8_t s, uint32_t first, uint32_t count, const SweepEvent* events, uint32_t num_events) {
+    for(uint32_t e = 0; e < num_events; e++) {
+      const SweepEvent& event = events[e];
+      if(event.type != SweepEvent::SWEEP)
+        continue;
+
+      //Match the event to the cycle it came from, then to that cycle's sweep by time
+      uint64_t time_ns = (uint64_t)event.timestamp_us * 1000;
+      int32_t c = train.cycle_at(time_ns);
+      if(c < 0)
+        continue;
+      if(event.station != station || fabs(time_ns - train.sweep_ns(s, c)) > 5000.0) {
+        result.noise_events++;
+        continue;
+      }
+      hits[s]++;
+      if(c >= (int32_t)SETTLE_CYCLES)
+        result.error.add(LighthouseTiming::mid2_to_angle(event.mid2) / 65536.0 - train.angle(s, c));
+    }
+
+    const SyncTracker& tracker = decoder.sync_tracker(station);
+    if(tracker.locked()) {
+      //Roughly the cycle just decoded, as few windows are opened by anything else
+      uint32_t cycle = std::min<uint32_t>(train.stream(s).windows_before[first + count - 1], train.cycle_count() - 1);
+      if(result.lock_cycle < 0)
+        result.lock_cycle = (int32_t)cycle;
+      double period_error = fabs(tracker.period() / 256.0 - train.period_ns(cycle) / 1000.0);
+      result.max_period_error_us = std::max(result.max_period_error_us, period_error);
+    }
+  });
+
+  for(uint8_t s = 0; s < train.sensor_count(); s++)
+    result.missed_sweeps += train.cycle_count() - hits[s];
+  result.counts = decoder.decode_counts();
+  return result;
+}
+
+//The decoder's own cost, over the whole train
+static double ns_per_word(const SyntheticTrain& train, bool tracking) {
+  PulseDecoder decoder(train.sensor_count());
+  decoder.set_sync_tracking(tracking);
+  auto start = std::chrono::steady_clock::now();
+  train.decode(decoder, [](uint8_t, uint32_t, uint32_t, const SweepEvent*, uint32_t) {});
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return seconds * 1e9 / train.total_words();
+}
+
+static void print_result(const char* name, const Result& result, double ns_per_word) {
+  printf("# %s: angle bias %.4f deg, rms %.4f deg over %u sweeps, %u sweeps missed, %u noise sweeps passed, %u rejected\n",
+         name, result.error.mean(), result.error.rms(), result.error.count, result.missed_sweeps, result.noise_events,
+         result.counts.rejected);
+  printf("# %s: %.1fns per word\n", name, ns_per_word);
+}
+
+int main(int argc, char* argv[]) {
+  SyntheticTrain::Settings settings;
+  settings.cycles = 2000;
+  settings.drift_ppm = 2000;
+  settings.noise = 0.5;
+  settings.flashes = 0.01;
+  uint32_t num_sensors = settings.sensors;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--sensors") == 0 && i + 1 < argc)
+      num_sensors = (uint32_t)atoi(argv[++i]);
+    else if(strcmp(argv[i], "--drift") == 0 && i + 1 < argc)
+      settings.drift_ppm = atof(argv[++i]);
+    else if(strcmp(argv[i], "--jitter") == 0 && i + 1 < argc)
+      settings.jitter_us = (uint32_t)atoi(argv[++i]);
+    else if(strcmp(argv[i], "--noise") == 0 && i + 1 < argc)
+      settings.noise = atof(argv[++i]);
+    else if(strcmp(argv[i], "--flashes") == 0 && i + 1 < argc)
+      settings.flashes = atof(argv[++i]);
+    else if(strcmp(argv[i], "--station") == 0 && i + 1 < argc)
+      settings.sweeping = (uint8_t)atoi(argv[++i]);
+    else
+      settings.cycles = (uint32_t)atoi(argv[i]);
+  }
+  if(num_sensors == 0 || num_sensors > PulseDecoder::MAX_SENSORS || settings.cycles <= SETTLE_CYCLES
+     || settings.sweeping >= PulseDecoder::NUM_STATIONS) {
+    fprintf(stderr, "need 1 to %u sensors, more than %u cycles and station 0 or 1\n", PulseDecoder::MAX_SENSORS, SETTLE_CYCLES);
+    return 1;
+  }
+
+  settings.sensors = (uint8_t)num_sensors;
+  SyntheticTrain train(settings);
+
+  Result fixed = decode(train, settings.sweeping, false);
+  Result tracked = decode(train, settings.sweeping, true);
+
+  printf("# %u cycles, %u sensors, station %u sweeping, period %u to %uns, %uus latch jitter\n", settings.cycles, num_sensors,
+         settings.sweeping, train.period_ns(0), train.period_ns(settings.cycles - 1), settings.jitter_us);
+  print_result("fixed", fixed, ns_per_word(train, false));
+  print_result("tracked", tracked, ns_per_word(train, true));
+  printf("# tracked: locked after %d cycles, period within %.3fus once locked\n", tracked.lock_cycle, tracked.max_period_error_us);
+
+  bool passed = tracked.lock_cycle >= 0 && tracked.lock_cycle < (int32_t)SETTLE_CYCLES && tracked.max_period_error_us < 1.0
+                && tracked.error.rms() < MAX_TRACKED_RMS_DEG && tracked.error.rms() < fixed.error.rms()
+                && tracked.noise_events <= fixed.noise_events;
+  printf("# %s\n", passed ? "passed" : "FAILED");
+  return passed ? 0 : 1;
+}
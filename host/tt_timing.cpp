@@ -0,0 +1,156 @@
+// Checks LighthouseTiming's integer decode against the float maths main() used before it,
+// over a sweep of pulse start and length pairs, and times the two.
+//
+// Usage: tt_timing [--start-step n] [--max-error deg]
+//   --start-step  the gap between the window offsets pulses are tried at (default 7)
+//   --max-error   the largest angle difference allowed, in degrees (default 0.001)
+//
+// The float path is the old one: counts * 15 * 0.008 for microseconds, * 48 less 2751 and
+// / 500 for the sync data, more than 50us for a C-sync and ((t - 4000) / 4000) * 90 for
+// the angle. Every length up to the longest sync is tried at each offset, and every
+// midpoint in the window is converted to an angle. The sync data and C-sync results must
+// agree exactly, apart from lengths the old code would give sync data outside 0 to 7 for,
+// where the integer decode holds it at 0 or 7. The angles differ most at the ends of the
+// window, as ANGLE_SCALE_Q16 is held to about 15 significant bits. Exits with 1 if any
+// check fails
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "LighthouseTiming.hpp"
+
+static const uint32_t MAX_COUNT     = 0xffff;
+static const uint32_t MAX_LENGTH    = 1500;     //Past the longest sync (about 1125 counts) and the C-sync threshold
+
+//The float path, as main() had it for each sensor
+static const float US_TO_LH_TICK = 48.0f;
+
+static inline float float_us(uint32_t counts) {
+  return (float)counts * 15.0f * 0.008f;
+}
+
+static inline int float_sync_data(uint32_t word) {
+  float length = float_us(LighthouseTiming::word_end(word)) - float_us(LighthouseTiming::word_start(word));
+  return (int)((length * US_TO_LH_TICK - 2751) / 500.0f);
+}
+
+static inline bool float_csync(uint32_t word) {
+  return float_us(LighthouseTiming::word_end(word)) - float_us(LighthouseTiming::word_start(word)) > 50.0f;
+}
+
+static inline float float_angle(uint32_t word) {
+  float mid = (float_us(LighthouseTiming::word_start(word)) + float_us(LighthouseTiming::word_end(word))) / 2.0f;
+  return ((mid - 4000.0f) / 4000.0f) * 90.0f;
+}
+
+static inline uint32_t make_word(uint32_t start, uint32_t end) {
+  return (start << 16) | end;
+}
+
+//Decodes every word with one path or the other, as the decoder would (tag, then angle for
+//sweeps), returning something from every word so none of it can be optimised away
+static uint64_t decode_float(const std::vector<uint32_t>& words) {
+  uint64_t sum = 0;
+  for(uint32_t word : words) {
+    if(LighthouseTiming::word_start(word) == 0 || float_csync(word))
+      sum += float_sync_data(word) & 0b111;
+    else
+      sum += (uint64_t)(int64_t)(float_angle(word) * 65536.0f);
+  }
+  return sum;
+}
+
+static uint64_t decode_fixed(const std::vector<uint32_t>& words) {
+  uint64_t sum = 0;
+  for(uint32_t word : words) {
+    uint32_t start = LighthouseTiming::word_start(word);
+    uint8_t tag = LighthouseTiming::pulse_tag(LighthouseTiming::word_end(word) - start);
+    if(start == 0 || (tag & LighthouseTiming::TAG_CSYNC))
+      sum += tag & LighthouseTiming::TAG_SYNC_DATA;
+    else
+      sum += (uint64_t)(int64_t)LighthouseTiming::mid2_to_angle(LighthouseTiming::word_mid2(word));
+  }
+  return sum;
+}
+
+static double ns_per_word(uint64_t (*decode)(const std::vector<uint32_t>&), const std::vector<uint32_t>& words, uint64_t& result) {
+  //The fastest of several runs, as the bench does
+  double best = 1e30;
+  for(uint32_t run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    result = decode(words);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if(seconds < best)
+      best = seconds;
+  }
+  return best * 1e9 / words.size();
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t start_step = 7;
+  double max_error = 0.001;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--start-step") == 0 && i + 1 < argc)
+      start_step = (uint32_t)atoi(argv[++i]);
+    else if(strcmp(argv[i], "--max-error") == 0 && i + 1 < argc)
+      max_error = atof(argv[++i]);
+  }
+  if(start_step == 0) {
+    fprintf(stderr, "the start step must be at least 1\n");
+    return 1;
+  }
+
+  //Sync data and C-syncs, for every length at a spread of offsets
+  uint64_t pairs = 0, sync_mismatches = 0, csync_mismatches = 0, clamped = 0;
+  std::vector<uint32_t> words;
+  for(uint32_t start = 0; start < MAX_COUNT; start += (start == 0) ? 1 : start_step) {
+    for(uint32_t length = 0; length <= MAX_LENGTH && start + length <= MAX_COUNT; length++) {
+      uint32_t word = make_word(start, start + length);
+      uint8_t tag = LighthouseTiming::pulse_tag(length);
+      pairs++;
+      words.push_back(word);
+
+      if(((tag & LighthouseTiming::TAG_CSYNC) != 0) != float_csync(word))
+        csync_mismatches++;
+
+      int expected = float_sync_data(word);
+      if(expected < 0 || expected > LighthouseTiming::MAX_SYNC_DATA) {
+        clamped++;
+        expected = (expected < 0) ? 0 : LighthouseTiming::MAX_SYNC_DATA;
+      }
+      if((tag & LighthouseTiming::TAG_SYNC_DATA) != expected)
+        sync_mismatches++;
+    }
+  }
+
+  //Angles, for every midpoint in the window
+  double worst_error = 0;
+  uint32_t worst_sum = 0;
+  for(uint32_t sum = 0; sum <= 2 * MAX_COUNT; sum++) {
+    uint32_t start = sum / 2;
+    uint32_t word = make_word(start, sum - start);
+    double error = fabs(LighthouseTiming::mid2_to_angle(LighthouseTiming::word_mid2(word)) / 65536.0 - float_angle(word));
+    if(error > worst_error) {
+      worst_error = error;
+      worst_sum = sum;
+    }
+  }
+
+  uint64_t float_result, fixed_result;
+  double float_ns = ns_per_word(decode_float, words, float_result);
+  double fixed_ns = ns_per_word(decode_fixed, words, fixed_result);
+
+  printf("# %llu start and length pairs: %llu sync data and %llu C-sync mismatches, %llu held at 0 or %u\n",
+         (unsigned long long)pairs, (unsigned long long)sync_mismatches, (unsigned long long)csync_mismatches,
+         (unsigned long long)clamped, LighthouseTiming::MAX_SYNC_DATA);
+  printf("# %u midpoints: largest angle difference %.6f deg, at start + end %u\n", 2 * MAX_COUNT + 1, worst_error, worst_sum);
+  printf("# float: %.2fns per word, fixed: %.2fns per word (%016llx, %016llx)\n", float_ns, fixed_ns,
+         (unsigned long long)float_result, (unsigned long long)fixed_result);
+
+  bool passed = sync_mismatches == 0 && csync_mismatches == 0 && worst_error <= max_error;
+  printf("# %s\n", passed ? "passed" : "FAILED");
+  return passed ? 0 : 1;
+}
@@ -6,6 +6,18 @@
 #include "lighthouse.pio.h"
 #include "simulated_lh.pio.h"
 #include "Sensor.hpp"
+#include "SensorGroup.hpp"
+#include "PulseDecoder.hpp"
+#include "LighthouseTiming.hpp"
+#include "CaptureCore.hpp"
+#include "PowerManager.hpp"
+#include "BinaryOutput.hpp"
+#include "PoseSolver.hpp"
+#include "SweepFilter.hpp"
+#include "TrackerLink.hpp"
+#include "LinkUart.hpp"
+#include "TrackerState.hpp"
+#include "tusb.h"
 #include "hardware/pwm.h"
 #include "math.h"
 
@@ -19,18 +31,267 @@ const uint SENSOR2_DBG = 3;
 const uint SENSOR3_DBG = 4;
 const uint SENSOR4_DBG = 6;
 
-static const uint16_t FREQ_DIVIDER            = 1; 
+static const uint16_t FREQ_DIVIDER            = LighthouseTiming::FREQ_DIVIDER;
+
+// how each sensor's words get from its state machine's FIFO into RAM: an interrupt per word,
+// or a DMA channel writing them into a ring that the main loop reads directly
+static const Sensor::CaptureMode CAPTURE_MODE = Sensor::CAPTURE_IRQ;
+
+// how finely each sensor's state machine times its pulses: every 15 cycles with lighthouse.pio,
+// or every 2 with lighthouse_hires.pio. Every sensor on a PIO must use the same one
+static const Sensor::Resolution CAPTURE_RESOLUTION = Sensor::RESOLUTION_STANDARD;
+
+Sensor sensor1(pio0, SENSOR1_PIN, SENSOR1_DBG, FREQ_DIVIDER, CAPTURE_MODE, CAPTURE_RESOLUTION);
+Sensor sensor2(pio0, SENSOR2_PIN, SENSOR2_DBG, FREQ_DIVIDER, CAPTURE_MODE, CAPTURE_RESOLUTION);
+Sensor sensor3(pio0, SENSOR3_PIN, SENSOR3_DBG, FREQ_DIVIDER, CAPTURE_MODE, CAPTURE_RESOLUTION);
+Sensor sensor4(pio0, SENSOR4_PIN, SENSOR4_DBG, FREQ_DIVIDER, CAPTURE_MODE, CAPTURE_RESOLUTION);
+
+Sensor* const sensors[] = { &sensor1, &sensor2, &sensor3, &sensor4 };
+static const uint8_t NUM_SENSORS = sizeof(sensors) / sizeof(sensors[0]);
+
+// read every sensor with one state machine running sensor_group.pio, instead of one state machine
+// per sensor. The group covers the block of pins from the first sensor to the last, and each
+// sensor's pulses come from the channel of its pin
+static const bool SENSOR_GROUP_ENABLED       = false;
+
+SensorGroup sensor_group(pio0, SENSOR1_PIN, SENSOR4_PIN - SENSOR1_PIN + 1, FREQ_DIVIDER);
+const uint8_t GROUP_CHANNELS[] = { SENSOR1_PIN - SENSOR1_PIN, SENSOR2_PIN - SENSOR1_PIN,
+                                   SENSOR3_PIN - SENSOR1_PIN, SENSOR4_PIN - SENSOR1_PIN };
+static_assert(sizeof(GROUP_CHANNELS) / sizeof(GROUP_CHANNELS[0]) == NUM_SENSORS, "Need a group channel for every sensor");
+
+// where the pipeline drains each sensor's pulse words from
+PulseSource* const sources[] = {
+  SENSOR_GROUP_ENABLED ? sensor_group.channel(GROUP_CHANNELS[0]) : sensors[0],
+  SENSOR_GROUP_ENABLED ? sensor_group.channel(GROUP_CHANNELS[1]) : sensors[1],
+  SENSOR_GROUP_ENABLED ? sensor_group.channel(GROUP_CHANNELS[2]) : sensors[2],
+  SENSOR_GROUP_ENABLED ? sensor_group.channel(GROUP_CHANNELS[3]) : sensors[3],
+};
+static_assert(sizeof(sources) / sizeof(sources[0]) == NUM_SENSORS, "Need a source for every sensor");
+
+// only use a sweep if it is longer than any before it in its window, to drop dimmer reflections
+static const bool REJECT_REFLECTIONS_ENABLED = false;
+
+// phase-lock to each lighthouse's syncs, dropping pulses that arrive where none should be and
+// scaling sweep angles by the measured cycle period rather than the fixed constants
+static const bool SYNC_TRACKING_ENABLED      = false;
+
+// run the sensor interrupts and decoding on core1, leaving core0 for output
+static const bool DUAL_CORE_ENABLED          = false;
+
+// sleep between pulses instead of busy-polling (on both cores with DUAL_CORE_ENABLED), woken by the
+// capture interrupts or after at most LOW_POWER_MAX_SLEEP_US (which is also how often DMA capture
+// gets drained). With no pulses for
+// LIGHTHOUSE_LOST_MS, clk_sys is also divided by LOST_CLOCK_DIVIDER until a sensor pin rises again.
+// A divider of 1 keeps the full clock
+static const bool LOW_POWER_ENABLED          = false;
+static const uint32_t LOW_POWER_MAX_SLEEP_US = 1000;
+static const uint32_t LIGHTHOUSE_LOST_MS     = 2000;
+static const uint8_t LOST_CLOCK_DIVIDER      = 8;
+
+PowerManager power((1u << SENSOR1_PIN) | (1u << SENSOR2_PIN) | (1u << SENSOR3_PIN) | (1u << SENSOR4_PIN),
+                   LIGHTHOUSE_LOST_MS, LOST_CLOCK_DIVIDER);
+
+// how often to report pipeline statistics, as '#' prefixed lines or a stats frame with binary output.
+// 0 disables the periodic report, but sending 's' asks for one at any time. The hot-path parts
+// (see TrackerStats.hpp) are compiled out by building with TT_STATS_ENABLED=0
+static const uint32_t PIPELINE_STATS_INTERVAL_MS = 0;
+
+// how often to look for an 's' on stdio, as each poll goes through every stdio driver
+static const uint32_t STATS_REQUEST_POLL_MS      = 100;
+
+CaptureCore capture(sources, NUM_SENSORS);
+
+// cycles spent decoding each batch of words and sending each sample, when decoding on this core
+CycleHistogram decode_cycles;
+CycleHistogram output_cycles;
+
+// send angles as COBS framed binary (see FrameCodec.hpp) instead of printf text
+static const bool BINARY_OUTPUT_ENABLED      = false;
+
+// non-blocking write to the usb serial port, taking only what fits in its buffer
+static uint32_t usb_write(const uint8_t* data, uint32_t length) {
+  if(!tud_cdc_connected()) {
+    return length; // nobody listening, so just discard it
+  }
+
+  uint32_t available = tud_cdc_write_available();
+  if(length > available) {
+    length = available;
+  }
+  if(length > 0) {
+    length = tud_cdc_write(data, length);
+    tud_cdc_write_flush();
+  }
+  return length;
+}
+
+BinaryOutput binary_output(usb_write);
 
-Sensor sensor1(pio0, SENSOR1_PIN, SENSOR1_DBG, FREQ_DIVIDER);
-Sensor sensor2(pio0, SENSOR2_PIN, SENSOR2_DBG, FREQ_DIVIDER);
-Sensor sensor3(pio0, SENSOR3_PIN, SENSOR3_DBG, FREQ_DIVIDER);
-Sensor sensor4(pio0, SENSOR4_PIN, SENSOR4_DBG, FREQ_DIVIDER);
+// stream the raw pulse words from every sensor instead of angles, for recording with host/tt_capture
+// and replaying with host/tt_replay. Uses the single core loop, so the words are seen where they are drained
+static const bool RAW_CAPTURE_ENABLED        = false;
+static_assert(!(RAW_CAPTURE_ENABLED && DUAL_CORE_ENABLED), "Raw capture needs the single core loop");
+
+FrameCodec::CaptureFrame capture_frame;
+uint32_t capture_dropped = 0;
+
+// queue the pending capture frame, if the link has room for it
+static bool send_capture() {
+  if(capture_frame.count == 0) {
+    return true;
+  }
+
+  capture_frame.header.sensor_count = NUM_SENSORS;
+  capture_frame.dropped = capture_dropped > UINT16_MAX ? UINT16_MAX : capture_dropped;
+  capture_frame.high_resolution = 0;
+  for(uint8_t s = 0; s < NUM_SENSORS; s++) {
+    if(sources[s]->high_resolution()) {
+      capture_frame.high_resolution |= 1u << s;
+    }
+  }
+  if(!binary_output.submit_capture(capture_frame)) {
+    return false;
+  }
+  capture_frame.count = 0;
+  capture_dropped = 0;
+  return true;
+}
+
+// add a sensor's drained words to the capture stream, counting any the link has no room for.
+// Window-opening words carry how long before now their window opened, so replays see the latched times
+static void capture_words(uint8_t sensor, const uint32_t* words, uint32_t count, uint32_t now, const uint32_t* window_starts) {
+  uint32_t windows = 0;
+  for(uint32_t i = 0; i < count; i++) {
+    uint32_t word = words[i];
+    uint8_t flags = 0;
+    if(LighthouseTiming::word_start(word) == 0) {
+      word = FrameCodec::capture_window_word(word, now - window_starts[windows++]);
+      flags = FrameCodec::CAPTURE_WINDOW;
+    }
+
+    if(capture_frame.count == FrameCodec::CAPTURE_MAX_RECORDS && !send_capture()) {
+      capture_dropped++;
+      continue;
+    }
+
+    if(capture_frame.count == 0) {
+      capture_frame.header.timestamp_us = now;
+    }
+    uint32_t offset = now - capture_frame.header.timestamp_us;
+    uint8_t r = capture_frame.count++;
+    capture_frame.sensor[r] = sensor | flags;
+    capture_frame.offset_us[r] = offset > UINT16_MAX ? UINT16_MAX : offset;
+    capture_frame.word[r] = word;
+  }
+}
+
+// gather the hot-path statistics from every stage
+static void fill_stats(FrameCodec::StatsFrame& frame, const DecodeCounts& decode, const CycleHistogram& decode_histogram) {
+  const IrqProfiler& irq_profile = SENSOR_GROUP_ENABLED ? SensorGroup::irq_profile : Sensor::irq_profile;
+  const CycleHistogram* stages[FrameCodec::NUM_STAGES] = { &irq_profile.cycles(), &decode_histogram, &output_cycles };
+
+  frame.header.sensor_count = NUM_SENSORS;
+  frame.header.timestamp_us = time_us_32();
+  frame.capture_pulses = irq_profile.pulses();
+  for(uint8_t st = 0; st < FrameCodec::NUM_STAGES; st++) {
+    frame.stage_count[st] = stages[st]->count();
+    frame.stage_max[st] = stages[st]->max();
+    for(uint8_t b = 0; b < CycleHistogram::NUM_BUCKETS; b++) {
+      frame.stage_buckets[st][b] = stages[st]->bucket(b);
+    }
+  }
+  frame.decode = decode;
+  for(uint8_t s = 0; s < NUM_SENSORS; s++) {
+    uint32_t high_water = sources[s]->high_water();
+    uint32_t dropped = sources[s]->dropped_pulses();
+    uint32_t overwritten = sources[s]->overwritten_pulses();
+    frame.high_water[s] = high_water > UINT16_MAX ? UINT16_MAX : high_water;
+    frame.dropped[s] = dropped > UINT16_MAX ? UINT16_MAX : dropped;
+    frame.overwritten[s] = overwritten > UINT16_MAX ? UINT16_MAX : overwritten;
+  }
+}
+
+// print the statistics as '#' prefixed lines, one per stage and one per sensor
+static void print_stats(const FrameCodec::StatsFrame& frame) {
+  static const char* const STAGE_NAMES[FrameCodec::NUM_STAGES] = { "capture irq", "decode", "output" };
+  for(uint8_t st = 0; st < FrameCodec::NUM_STAGES; st++) {
+    printf("# %s: %lu, max %lu cycles, histogram", STAGE_NAMES[st], frame.stage_count[st], frame.stage_max[st]);
+    for(uint8_t b = 0; b < CycleHistogram::NUM_BUCKETS; b++) {
+      printf(" %lu", frame.stage_buckets[st][b]);
+    }
+    printf("\n");
+  }
+  printf("# pulses %lu, syncs %lu, csyncs %lu, sweeps %lu, rejected %lu, replaced %lu\n", frame.capture_pulses,
+         frame.decode.syncs, frame.decode.csyncs, frame.decode.sweeps, frame.decode.rejected, frame.decode.replaced);
+  for(uint8_t s = 0; s < NUM_SENSORS; s++) {
+    printf("# sensor %u: high water %u, dropped %u, overwritten %u\n", s, frame.high_water[s], frame.dropped[s], frame.overwritten[s]);
+  }
+}
+
+// chain several trackers over uart0 (see TrackerLink.hpp), each board's TX to the next one's RX and
+// the last back to the first. Tracker 0 is the aggregator, and outputs all LINK_TRACKERS * NUM_SENSORS
+// sensors in its own clock, numbered tracker by tracker. The others send their sweeps on and need no
+// USB. The link takes the only UART pins left free by the sensors, so stdio is USB only
+static const bool LINK_ENABLED               = false;
+static const uint8_t LINK_TRACKER_ID         = TrackerLink::AGGREGATOR_ID;
+static const uint8_t LINK_TRACKERS           = 2;
+static const uint LINK_TX_PIN                = 28;
+static const uint LINK_RX_PIN                = 29;
+static const uint32_t LINK_BAUD              = 921600;
+
+static const bool LINK_AGGREGATOR            = LINK_ENABLED && LINK_TRACKER_ID == TrackerLink::AGGREGATOR_ID;
+static const uint8_t OUTPUT_SENSORS          = LINK_AGGREGATOR ? LINK_TRACKERS * NUM_SENSORS : NUM_SENSORS;
+static_assert(LINK_TRACKERS <= TrackerLink::MAX_TRACKERS && OUTPUT_SENSORS <= PulseDecoder::MAX_SENSORS, "Too many linked sensors");
+
+LinkUart link_uart(uart0, LINK_TX_PIN, LINK_RX_PIN, LINK_BAUD);
+TrackerLink tracker_link(link_uart, LINK_TRACKER_ID, NUM_SENSORS, LINK_BAUD);
+
+// solve the tracker's 6-DoF pose on the board from the sensor angles
+static const bool POSE_ENABLED               = false;
+
+// where each sensor sits on the tracker, in micrometres from its centre (x right,
+// y up, z towards the lighthouse when facing it). Measure these for your build. An
+// aggregator also needs the linked trackers' sensors after its own, in the same frame
+static const int32_t SENSOR_POSITIONS_UM[][3] = {
+  { -10000, -10000, 0 },
+  {  10000, -10000, 0 },
+  {  10000,  10000, 0 },
+  { -10000,  10000, 0 },
+};
+static_assert(sizeof(SENSOR_POSITIONS_UM) / sizeof(SENSOR_POSITIONS_UM[0]) == OUTPUT_SENSORS, "Need a position for every sensor");
+
+// each lighthouse gets its own pose, as each is a separate frame of reference
+PoseSolver pose_solvers[PulseDecoder::NUM_STATIONS];
+uint32_t pose_max_cycles = 0;
+uint32_t pose_overruns = 0;
+
+// predict angles between sweeps and output them at a fixed rate, rather than once per sweep pair
+static const bool FILTER_ENABLED             = false;
+static const uint32_t FILTER_OUTPUT_HZ       = 250;
+
+SweepFilter filters[PulseDecoder::NUM_STATIONS] = {
+  SweepFilter(OUTPUT_SENSORS, 1000000 / FILTER_OUTPUT_HZ),
+  SweepFilter(OUTPUT_SENSORS, 1000000 / FILTER_OUTPUT_HZ),
+};
+
+// correct the angles with each lighthouse's factory calibration, once it has been received over OOTX
+static const bool CALIBRATION_ENABLED        = false;
+
+// every output sample is published as the tracker's latest state, for anything that wants it
+// at its own pace. Kept off the stack, as each snapshot is over 400 bytes
+TrackerState tracker_state;
+TrackerSnapshot output_snapshot;
+uint32_t sweep_times[PulseDecoder::NUM_STATIONS][OUTPUT_SENSORS];
+static_assert(OUTPUT_SENSORS <= TrackerSnapshot::MAX_SENSORS, "Too many sensors for a snapshot");
+
+// how often the led follows the first sensor's angles, taken from the published state
+static const uint32_t LED_UPDATE_HZ          = 50;
+StateSubscriber led_state(tracker_state, 1000000 / LED_UPDATE_HZ);
+TrackerSnapshot led_snapshot;
 
 static const bool SIMULATED_OUT_ENABLED      = false;
 const uint SIMULATED_OUT_PIN = 6;
 
-static constexpr float US_TO_LH_TICK = 48.0f;
-
 void set_led(uint8_t r, uint8_t g, uint8_t b) {
   // gamma correct the provided 0-255 brightness value onto a
   // 0-65535 range for the pwm counter
@@ -51,9 +312,20 @@ void set_led(uint8_t r, uint8_t g, uint8_t b) {
   pwm_set_gpio_level(TINY2040_LED_B_PIN, value);
 }
 
+static inline float q16_to_float(int32_t value) {
+  return (float)value * (1.0f / 65536.0f);
+}
+
+// map an angle onto the led brightness, 127 at the centre of the sweep and
+// changing by one every 22us of sweep time (about 2 per degree)
+static inline uint8_t angle_to_led(int32_t angle) {
+  return (uint8_t)(127 + (int32_t)(((int64_t)angle * 200) / (99 << LighthouseTiming::ANGLE_FRACTION_BITS)));
+}
+
 int main() {
 
   stdio_init_all();
+  IrqProfiler::begin();
 
   //sleep_ms(10000);
 
@@ -90,10 +362,17 @@ int main() {
 
   set_led(127, 127, 255);
 
-  sensor1.init();
-  sensor2.init();
-  sensor3.init();
-  sensor4.init();
+  if(DUAL_CORE_ENABLED) {
+    capture.set_reject_reflections(REJECT_REFLECTIONS_ENABLED);
+    capture.set_sync_tracking(SYNC_TRACKING_ENABLED);
+    capture.set_low_power(LOW_POWER_ENABLED ? LOW_POWER_MAX_SLEEP_US : 0);
+    capture.launch();
+  }
+  else {
+    for(uint8_t s = 0; s < NUM_SENSORS; s++) {
+      sources[s]->init();
+    }
+  }
 
   if(SIMULATED_OUT_ENABLED) {
       //Set up the quadrature encoder output
@@ -103,221 +382,314 @@ int main() {
       simulated_lh_out_program_init(pio, sm, offset, SIMULATED_OUT_PIN);
   }
 
-  
-  int lastAxis[4] = { 0, 0, 0, 0 };
-  int lastData[4] = { 0, 0, 0, 0 };
-  int lastSkip[4] = { 0, 0, 0, 0 };
+  if(LOW_POWER_ENABLED) {
+    power.init();
+  }
+
+  // after power.init(), which sets the default uart's baud rate
+  if(LINK_ENABLED) {
+    link_uart.init();
+  }
+
 
-  float lastX[4] = { 0, 0, 0, 0 };
-  float lastY[4] = { 0, 0, 0, 0 };
+  PulseDecoder decoder(OUTPUT_SENSORS);
+  for(uint8_t s = 0; s < NUM_SENSORS; s++) {
+    decoder.set_high_resolution(s, sources[s]->high_resolution());
+  }
+  decoder.set_reject_reflections(REJECT_REFLECTIONS_ENABLED);
+  decoder.set_sync_tracking(SYNC_TRACKING_ENABLED);
+  for(uint8_t st = 0; st < PulseDecoder::NUM_STATIONS; st++) {
+    pose_solvers[st].set_geometry_um(SENSOR_POSITIONS_UM, OUTPUT_SENSORS);
+  }
+  SweepEvent events[CaptureCore::QUEUE_CAPACITY];
+  uint32_t words[PulseDecoder::DRAIN_BATCH];
+  uint32_t window_starts[PulseDecoder::DRAIN_BATCH];
+  static_assert(NUM_SENSORS * PulseDecoder::DRAIN_BATCH <= CaptureCore::QUEUE_CAPACITY, "Event buffer too small for one drain");
 
-  bool newData[4] = { false, false, false, false };
+  PipelineStats stats;
+  uint32_t last_drain = time_us_32();
+  uint32_t last_stats = to_ms_since_boot(get_absolute_time());
+  uint32_t last_request_poll = last_stats;
+  bool stats_pending = false;
 
   while (1) {
-    //gpio_put(LED_PIN, !PICO_DEFAULT_LED_PIN_INVERTED);
-    //sleep_ms(250);
-    //gpio_put(LED_PIN, PICO_DEFAULT_LED_PIN_INVERTED);
-    //puts("Hello World\n");
-    //sleep_ms(1000);
-
-    uint32_t bufferCount;
-
-    uint32_t received = sensor1.get_received(bufferCount);
-    if(received > 0) {
-      uint32_t istart = (received & 0xffff0000) >> 16;
-      uint32_t iend = (received & 0xffff);
-      float start = (float)((received & 0xffff0000) >> 16) * 15.0f * 0.008f;
-      float end = (float)(received & 0xffff) * 15.0f * 0.008f;
-      uint32_t ilength = iend - istart;
-      float length = end - start;
-      float tick_length = length * US_TO_LH_TICK;
-
-      if(istart == 0) {
-        int sync_data = (int)((tick_length - 2751) / 500.0f);
-        lastAxis[0] = sync_data & 0b001;
-        lastData[0] = (sync_data & 0b010) >> 1;
-        lastSkip[0] = (sync_data & 0b100) >> 2;
-        //printf("\n[%d] B-Sync = %.1fuS (%d)", bufferCount, end, iend);
-        //printf("\nB-Sync = %.1fuS (%d) [%d %d %d]", end, iend, lastAxis, lastData, lastSkip);        
-      }
-      else {        
-        if(length > 50.0f) {
-          int sync_data = (int)((tick_length - 2751) / 500.0f);
-          lastAxis[0] = sync_data & 0b001;
-          //printf("\t[%d] C-Sync @ %.1fuS (%d) = %.1fuS (%d)", bufferCount, start, istart, length, ilength);
-          //printf("\tC-Sync @ %.1fuS (%d) = %.1fuS (%d) [%d]", start, istart, length, ilength, sync_data);
-        }
-        else {
-          //printf("\t[%d] Sweep @ %.1fuS (%d) = %.1fuS (%d)", bufferCount, start, istart, length, ilength);
-          if(lastAxis[0]) {
-            //printf("\tSweep Y @ %.1fuS (%d) = %.1fuS (%d)", start, istart, length, ilength);
-            lastY[0] = (start + end) / 2.0f;
-            newData[0] = true;
-          }
-          else {
-            //printf("\tSweep X @ %.1fuS (%d) = %.1fuS (%d)", start, istart, length, ilength);
-            lastX[0] = (start + end) / 2.0f;
-          }
-        }
-      }
+    if(LOW_POWER_ENABLED) {
+      power.take();
     }
 
-    received = sensor2.get_received(bufferCount);
-    if(received > 0) {
-      uint32_t istart = (received & 0xffff0000) >> 16;
-      uint32_t iend = (received & 0xffff);
-      float start = (float)((received & 0xffff0000) >> 16) * 15.0f * 0.008f;
-      float end = (float)(received & 0xffff) * 15.0f * 0.008f;
-      uint32_t ilength = iend - istart;
-      float length = end - start;
-      float tick_length = length * US_TO_LH_TICK;
-
-      if(istart == 0) {
-        int sync_data = (int)((tick_length - 2751) / 500.0f);
-        lastAxis[1] = sync_data & 0b001;
-        lastData[1] = (sync_data & 0b010) >> 1;
-        lastSkip[1] = (sync_data & 0b100) >> 2;
-        //printf("\n[%d] B-Sync = %.1fuS (%d)", bufferCount, end, iend);
-        //printf("\nB-Sync = %.1fuS (%d) [%d %d %d]", end, iend, lastAxis, lastData, lastSkip);        
+    uint32_t count = 0;
+    uint32_t drained = 0;
+    if(DUAL_CORE_ENABLED) {
+      count = capture.receive(events, CaptureCore::QUEUE_CAPACITY);
+      for(uint32_t e = 0; e < count; e++) {
+        decoder.apply(events[e]);
       }
-      else {        
-        if(length > 50.0f) {
-          int sync_data = (int)((tick_length - 2751) / 500.0f);
-          lastAxis[1] = sync_data & 0b001;
-          //printf("\t[%d] C-Sync @ %.1fuS (%d) = %.1fuS (%d)", bufferCount, start, istart, length, ilength);
-          //printf("\tC-Sync @ %.1fuS (%d) = %.1fuS (%d) [%d]", start, istart, length, ilength, sync_data);
+      drained = count;
+    }
+    else {
+      uint32_t now = time_us_32();
+      for(uint8_t s = 0; s < NUM_SENSORS; s++) {
+        uint32_t num_words = sources[s]->get_received_batch(words, PulseDecoder::DRAIN_BATCH, window_starts);
+        if(RAW_CAPTURE_ENABLED) {
+          capture_words(s, words, num_words, now, window_starts);
         }
-        else {
-          //printf("\t[%d] Sweep @ %.1fuS (%d) = %.1fuS (%d)", bufferCount, start, istart, length, ilength);
-          if(lastAxis[1]) {
-            //printf("\tSweep Y @ %.1fuS (%d) = %.1fuS (%d)", start, istart, length, ilength);
-            lastY[1] = (start + end) / 2.0f;
-            newData[1] = true;
-          }
-          else {
-            //printf("\tSweep X @ %.1fuS (%d) = %.1fuS (%d)", start, istart, length, ilength);
-            lastX[1] = (start + end) / 2.0f;
-          }
+        uint32_t decode_start = IrqProfiler::now();
+        uint32_t num_events = decoder.process(s, words, num_words, events + count, window_starts);
+        if(TrackerStats::ENABLED && num_words > 0) {
+          decode_cycles.record(IrqProfiler::elapsed(decode_start));
         }
+        count += num_events;
+        drained += num_words;
       }
+
+      if(now - last_drain > stats.max_drain_gap_us)
+        stats.max_drain_gap_us = now - last_drain;
+      last_drain = now;
     }
 
-    received = sensor3.get_received(bufferCount);
-    if(received > 0) {
-      uint32_t istart = (received & 0xffff0000) >> 16;
-      uint32_t iend = (received & 0xffff);
-      float start = (float)((received & 0xffff0000) >> 16) * 15.0f * 0.008f;
-      float end = (float)(received & 0xffff) * 15.0f * 0.008f;
-      uint32_t ilength = iend - istart;
-      float length = end - start;
-      float tick_length = length * US_TO_LH_TICK;
-
-      if(istart == 0) {
-        int sync_data = (int)((tick_length - 2751) / 500.0f);
-        lastAxis[2] = sync_data & 0b001;
-        lastData[2] = (sync_data & 0b010) >> 1;
-        lastSkip[2] = (sync_data & 0b100) >> 2;
-        //printf("\n[%d] B-Sync = %.1fuS (%d)", bufferCount, end, iend);
-        //printf("\nB-Sync = %.1fuS (%d) [%d %d %d]", end, iend, lastAxis, lastData, lastSkip);        
+    // followers send their sweeps on, and the aggregator adds everyone else's to its own
+    if(LINK_ENABLED) {
+      if(!LINK_AGGREGATOR) {
+        tracker_link.send(events, count);
       }
-      else {        
-        if(length > 50.0f) {
-          int sync_data = (int)((tick_length - 2751) / 500.0f);
-          lastAxis[2] = sync_data & 0b001;
-          //printf("\t[%d] C-Sync @ %.1fuS (%d) = %.1fuS (%d)", bufferCount, start, istart, length, ilength);
-          //printf("\tC-Sync @ %.1fuS (%d) = %.1fuS (%d) [%d]", start, istart, length, ilength, sync_data);
-        }
-        else {
-          //printf("\t[%d] Sweep @ %.1fuS (%d) = %.1fuS (%d)", bufferCount, start, istart, length, ilength);
-          if(lastAxis[2]) {
-            //printf("\tSweep Y @ %.1fuS (%d) = %.1fuS (%d)", start, istart, length, ilength);
-            lastY[2] = (start + end) / 2.0f;
-            newData[2] = true;
-          }
-          else {
-            //printf("\tSweep X @ %.1fuS (%d) = %.1fuS (%d)", start, istart, length, ilength);
-            lastX[2] = (start + end) / 2.0f;
-          }
+      tracker_link.service();
+      if(LINK_AGGREGATOR) {
+        uint32_t linked = tracker_link.take(events + count, CaptureCore::QUEUE_CAPACITY - count);
+        for(uint32_t e = count; e < count + linked; e++) {
+          decoder.apply(events[e]);
         }
+        count += linked;
+        drained += linked;
       }
     }
 
-    received = sensor4.get_received(bufferCount);
-    if(received > 0) {
-      uint32_t istart = (received & 0xffff0000) >> 16;
-      uint32_t iend = (received & 0xffff);
-      float start = (float)((received & 0xffff0000) >> 16) * 15.0f * 0.008f;
-      float end = (float)(received & 0xffff) * 15.0f * 0.008f;
-      uint32_t ilength = iend - istart;
-      float length = end - start;
-      float tick_length = length * US_TO_LH_TICK;
-
-      if(istart == 0) {
-        int sync_data = (int)((tick_length - 2751) / 500.0f);
-        lastAxis[3] = sync_data & 0b001;
-        lastData[3] = (sync_data & 0b010) >> 1;
-        lastSkip[3] = (sync_data & 0b100) >> 2;
-        //printf("\n[%d] B-Sync = %.1fuS (%d)", bufferCount, end, iend);
-        //printf("\nB-Sync = %.1fuS (%d) [%d %d %d]", end, iend, lastAxis, lastData, lastSkip);        
-      }
-      else {        
-        if(length > 50.0f) {
-          int sync_data = (int)((tick_length - 2751) / 500.0f);
-          lastAxis[3] = sync_data & 0b001;
-          //printf("\t[%d] C-Sync @ %.1fuS (%d) = %.1fuS (%d)", bufferCount, start, istart, length, ilength);
-          //printf("\tC-Sync @ %.1fuS (%d) = %.1fuS (%d) [%d]", start, istart, length, ilength, sync_data);
+    // note when each sensor last finished a sweep pair, and feed the filters
+    for(uint32_t e = 0; e < count; e++) {
+      const SweepEvent& event = events[e];
+      if(event.type == SweepEvent::SWEEP) {
+        if(event.axis == 1) {
+          sweep_times[event.station][event.sensor] = event.timestamp_us;
         }
-        else {
-          //printf("\t[%d] Sweep @ %.1fuS (%d) = %.1fuS (%d)", bufferCount, start, istart, length, ilength);
-          if(lastAxis[3]) {
-            //printf("\tSweep Y @ %.1fuS (%d) = %.1fuS (%d)", start, istart, length, ilength);
-            lastY[3] = (start + end) / 2.0f;
-            newData[3] = true;
-          }
-          else {
-            //printf("\tSweep X @ %.1fuS (%d) = %.1fuS (%d)", start, istart, length, ilength);
-            lastX[3] = (start + end) / 2.0f;
-          }
+        if(FILTER_ENABLED) {
+          filters[event.station].update(event.sensor, event.axis, LighthouseTiming::mid2_to_angle(event.mid2), event.timestamp_us);
         }
       }
     }
 
-    // if(Sensor::millis() - sensor1.last_on_time() < 20) {
+    // if(time_us_32() - sensor1.last_on_time() < 20000) {
     //   gpio_put(TINY2040_LED_R_PIN, !PICO_DEFAULT_LED_PIN_INVERTED);
     // }
     // else {
     //   gpio_put(TINY2040_LED_R_PIN, PICO_DEFAULT_LED_PIN_INVERTED);
     // }
 
-    // if(Sensor::millis() - sensor2.last_on_time() < 20) {
+    // if(time_us_32() - sensor2.last_on_time() < 20000) {
     //   gpio_put(TINY2040_LED_G_PIN, !PICO_DEFAULT_LED_PIN_INVERTED);
     // }
     // else {
     //   gpio_put(TINY2040_LED_G_PIN, PICO_DEFAULT_LED_PIN_INVERTED);
     // }l
 
-    // if(Sensor::millis() - sensor3.last_on_time() < 20) {
+    // if(time_us_32() - sensor3.last_on_time() < 20000) {
     //   gpio_put(TINY2040_LED_B_PIN, !PICO_DEFAULT_LED_PIN_INVERTED);
     // }
     // else {
     //   gpio_put(TINY2040_LED_B_PIN, PICO_DEFAULT_LED_PIN_INVERTED);
     // }
-    if(newData[0] || newData[1] || newData[2] || newData[3]) {
-      float xAngle1 = ((lastX[0] - 4000.0f) / 4000.0f) * 90.0f;
-      float yAngle1 = ((lastY[0] - 4000.0f) / 4000.0f) * 90.0f;
-      float xAngle2 = ((lastX[1] - 4000.0f) / 4000.0f) * 90.0f;
-      float yAngle2 = ((lastY[1] - 4000.0f) / 4000.0f) * 90.0f;
-      float xAngle3 = ((lastX[2] - 4000.0f) / 4000.0f) * 90.0f;
-      float yAngle3 = ((lastY[2] - 4000.0f) / 4000.0f) * 90.0f;
-      float xAngle4 = ((lastX[3] - 4000.0f) / 4000.0f) * 90.0f;
-      float yAngle4 = ((lastY[3] - 4000.0f) / 4000.0f) * 90.0f;
-      printf("%f, %f, %f, %f, %f, %f, %f, %f\n", xAngle1, yAngle1, xAngle2, yAngle2, xAngle3, yAngle3, xAngle4, yAngle4);
-      
-      set_led(((lastX[0] - 4000.0f) / 22) + 127.0f, ((lastY[0] - 4000.0f) / 22) + 127.0f, 255.0f);
-      newData[0] = false;
-      newData[1] = false;
-      newData[2] = false;
-      newData[3] = false;
+
+    // either sample the filter's predictions at a fixed rate, or output each completed sweep pair,
+    // separately for each lighthouse
+    for(uint8_t st = 0; st < PulseDecoder::NUM_STATIONS; st++) {
+      SweepFilter& filter = filters[st];
+      PoseSolver& pose_solver = pose_solvers[st];
+
+      bool sample_ready = false;
+      uint32_t sample_time = time_us_32();
+      uint32_t valid_mask = 0;
+      int32_t x_angles[OUTPUT_SENSORS];
+      int32_t y_angles[OUTPUT_SENSORS];
+      if(FILTER_ENABLED) {
+        if(filter.output_due(sample_time)) {
+          valid_mask = filter.valid_mask(sample_time);
+          sample_ready = (valid_mask != 0);
+          for(uint8_t s = 0; s < OUTPUT_SENSORS; s++) {
+            x_angles[s] = filter.predict(s, 0, sample_time);
+            y_angles[s] = filter.predict(s, 1, sample_time);
+          }
+        }
+      }
+      else if(decoder.has_new_data(st)) {
+        sample_ready = true;
+        valid_mask = decoder.new_data_mask(st);
+        for(uint8_t s = 0; s < OUTPUT_SENSORS; s++) {
+          x_angles[s] = decoder.x_angle(s, st);
+          y_angles[s] = decoder.y_angle(s, st);
+        }
+        decoder.clear_new_data(st);
+      }
+
+      if(!sample_ready) {
+        continue;
+      }
+      uint32_t output_start = IrqProfiler::now();
+
+      if(CALIBRATION_ENABLED) {
+        for(uint8_t s = 0; s < OUTPUT_SENSORS; s++) {
+          decoder.correct(st, x_angles[s], y_angles[s]);
+        }
+      }
+
+      PoseSolver::Result pose_result = PoseSolver::SOLVE_TOO_FEW_SENSORS;
+      if(POSE_ENABLED) {
+        // timed in us, so it works without the stats' cycle counter, then checked in cycles against the budget
+        uint32_t solve_start = time_us_32();
+        pose_result = pose_solver.solve(x_angles, y_angles, valid_mask);
+        uint32_t solve_cycles = (time_us_32() - solve_start) * (LighthouseTiming::SYS_CLOCK_HZ / 1000000);
+        if(solve_cycles > pose_max_cycles) {
+          pose_max_cycles = solve_cycles;
+        }
+        if(solve_cycles > PoseSolver::solve_budget_cycles(OUTPUT_SENSORS)) {
+          pose_overruns++;
+        }
+      }
+
+      output_snapshot.timestamp_us = sample_time;
+      output_snapshot.station = st;
+      output_snapshot.sensor_count = OUTPUT_SENSORS;
+      output_snapshot.valid_mask = valid_mask;
+      for(uint8_t s = 0; s < OUTPUT_SENSORS; s++) {
+        output_snapshot.x_angle[s] = x_angles[s];
+        output_snapshot.y_angle[s] = y_angles[s];
+        output_snapshot.sweep_us[s] = FILTER_ENABLED ? sample_time : sweep_times[st][s];
+      }
+      output_snapshot.has_pose = POSE_ENABLED;
+      output_snapshot.pose_status = (uint8_t)pose_result;
+      output_snapshot.pose_residual = pose_solver.residual();
+      output_snapshot.pose = pose_solver.pose();
+      tracker_state.publish(output_snapshot);
+
+      if(RAW_CAPTURE_ENABLED) {
+        // the link is reserved for the capture stream
+      }
+      else if(BINARY_OUTPUT_ENABLED) {
+        FrameCodec::AnglesFrame frame;
+        frame.header.sensor_count = OUTPUT_SENSORS;
+        frame.header.timestamp_us = sample_time;
+        frame.valid_mask = valid_mask;
+        frame.station = st;
+        for(uint8_t s = 0; s < OUTPUT_SENSORS; s++) {
+          frame.x_angle[s] = x_angles[s];
+          frame.y_angle[s] = y_angles[s];
+        }
+        binary_output.submit_angles(frame);
+
+        if(POSE_ENABLED) {
+          FrameCodec::PoseFrame pose_frame;
+          const Pose& pose = pose_solver.pose();
+          pose_frame.header.timestamp_us = sample_time;
+          for(uint8_t i = 0; i < 3; i++) {
+            pose_frame.position[i] = pose.position[i];
+            for(uint8_t j = 0; j < 3; j++) {
+              pose_frame.rotation[i][j] = pose.rotation[i][j];
+            }
+          }
+          pose_frame.residual = pose_solver.residual();
+          pose_frame.iterations = pose_solver.iterations();
+          pose_frame.status = (uint8_t)pose_result;
+          pose_frame.station = st;
+          binary_output.submit_pose(pose_frame);
+        }
+      }
+      else {
+        for(uint8_t s = 0; s < OUTPUT_SENSORS; s++) {
+          printf(s == 0 ? "%f, %f" : ", %f, %f", q16_to_float(x_angles[s]), q16_to_float(y_angles[s]));
+        }
+        if(POSE_ENABLED) {
+          const Pose& pose = pose_solver.pose();
+          printf(", %d, %f, %f, %f", (int)pose_result,
+                 q16_to_float(pose.position[0]), q16_to_float(pose.position[1]), q16_to_float(pose.position[2]));
+        }
+        printf(", %d\n", st);
+      }
+
+      if(TrackerStats::ENABLED) {
+        output_cycles.record(IrqProfiler::elapsed(output_start));
+      }
+    }
+
+    // the led only takes a sample now and then, rather than redoing its gamma maths for every one
+    if(led_state.poll(led_snapshot)) {
+      set_led(angle_to_led(led_snapshot.x_angle[0]), angle_to_led(led_snapshot.y_angle[0]), led_snapshot.station == 0 ? 255 : 127);
+    }
+
+    if(RAW_CAPTURE_ENABLED) {
+      send_capture();
+    }
+
+    if(BINARY_OUTPUT_ENABLED || RAW_CAPTURE_ENABLED) {
+      binary_output.service();
+    }
+
+    // report the statistics when due or asked for. A stats frame waits for a free slot on the link
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    if(PIPELINE_STATS_INTERVAL_MS > 0 && now_ms - last_stats >= PIPELINE_STATS_INTERVAL_MS) {
+      stats_pending = true;
+      last_stats = now_ms;
+    }
+    if(now_ms - last_request_poll >= STATS_REQUEST_POLL_MS) {
+      last_request_poll = now_ms;
+      if(getchar_timeout_us(0) == 's') {
+        stats_pending = true;
+      }
+    }
+
+    if(stats_pending) {
+      FrameCodec::StatsFrame stats_frame;
+      if(DUAL_CORE_ENABLED) {
+        fill_stats(stats_frame, capture.decode_counts(), capture.decode_histogram());
+      }
+      else {
+        fill_stats(stats_frame, decoder.decode_counts(), decode_cycles);
+      }
+
+      if(BINARY_OUTPUT_ENABLED || RAW_CAPTURE_ENABLED) {
+        stats_pending = !binary_output.submit_stats(stats_frame);
+      }
+      else {
+        if(DUAL_CORE_ENABLED) {
+          stats = capture.stats();
+        }
+        const IrqProfiler& irq_profile = SENSOR_GROUP_ENABLED ? SensorGroup::irq_profile : Sensor::irq_profile;
+        printf("# events %lu (%lu drain timed), dropped %lu, max depth %lu, latency mean %luus max %luus, max drain gap %luus, "
+               "pose max %lu cycles overruns %lu, irq %lu cycles/pulse max %lu\n",
+               stats.events, stats.drain_timed, stats.dropped_events, stats.max_queue_depth,
+               stats.mean_latency_us(), stats.max_latency_us, stats.max_drain_gap_us, pose_max_cycles, pose_overruns,
+               irq_profile.cycles_per_pulse(), irq_profile.max());
+        if(LINK_ENABLED) {
+          printf("# link %s, drift %ldppb, beacons %lu in %lu out, outliers %lu, restarts %lu, events %lu in %lu out %lu lost, "
+                 "frames %lu forwarded %lu lost %lu bad\n", tracker_link.locked() ? "locked" : "unlocked", tracker_link.drift_ppb(),
+                 tracker_link.beacons_in(), tracker_link.beacons_out(), tracker_link.outliers(), tracker_link.restarts(),
+                 tracker_link.events_in(), tracker_link.events_out(), tracker_link.events_lost(),
+                 tracker_link.forwarded(), tracker_link.frames_lost(), tracker_link.bad_count());
+        }
+        if(LOW_POWER_ENABLED) {
+          printf("# power sleeps %lu, lost %lu times for %lums, wake to decode mean %luus max %luus\n",
+                 power.sleeps(), power.losses(), power.lost_ms(), power.mean_latency_us(), power.max_latency_us());
+        }
+        if(TrackerStats::ENABLED) {
+          print_stats(stats_frame);
+        }
+        stats_pending = false;
+      }
+    }
+
+    // sleep until the next pulses arrive, unless this pass found some or there is output still to send
+    if(LOW_POWER_ENABLED) {
+      power.drained(drained);
+      bool output_busy = (BINARY_OUTPUT_ENABLED || RAW_CAPTURE_ENABLED) && !binary_output.idle();
+      if(drained == 0 && !output_busy && !stats_pending) {
+        power.wait(LOW_POWER_MAX_SLEEP_US);
+      }
     }
   }
 }
\ No newline at end of file